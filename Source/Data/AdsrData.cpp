@@ -15,7 +15,8 @@
  *
  * This function sets the ADSR (Attack, Decay, Sustain, Release) values for the envelope
  * generator. These parameters shape the envelope that controls various aspects of a
- * sound's amplitude characteristics over time.
+ * sound's amplitude characteristics over time. A new sustain level takes effect straight
+ * away if the envelope is sustaining; the times apply to the next segment that starts.
  *
  * @param attack The time it takes for the envelope to reach its maximum level after being triggered.
  * @param decay The time it takes for the envelope to drop to the sustain level after the attack phase.
@@ -23,12 +24,145 @@
  * @param release The time it takes for the envelope to close or reach zero level after the key is released.
  */
 void AdsrData::updateADSR(const float attack, const float decay, const float sustain, const float release) {
-    // Update the internal ADSR structure with the new values
-    ADSRParameters.attack = attack;
-    ADSRParameters.decay = decay;
-    ADSRParameters.sustain = sustain;
-    ADSRParameters.release = release;
-
-    // Apply the updated parameters to the ADSR envelope
-    setParameters(ADSRParameters);
+    attackTime = attack;
+    decayTime = decay;
+    sustainLevel = sustain;
+    releaseTime = release;
+
+    if (stage == Stage::sustain)
+        enterStage(Stage::sustain, makeSustain());
+}
+
+void AdsrData::setSampleRate(double newSampleRate) {
+    jassert(newSampleRate > 0.0);
+    sampleRate = newSampleRate;
+}
+
+void AdsrData::noteOn() noexcept {
+    enterStage(Stage::attack, makeAttack(isActive() ? segment.getLevel() : 0.0f));
+
+    // An instant attack goes straight on to the decay.
+    if (samplesLeft == 0)
+        advanceStage();
+}
+
+void AdsrData::noteOff() noexcept {
+    if (stage != Stage::idle && stage != Stage::release)
+        enterStage(Stage::release, makeRelease(segment.getLevel()));
+}
+
+void AdsrData::reset() noexcept {
+    stage = Stage::idle;
+    segment = {};
+    samplesLeft = 0;
+}
+
+AdsrData::Position AdsrData::getPosition() const noexcept {
+    Position position{ stage, segment };
+    position.segment.length = samplesLeft;
+    return position;
+}
+
+void AdsrData::setPosition(const Position& position) noexcept {
+    if (position.stage == Stage::idle)
+        reset();
+    else
+        enterStage(position.stage, position.segment);
+}
+
+// A linear step scales with the sample period, and an exponential coefficient is raised to its power.
+AdsrData::Position AdsrData::Position::resampled(double ratio) const noexcept {
+    Position result = *this;
+
+    if (ratio == 1.0)
+        return result;
+
+    result.segment.rate = (float) (segment.rate / ratio);
+    result.segment.coefficient = (float) std::pow((double) segment.coefficient, 1.0 / ratio);
+
+    if (segment.length != endless)
+        result.segment.length = (int) std::lround(segment.length * ratio);
+
+    return result;
+}
+
+//==============================================================================
+void AdsrData::enterStage(Stage newStage, const Segment& newSegment) noexcept {
+    stage = newStage;
+    segment = newSegment;
+    samplesLeft = newSegment.length;
+}
+
+// Each following segment starts exactly on the previous one's target, so rounding never accumulates.
+void AdsrData::advanceStage() noexcept {
+    switch (stage) {
+    case Stage::attack:
+        enterStage(Stage::decay, makeDecay());
+        break;
+    case Stage::decay:
+    case Stage::sustain:
+        enterStage(Stage::sustain, makeSustain());
+        break;
+    case Stage::release:
+        reset();
+        break;
+    case Stage::idle:
+    default:
+        break;
+    }
+}
+
+//==============================================================================
+AdsrData::Segment AdsrData::makeAttack(float fromLevel) const noexcept {
+    // The attack keeps the same slope when it starts part way up, as juce::ADSR does.
+    const int fullLength = secondsToSamples(attackTime);
+    const int length = (int) std::ceil((1.0f - juce::jlimit(0.0f, 1.0f, fromLevel)) * (float) fullLength);
+
+    return makeSegment(fromLevel, 1.0f, length, attackOvershoot);
+}
+
+AdsrData::Segment AdsrData::makeDecay() const noexcept {
+    return makeSegment(1.0f, sustainLevel, secondsToSamples(decayTime), decayOvershoot);
+}
+
+AdsrData::Segment AdsrData::makeSustain() const noexcept {
+    Segment hold;
+    hold.offset = sustainLevel;
+    hold.target = sustainLevel;
+    hold.length = endless;
+    return hold;
+}
+
+AdsrData::Segment AdsrData::makeRelease(float fromLevel) const noexcept {
+    return makeSegment(fromLevel, 0.0f, secondsToSamples(releaseTime), decayOvershoot);
+}
+
+AdsrData::Segment AdsrData::makeSegment(float from, float to, int length, float overshoot) const noexcept {
+    Segment result;
+    result.target = to;
+    result.length = juce::jmax(0, length);
+
+    if (result.length == 0 || from == to) {
+        // Nothing to travel: hold the target for the segment's length.
+        result.offset = to;
+        return result;
+    }
+
+    if (curve == Curve::linear) {
+        result.offset = from;
+        result.rate = (to - from) / (float) result.length;
+        return result;
+    }
+
+    // Aim past the target so that the exponential reaches it after exactly length samples:
+    // with aim = to + (to - from) * overshoot, coefficient^length = overshoot / (1 + overshoot).
+    const float aim = to + (to - from) * overshoot;
+    result.offset = aim;
+    result.delta = from - aim;
+    result.coefficient = (float) std::exp(std::log(overshoot / (1.0 + overshoot)) / result.length);
+    return result;
+}
+
+int AdsrData::secondsToSamples(float seconds) const noexcept {
+    return juce::jmax(1, juce::roundToInt(seconds * sampleRate));
 }
\ No newline at end of file
@@ -8,35 +8,70 @@
   ==============================================================================
 */
 
-#pragma once
-/*
-  ==============================================================================
-
-    AdsrData.h
-    Created: 17 Apr 2024 3:57:18pm
-    Author:  wllun
-
-  ==============================================================================
-*/
-
 #pragma once
 
 #include <JuceHeader.h>
 
 /**
- * The AdsrData class manages the ADSR envelope parameters for an audio application.
- * It extends the functionality of the juce::ADSR class by allowing detailed configuration
- * of its parameters, which are essential for controlling the dynamics of a sound.
+ * The AdsrData class manages the ADSR envelope of a voice.
  *
  * ADSR stands for Attack, Decay, Sustain, and Release:
  * - Attack: Time taken for the initial run-up of level from nil to peak, immediately upon triggering.
  * - Decay: Time taken for the subsequent run down from the attack level to the designated sustain level.
  * - Sustain: Level during the main sequence of the sound's duration, until the release is triggered.
  * - Release: Time taken for the level to decay from the sustain level to zero after the release is triggered.
+ *
+ * Each stage is a segment whose shape is known in closed form when it starts, either a straight
+ * line or an exponential curve towards its target. A block of the envelope is therefore walked
+ * without stepping a state machine per sample: the code only branches where a segment ends,
+ * and the caller's render loop applies each segment in place.
  */
-class AdsrData : public juce::ADSR {
+class AdsrData {
 
 public:
+    /** The shape of the attack, decay and release segments. */
+    enum class Curve {
+        linear = 0,   ///< Straight lines, as juce::ADSR.
+        exponential   ///< Exponential approach to each target, like an analogue envelope.
+    };
+
+    /**
+     * One segment of the envelope in closed form. The level at sample n of the segment is
+     * offset + delta(n), where delta(0) is the starting delta and delta(n + 1) = delta(n) * coefficient + rate.
+     * Linear segments have a coefficient of 1; exponential segments have a rate of 0.
+     */
+    struct Segment {
+        float offset{ 0.0f };        ///< The level the segment is expressed around.
+        float delta{ 0.0f };         ///< The current level minus the offset.
+        float coefficient{ 1.0f };   ///< Multiplier applied to delta every sample.
+        float rate{ 0.0f };          ///< Amount added to delta every sample.
+        float target{ 0.0f };        ///< The exact level at the end of the segment.
+        int length{ 0 };             ///< Number of samples in the segment.
+
+        /** Returns the level the segment is currently at. */
+        float getLevel() const noexcept { return offset + delta; }
+    };
+
+    /** The stages of the envelope; idle once the release has finished. */
+    enum class Stage { idle, attack, decay, sustain, release };
+
+    /**
+     * Where a running envelope has got to, so a sounding note can move between a voice and the
+     * voice bank without restarting. The segment's length is the number of samples it has left.
+     */
+    struct Position {
+        Stage stage{ Stage::idle };
+        Segment segment;
+
+        /**
+         * Returns the same position at another sample rate: the rate and coefficient are
+         * rescaled, so the segment passes through the same levels at the same times.
+         *
+         * @param ratio The new sample rate divided by the old one.
+         */
+        Position resampled(double ratio) const noexcept;
+    };
+
     /**
      * Updates the ADSR parameters of the envelope.
      *
@@ -50,8 +85,137 @@ public:
      */
     void updateADSR(const float attack, const float decay, const float sustain, const float release);
 
+    /**
+     * Selects the shape of the segments. Segments that are already running keep their shape.
+     *
+     * @param newCurve The curve used by segments started from now on.
+     */
+    void setCurve(Curve newCurve) { curve = newCurve; }
+
+    /**
+     * Sets the level below which a release counts as silent and ends early, so a long
+     * exponential tail is not rendered all the way down to zero.
+     *
+     * @param level The linear level, or 0 to always run the release to its end.
+     */
+    void setSilenceThreshold(float level) noexcept { silenceThreshold = level; }
+
+    /** Returns the level set with setSilenceThreshold(). */
+    float getSilenceThreshold() const noexcept { return silenceThreshold; }
+
+    /**
+     * Sets the sample rate used to convert the stage times into segment lengths.
+     *
+     * @param newSampleRate The audio sample rate.
+     */
+    void setSampleRate(double newSampleRate);
+
+    /** Starts the attack from the current level, so a retriggered note does not click. */
+    void noteOn() noexcept;
+
+    /** Starts the release from the current level, unless the envelope is idle or already releasing. */
+    void noteOff() noexcept;
+
+    /** Stops the envelope immediately and returns it to silence. */
+    void reset() noexcept;
+
+    /** Returns true until the release has finished. */
+    bool isActive() const noexcept { return stage != Stage::idle; }
+
+    /** Returns the level the envelope has reached, from 0 to 1. */
+    float getLevel() const noexcept { return segment.getLevel(); }
+
+    /** Returns the stage and segment the envelope is at, for handing the note to another renderer. */
+    Position getPosition() const noexcept;
+
+    /**
+     * Carries on from a position taken from another renderer, at this envelope's sample rate.
+     *
+     * @param position The stage and remaining segment; an idle stage resets the envelope.
+     */
+    void setPosition(const Position& position) noexcept;
+
+    /**
+     * Walks the next numSamples of the envelope one segment at a time, for callers that apply
+     * the envelope inside their own loop. The function is
+     * called as function(segment, startSample, count) for each run of samples that lies within
+     * one segment; it must step segment.delta through all count samples before returning.
+     *
+     * @param numSamples The number of samples to advance.
+     * @param function Consumes each run of the envelope.
+     * @return The number of samples covered before the envelope went idle.
+     */
+    template <typename Function>
+    int processSegments(int numSamples, Function&& function) noexcept {
+        int done = 0;
+
+        while (done < numSamples && stage != Stage::idle) {
+            const int count = juce::jmin(numSamples - done, samplesLeft);
+            function(segment, done, count);
+
+            if (samplesLeft != endless)
+                samplesLeft -= count;
+
+            done += count;
+
+            if (samplesLeft == 0)
+                advanceStage();
+            else if (stage == Stage::release && segment.getLevel() < silenceThreshold)
+                reset();
+        }
+
+        return done;
+    }
+
+    //==============================================================================
+    // Segment construction, shared with the voice bank so both renderers sound the same.
+
+    /** Returns the attack segment starting from a given level. */
+    Segment makeAttack(float fromLevel) const noexcept;
+
+    /** Returns the decay segment from full level down to the sustain level. */
+    Segment makeDecay() const noexcept;
+
+    /** Returns the segment that holds the sustain level until the note is released. */
+    Segment makeSustain() const noexcept;
+
+    /** Returns the release segment starting from a given level. */
+    Segment makeRelease(float fromLevel) const noexcept;
+
+    /** Returns the sustain level. */
+    float getSustainLevel() const noexcept { return sustainLevel; }
+
+    /** Segment length that stands for a sustain that never ends by itself. */
+    static constexpr int endless = std::numeric_limits<int>::max();
+
 private:
-    // Stores the current parameters of the ADSR envelope.
-    juce::ADSR::Parameters ADSRParameters;
+    /** Builds a segment from a start level to a target over a number of samples. */
+    Segment makeSegment(float from, float to, int length, float overshoot) const noexcept;
+
+    /** Enters a stage with a new segment. */
+    void enterStage(Stage newStage, const Segment& newSegment) noexcept;
+
+    /** Moves to the stage after the one whose segment just ended. */
+    void advanceStage() noexcept;
+
+    /** Converts a time in seconds into a segment length of at least one sample. */
+    int secondsToSamples(float seconds) const noexcept;
+
+    // How far exponential segments aim past their target, as a fraction of the distance travelled.
+    // A larger overshoot gives a straighter curve; these match the usual analogue-style shapes.
+    static constexpr float attackOvershoot = 0.3f;
+    static constexpr float decayOvershoot = 0.0001f;
+
+    Stage stage{ Stage::idle };
+    Segment segment;
+    int samplesLeft{ 0 };
+
+    Curve curve{ Curve::linear };
+    double sampleRate{ 44100.0 };
+    float attackTime{ 0.1f };
+    float decayTime{ 0.1f };
+    float sustainLevel{ 1.0f };
+    float releaseTime{ 0.1f };
+    float silenceThreshold{ 0.0f };
 
 };
\ No newline at end of file
@@ -0,0 +1,84 @@
+/*
+  ==============================================================================
+
+    DspMath.h
+    Small branch-free approximations used in the inner render loops, written so
+    that the compiler can vectorise the loops that call them.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace DspMath {
+
+/** Element-wise minimum and maximum, overloaded so the helpers below work on floats and SIMD registers. */
+inline float minimum(float a, float b) noexcept { return a < b ? a : b; }
+inline float maximum(float a, float b) noexcept { return a < b ? b : a; }
+
+#if JUCE_USE_SIMD
+inline juce::dsp::SIMDRegister<float> minimum(juce::dsp::SIMDRegister<float> a, juce::dsp::SIMDRegister<float> b) noexcept {
+    return juce::dsp::SIMDRegister<float>::min(a, b);
+}
+
+inline juce::dsp::SIMDRegister<float> maximum(juce::dsp::SIMDRegister<float> a, juce::dsp::SIMDRegister<float> b) noexcept {
+    return juce::dsp::SIMDRegister<float>::max(a, b);
+}
+#endif
+
+/**
+ * Approximates sin(2 * pi * phase) without a call to std::sin. The phase is folded onto
+ * [-pi/2, pi/2] and evaluated with a ninth-order polynomial, so the error stays below 4e-6.
+ * Works on a float or on a juce::dsp::SIMDRegister<float>.
+ *
+ * @param phase The position within the cycle, in [0, 1).
+ */
+template <typename Type>
+inline Type sinCycle(Type phase) noexcept {
+    // sin(2 pi phase) = -sin(pi t) with t = 2 phase - 1 in [-1, 1).
+    Type t = phase * 2.0f - 1.0f;
+
+    // Fold onto [-0.5, 0.5] using the symmetry of the sine around its peaks.
+    t = minimum(t, t * -1.0f + 1.0f);
+    t = maximum(t, t * -1.0f - 1.0f);
+
+    const Type x = t * 3.14159265358979f;
+    const Type x2 = x * x;
+    const Type series = (((x2 * (1.0f / 362880.0f) - 1.0f / 5040.0f) * x2 + 1.0f / 120.0f) * x2 - 1.0f / 6.0f) * x2 + 1.0f;
+
+    return x * series * -1.0f;
+}
+
+/**
+ * Converts a pan position into constant-power channel gains, scaled so that a centred
+ * voice keeps unity gain on both channels.
+ *
+ * @param pan The position from -1 (left) to 1 (right).
+ * @param left Receives the gain of the left channel.
+ * @param right Receives the gain of the right channel.
+ */
+inline void panGains(float pan, float& left, float& right) noexcept {
+    const float angle = (juce::jlimit(-1.0f, 1.0f, pan) + 1.0f) * juce::MathConstants<float>::pi * 0.25f;
+    left = std::cos(angle) * juce::MathConstants<float>::sqrt2;
+    right = std::sin(angle) * juce::MathConstants<float>::sqrt2;
+}
+
+/**
+ * Returns the fractional part of a non-negative value, truncating instead of calling std::floor.
+ */
+inline float wrapPhase(float phase) noexcept {
+    return phase - (float) (int) phase;
+}
+
+/**
+ * Wraps a phase that may have moved below zero, such as a carrier under deep FM, into [0, 1).
+ * A tiny negative phase plus one rounds to exactly 1 in float, so that case is folded back to 0.
+ */
+inline float wrapSignedPhase(float phase) noexcept {
+    phase -= std::floor(phase);
+    return phase < 1.0f ? phase : 0.0f;
+}
+
+}
\ No newline at end of file
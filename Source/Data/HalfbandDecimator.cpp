@@ -0,0 +1,81 @@
+/*
+  ==============================================================================
+
+    HalfbandDecimator.cpp
+    Designs the half-band filter and runs the polyphase decimation loop.
+
+  ==============================================================================
+*/
+
+#include "HalfbandDecimator.h"
+
+void HalfbandDecimator::prepare(int maxInputSamples) {
+    work.assign((size_t) (historySize + juce::jmax(2, maxInputSamples)), 0.0f);
+}
+
+void HalfbandDecimator::reset() noexcept {
+    std::fill(work.begin(), work.end(), 0.0f);
+}
+
+// Output m is centred on input 2m - 2 * numCoefficients, so the delay is numCoefficients output samples.
+void HalfbandDecimator::processAdding(const float* input, float* output, int numOutputSamples) noexcept {
+    const int numInputSamples = numOutputSamples * 2;
+    jassert(historySize + numInputSamples <= (int) work.size());
+
+    float* const x = work.data();
+    std::copy(input, input + numInputSamples, x + historySize);
+
+    for (int m = 0; m < numOutputSamples; ++m) {
+        const float* const centre = x + historySize + 2 * m - 2 * numCoefficients;
+        float sum = 0.5f * centre[0];
+
+        for (int j = 0; j < numCoefficients; ++j)
+            sum += coefficients[j] * (centre[2 * j + 1] + centre[-2 * j - 1]);
+
+        output[m] += sum;
+    }
+
+    // Keep the newest samples as the history of the next block.
+    std::memmove(x, x + numInputSamples, (size_t) historySize * sizeof(float));
+}
+
+// Windowed sinc with its cutoff at a quarter of the input rate. With the Kaiser window's beta of 7
+// the passband is flat to 0.4 of the output rate and everything above 0.6 of it is at least 80 dB down.
+const std::array<float, HalfbandDecimator::numCoefficients>& HalfbandDecimator::getCoefficients() {
+    static const auto coefficients = [] {
+        constexpr double beta = 7.0;
+        constexpr double halfWidth = 2 * numCoefficients - 1;
+
+        // The zeroth-order modified Bessel function, from its power series.
+        const auto bessel = [](double x) {
+            double sum = 1.0, term = 1.0;
+
+            for (int k = 1; k < 32; ++k) {
+                term *= (x / (2.0 * k)) * (x / (2.0 * k));
+                sum += term;
+            }
+
+            return sum;
+        };
+
+        std::array<double, numCoefficients> taps{};
+        double total = 0.0;
+
+        for (int j = 0; j < numCoefficients; ++j) {
+            const double n = 2 * j + 1;
+            const double window = bessel(beta * std::sqrt(1.0 - (n / halfWidth) * (n / halfWidth))) / bessel(beta);
+            taps[(size_t) j] = (j % 2 == 0 ? 1.0 : -1.0) / (juce::MathConstants<double>::pi * n) * window;
+            total += 2.0 * taps[(size_t) j];
+        }
+
+        // Scale the side taps so that, with the centre tap of 0.5, the gain at DC is exactly 1.
+        std::array<float, numCoefficients> result{};
+
+        for (int j = 0; j < numCoefficients; ++j)
+            result[(size_t) j] = (float) (taps[(size_t) j] * 0.5 / total);
+
+        return result;
+    }();
+
+    return coefficients;
+}
\ No newline at end of file
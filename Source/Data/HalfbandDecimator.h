@@ -0,0 +1,61 @@
+/*
+  ==============================================================================
+
+    HalfbandDecimator.h
+    A linear-phase half-band lowpass that halves the sample rate of one
+    channel, evaluated in polyphase form.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+/**
+ * HalfbandDecimator filters one channel with a Kaiser-windowed half-band FIR and keeps every
+ * second sample. In a half-band filter every even tap except the centre is zero, so only the
+ * odd phase needs multiplies: each output costs numCoefficients multiplies, using the symmetry
+ * of the taps, plus the centre tap, which is a plain delay. The filter is linear phase, so its
+ * delay is the same at every frequency and a whole number of output samples.
+ */
+class HalfbandDecimator {
+
+public:
+    /** Number of distinct non-zero side taps. The filter has 4 * numCoefficients - 1 taps. */
+    static constexpr int numCoefficients = 12;
+
+    /** Delay of the filter, in output samples. */
+    static constexpr int latency = numCoefficients;
+
+    /**
+     * Sizes the history for the largest block and clears it. Must not be called from the audio thread.
+     *
+     * @param maxInputSamples The largest number of input samples passed to processAdding().
+     */
+    void prepare(int maxInputSamples);
+
+    /** Clears the filter's history. */
+    void reset() noexcept;
+
+    /**
+     * Filters 2 * numOutputSamples input samples and adds every second filtered sample to the output.
+     *
+     * @param input The signal at the higher rate.
+     * @param output Receives the signal at half the rate, added to what it already holds.
+     * @param numOutputSamples The number of output samples; at most half the prepared input size.
+     */
+    void processAdding(const float* input, float* output, int numOutputSamples) noexcept;
+
+private:
+    /** Returns the side taps, designed once per process. */
+    static const std::array<float, numCoefficients>& getCoefficients();
+
+    static constexpr int historySize = 4 * numCoefficients;   ///< Input samples the oldest tap reaches back.
+
+    std::vector<float> work;     ///< The history followed by the current input, sized in prepare().
+    const float* coefficients{ getCoefficients().data() };   ///< Looked up once, off the audio thread.
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(HalfbandDecimator)
+};
\ No newline at end of file
@@ -0,0 +1,60 @@
+/*
+  ==============================================================================
+
+    ModMatrix.cpp
+    Routes control-rate modulation sources to the pitch, FM, level and pan of
+    every voice through a fixed array of slots.
+
+  ==============================================================================
+*/
+
+#include "ModMatrix.h"
+#include "DspMath.h"
+
+// A route with no source, no target or no amount does nothing, so it is left out of the packed routes.
+void ModMatrix::setSlot(int slot, int source, int target, float amount) noexcept {
+    if (!juce::isPositiveAndBelow(slot, numSlots))
+        return;
+
+    slots[(size_t) slot] = { juce::jlimit(0, numSources - 1, source), juce::jlimit(0, numTargets - 1, target), amount };
+
+    numRoutes = 0;
+    sourceUsed.fill(false);
+
+    for (const auto& route : slots) {
+        if (route.source == noSource || route.target == noTarget || route.amount == 0.0f)
+            continue;
+
+        routes[(size_t) numRoutes++] = route;
+        sourceUsed[(size_t) route.source] = true;
+    }
+}
+
+void ModMatrix::setLfo(int lfo, int shape, float rate) noexcept {
+    if (!juce::isPositiveAndBelow(lfo, numLfos))
+        return;
+
+    lfoShape[(size_t) lfo] = juce::jlimit(0, numLfoShapes - 1, shape);
+    lfoRate[(size_t) lfo] = juce::jmax(0.0f, rate);
+}
+
+// The amounts are scaled into each target's unit here, so the voices only convert the sums.
+void ModMatrix::evaluate(const SourceValues& sources, TargetValues& targets) const noexcept {
+    static constexpr std::array<float, numTargets> ranges{ 0.0f, pitchRange, fmDepthRange, fmFrequencyRange, 1.0f, 1.0f };
+
+    targets.fill(0.0f);
+
+    for (int i = 0; i < numRoutes; ++i) {
+        const auto& route = routes[(size_t) i];
+        targets[(size_t) route.target] += sources[(size_t) route.source] * route.amount * ranges[(size_t) route.target];
+    }
+}
+
+float ModMatrix::getLfoValue(int shape, float phase) noexcept {
+    switch (shape) {
+        case triangleShape: return 1.0f - 4.0f * std::abs(phase - 0.5f);
+        case sawShape:      return 2.0f * phase - 1.0f;
+        case squareShape:   return phase < 0.5f ? 1.0f : -1.0f;
+        default:            return DspMath::sinCycle(phase);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,150 @@
+/*
+  ==============================================================================
+
+    ModMatrix.h
+    Routes control-rate modulation sources to the pitch, FM, level and pan of
+    every voice through a fixed array of slots.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+/**
+ * ModMatrix holds the routes of the modulation matrix: each slot adds a source, scaled by an
+ * amount, to a target. Sources are sampled once per control period of controlInterval samples
+ * rather than per sample, and the voices interpolate the resulting targets linearly across the
+ * period, so a route costs a multiply-add per voice per control period however many samples it spans.
+ *
+ * The slots that route something are packed into a second array when they are set, so
+ * evaluate() walks one short, contiguous run of routes and never skips empty slots.
+ *
+ * The matrix also holds the settings of its two LFOs. The voice LFO restarts with every note and
+ * runs in each voice; the global LFO is a single oscillator the engine runs for all of them.
+ */
+class ModMatrix {
+
+public:
+    /** The number of slots, each one the MODnSOURCE, MODnTARGET and MODnAMOUNT parameters. */
+    static constexpr int numSlots = 4;
+
+    /** The number of LFOs: the voice LFO and the global LFO. */
+    static constexpr int numLfos = 2;
+
+    /** Samples between two evaluations of the sources, at the base sample rate. */
+    static constexpr int controlInterval = 32;
+
+    /** The modulation sources, in the same order as the MODnSOURCE choices. */
+    enum Source {
+        noSource = 0,
+        voiceLfo,      ///< The voice's own LFO, from -1 to 1, restarted by every note.
+        globalLfo,     ///< The engine's LFO shared by every voice, from -1 to 1.
+        envelope,      ///< The level of the voice's amplitude envelope, from 0 to 1.
+        velocity,      ///< The note-on velocity, from 0 to 1.
+        pitchWheel,    ///< The pitch wheel of the note's channel, from -1 to 1.
+        modWheel,      ///< The mod wheel (controller 1) of the note's channel, from 0 to 1.
+        numSources
+    };
+
+    /** The modulation targets, in the same order as the MODnTARGET choices. */
+    enum Target {
+        noTarget = 0,
+        pitch,         ///< In semitones; an amount of 1 moves the note by pitchRange.
+        fmDepth,       ///< In Hz, added to the FM depth; an amount of 1 adds fmDepthRange.
+        fmFrequency,   ///< In octaves of the FM frequency; an amount of 1 moves it by fmFrequencyRange.
+        amplitude,     ///< Added to the voice's level of 1, and kept within [0, 2].
+        pan,           ///< A balance from -1 for left to 1 for right, on top of the voice's position.
+        numTargets
+    };
+
+    /** The LFO waveforms, in the same order as the LFOnSHAPE choices. */
+    enum LfoShape {
+        sineShape = 0,
+        triangleShape,
+        sawShape,
+        squareShape,
+        numLfoShapes
+    };
+
+    /** How far an amount of 1 moves the pitch, in semitones. */
+    static constexpr float pitchRange = 12.0f;
+
+    /** How much an amount of 1 adds to the FM depth, in Hz. */
+    static constexpr float fmDepthRange = 1000.0f;
+
+    /** How far an amount of 1 moves the FM frequency, in octaves. */
+    static constexpr float fmFrequencyRange = 4.0f;
+
+    /** The value of every source at one control point, indexed by Source. */
+    using SourceValues = std::array<float, numSources>;
+
+    /** The sum of the routes to every target, in the target's own unit and indexed by Target. */
+    using TargetValues = std::array<float, numTargets>;
+
+    /**
+     * Sets one slot and repacks the routes. Audio thread; never allocates.
+     *
+     * @param slot The slot, from 0 to numSlots - 1.
+     * @param source One of the Source values; noSource leaves the slot unused.
+     * @param target One of the Target values; noTarget leaves the slot unused.
+     * @param amount The depth of the route, from -1 to 1.
+     */
+    void setSlot(int slot, int source, int target, float amount) noexcept;
+
+    /**
+     * Sets the waveform and rate of an LFO.
+     *
+     * @param lfo 0 for the voice LFO, 1 for the global LFO.
+     * @param shape One of the LfoShape values.
+     * @param rate The rate in Hz.
+     */
+    void setLfo(int lfo, int shape, float rate) noexcept;
+
+    /** Returns the waveform of an LFO. */
+    int getLfoShape(int lfo) const noexcept { return lfoShape[(size_t) lfo]; }
+
+    /** Returns the rate of an LFO in Hz. */
+    float getLfoRate(int lfo) const noexcept { return lfoRate[(size_t) lfo]; }
+
+    /** Returns true if any slot routes a source to a target. */
+    bool isActive() const noexcept { return numRoutes > 0; }
+
+    /** Returns true if any route reads a given source. */
+    bool usesSource(Source source) const noexcept { return sourceUsed[(size_t) source]; }
+
+    /**
+     * Sums every route into its target.
+     *
+     * @param sources The value of every source.
+     * @param targets Receives the modulation of every target; targets without a route get 0.
+     */
+    void evaluate(const SourceValues& sources, TargetValues& targets) const noexcept;
+
+    /**
+     * Returns the value of an LFO waveform.
+     *
+     * @param shape One of the LfoShape values.
+     * @param phase The position within the cycle, in [0, 1).
+     * @return The value, from -1 to 1.
+     */
+    static float getLfoValue(int shape, float phase) noexcept;
+
+private:
+    /** One route of the matrix. */
+    struct Route {
+        int source{ noSource };
+        int target{ noTarget };
+        float amount{ 0.0f };
+    };
+
+    std::array<Route, numSlots> slots{};              ///< Every slot as it was set, used or not.
+    std::array<Route, numSlots> routes{};             ///< The used slots, packed from the start.
+    int numRoutes{ 0 };                               ///< Number of entries in routes.
+    std::array<bool, numSources> sourceUsed{};        ///< Whether any route reads each source.
+    std::array<int, numLfos> lfoShape{};              ///< The waveform of each LFO.
+    std::array<float, numLfos> lfoRate{ 1.0f, 1.0f }; ///< The rate of each LFO in Hz.
+
+};
\ No newline at end of file
@@ -14,15 +14,25 @@
  * Prepares the oscillator data for playback by initializing all required components with the given specifications.
  *
  * @param spec The audio processing specifications including sample rate, block size, and number of channels.
- *             This specification is used to prepare the internal state of the oscillator and frequency modulation oscillator.
+ *             The sample rate is used to convert frequencies into increments.
  */
 void OscData::prepareToPlay(juce::dsp::ProcessSpec& spec) {
-    fmOsc.prepare(spec);  // Prepare the frequency modulation oscillator with the provided audio specifications.
-    prepare(spec);        // Prepare this oscillator with the same specifications.
+    baseSampleRate = spec.sampleRate;  // Store the sample rate used to turn frequencies into phase increments.
+    sampleRate = baseSampleRate * (1 << oversamplingLevel);
+
+    phase = 0.0f;
+    fmPhase = 0.0f;
+
+    for (int voice = 0; voice < unisonVoices; ++voice)
+        unisonPhase[(size_t) voice] = DspMath::wrapPhase((float) voice * 0.618034f);
+
+    // Recompute every increment for the new sample rate.
+    setFmParams(fmDepth, fmFrequency);
 }
 
 /**
- * Sets the waveform type of the oscillator based on a given choice.
+ * Sets the waveform type of the oscillator based on a given choice. This only swaps the
+ * table pointer, so it never allocates and is cheap to call from the audio thread.
  *
  * @param choice The type of waveform to generate:
  *               0 for Sine Wave,
@@ -30,71 +40,567 @@ void OscData::prepareToPlay(juce::dsp::ProcessSpec& spec) {
  *               2 for Square Wave.
  */
 void OscData::setWaveType(const int choice) {
-    switch (choice) {
-    case 0:
-        // Sine wave
-        initialise([](float x) { return std::sin(x); });
-        break;
-    case 1:
-        // Saw wave
-        initialise([](float x) { return x / juce::MathConstants<float>::pi; });
-        break;
-    case 2:
-        // Square wave
-        initialise([](float x) { return x < 0.0f ? -1.0f : 1.0f; });
-        break;
-    default:
+    if (!juce::isPositiveAndBelow(choice, (int) WavetableBank::numWaveforms)) {
         jassertfalse; // Triggers a breakpoint in debug mode if an undefined wave type is selected.
-        break;
+        return;
     }
+
+    waveType = choice;
+    table = wavetables->getTable(waveType, tableLevel);
+}
+
+/**
+ * Sets the frequency of a new note. The tuning table has already turned the note number into a
+ * frequency, so starting a note involves no transcendental math.
+ *
+ * @param frequency The note frequency in Hertz, before pitch bend.
+ */
+void OscData::setWaveFrequency(const float frequency) {
+    noteFrequency = frequency;
+    setFrequency(noteFrequency * pitchBend);
+}
+
+/**
+ * Applies the pitch wheel as a ratio of the note frequency, keeping the phases.
+ *
+ * @param ratio The frequency ratio of the bend.
+ */
+void OscData::setPitchBend(const float ratio) {
+    pitchBend = ratio;
+    setFrequency(noteFrequency * pitchBend);
+}
+
+/**
+ * Moves the carrier and the modulator to the phases another renderer reached.
+ *
+ * @param newPhase The carrier phase, in [0, 1).
+ * @param newFmPhase The modulator phase, in [0, 1).
+ */
+void OscData::setPhases(const float newPhase, const float newFmPhase) {
+    phase = newPhase;
+    fmPhase = newFmPhase;
 }
 
 /**
- * Sets the frequency of the oscillator based on a MIDI note number.
+ * Lays out the unison stack. The copies are placed evenly across [-1, 1]; the position sets both
+ * the detune and the pan, so the flattest copy sits furthest left.
  *
- * @param midiNoteNumber The MIDI note number, which is converted to a frequency in Hertz and used to set the oscillator's frequency.
+ * @param voices The number of copies, clamped to [1, maxUnison].
+ * @param detune The detune of the outermost copies in cents.
+ * @param spread The stereo width of the stack, from 0 to 1.
  */
-void OscData::setWaveFrequency(const int midiNoteNumber) {
-    // Convert MIDI note to frequency and adjust by current frequency modulation value
-    setFrequency(juce::MidiMessage::getMidiNoteInHertz(midiNoteNumber) + fmMod);
-    lastMidiNote = midiNoteNumber; // Store the last MIDI note for potential future use.
+void OscData::setUnison(const int voices, const float detune, const float spread) {
+    const int count = juce::jlimit(1, maxUnison, voices);
+
+    // A new stack starts every copy at its own phase; fractional multiples of the golden ratio
+    // keep them apart whatever the count. Copy 0 carries on from the single oscillator.
+    if (count != unisonVoices) {
+        const float start = unisonVoices > 1 ? unisonPhase[0] : phase;
+
+        for (int voice = 0; voice < count; ++voice)
+            unisonPhase[(size_t) voice] = DspMath::wrapPhase(start + (float) voice * 0.618034f);
+
+        phase = start;
+        unisonVoices = count;
+    }
+
+    // Equal-power sum: uncorrelated copies at 1 / sqrt(count) add up to the level of one.
+    const float level = 1.0f / std::sqrt((float) count);
+    unisonMaxRatio = 1.0f;
+
+    for (int voice = 0; voice < maxUnison; ++voice) {
+        const auto v = (size_t) voice;
+
+        if (voice < count) {
+            const float position = count > 1 ? 2.0f * (float) voice / (float) (count - 1) - 1.0f : 0.0f;
+            float left = 1.0f, right = 1.0f;
+            DspMath::panGains(position * juce::jlimit(0.0f, 1.0f, spread), left, right);
+
+            unisonRatio[v] = std::exp2(position * detune / 1200.0f);
+            unisonLeft[v] = left * level;
+            unisonRight[v] = right * level;
+            unisonMono[v] = level;
+            unisonMaxRatio = juce::jmax(unisonMaxRatio, unisonRatio[v]);
+        }
+        else {
+            // setFrequency() only updates the copies in use, so a dropped copy's increment is cleared here.
+            unisonPhase[v] = 0.0f;
+            unisonIncrement[v] = 0.0f;
+            unisonRatio[v] = 0.0f;
+            unisonLeft[v] = 0.0f;
+            unisonRight[v] = 0.0f;
+            unisonMono[v] = 0.0f;
+        }
+    }
+
+    // Recompute the increments of every copy, and the mip level for the highest one.
+    setFrequency(noteFrequency * pitchBend);
 }
 
 /**
- * Processes the next audio block by applying frequency modulation and oscillator processing.
+ * Switches the oscillator to a multiple of the prepared sample rate, keeping its phases.
  *
- * @param block The audio block to process. This function modifies the block in-place.
+ * @param level The oversampling level; the oscillator renders at 2^level times the prepared rate.
  */
-void OscData::getNextAudioBlock(juce::dsp::AudioBlock<float>& block) {
-    processFmOsc(block); // Apply frequency modulation to the block.
-    process(juce::dsp::ProcessContextReplacing<float>(block)); // Process the block with the current oscillator settings.
+void OscData::setOversamplingLevel(const int level) {
+    oversamplingLevel = level;
+    sampleRate = baseSampleRate * (1 << level);
+
+    // Recompute the FM and carrier increments, and the mip level, for the new rate.
+    setFmParams(fmDepth, fmFrequency);
 }
 
 /**
- * Processes the frequency modulation oscillator.
+ * Chooses the oversampling level for a note. Without modulation the tables are already
+ * band-limited for the base rate, so unmodulated notes never pay for oversampling. With FM,
+ * Carson's rule puts the sidebands of a partial at frequency f out to f + depth + modulator
+ * frequency, and harmonic h swings h times as far as the fundamental. The highest unison copy
+ * sets the frequency. The note needs enough
+ * rate for every harmonic it would have below 20 kHz unmodulated to keep its sidebands under
+ * Nyquist; each level doubles the room.
  *
- * @param block The audio block to which frequency modulation will be applied.
- *              Modifies the audio block by applying FM based on the current settings.
+ * @param frequency The note frequency in Hz.
+ * @param maxLevel The highest level allowed.
+ * @return The level, in [0, maxLevel].
+ */
+int OscData::chooseOversamplingLevel(const float frequency, const int maxLevel) const {
+    if (maxLevel <= 0 || fmDepth <= 0.0f || frequency <= 0.0f)
+        return 0;
+
+    const double nyquist = baseSampleRate * 0.5;
+    const double audibleHarmonics = waveType == WavetableBank::sine ? 1.0
+                                                                    : juce::jmax(1.0, std::floor(juce::jmin(nyquist, 20000.0) / frequency));
+    const double bandwidth = audibleHarmonics * (frequency * unisonMaxRatio + fmDepth) + fmFrequency;
+
+    int level = 0;
+
+    while (level < maxLevel && bandwidth > nyquist * (1 << level))
+        ++level;
+
+    return level;
+}
+
+/**
+ * Renders the oscillator, scales it by the envelope and adds it to the output channels in one
+ * pass. Picks the loop that matches the modulation and channel count.
+ *
+ * @param left The first output channel.
+ * @param right The second output channel, or nullptr if the output is mono.
+ * @param leftGain The gain of the first channel.
+ * @param rightGain The gain of the second channel.
+ * @param envelope The envelope segment covering every sample.
+ * @param numSamples The number of samples to render.
+ */
+void OscData::renderAdding(float* left, float* right, float leftGain, float rightGain,
+                           AdsrData::Segment& envelope, int numSamples) noexcept {
+    // The modulation matrix can move the FM depth away from zero, so its loops always include the modulator.
+    if (modulated) {
+        if (unisonVoices > 1) {
+            if (right != nullptr)
+                renderUnisonWith<true, true, true>(left, right, leftGain, rightGain, envelope, numSamples);
+            else
+                renderUnisonWith<true, false, true>(left, right, leftGain, rightGain, envelope, numSamples);
+        }
+        else if (right != nullptr) {
+            renderAddingWith<true, true, true>(left, right, leftGain, rightGain, envelope, numSamples);
+        }
+        else {
+            renderAddingWith<true, false, true>(left, right, leftGain, rightGain, envelope, numSamples);
+        }
+
+        return;
+    }
+
+    // Without modulation the increment is constant, so skip the modulator entirely.
+    const bool fm = fmDepthIncrement != 0.0f;
+
+    if (unisonVoices > 1) {
+        if (right != nullptr) {
+            if (fm)
+                renderUnisonWith<true, true, false>(left, right, leftGain, rightGain, envelope, numSamples);
+            else
+                renderUnisonWith<false, true, false>(left, right, leftGain, rightGain, envelope, numSamples);
+        }
+        else {
+            if (fm)
+                renderUnisonWith<true, false, false>(left, right, leftGain, rightGain, envelope, numSamples);
+            else
+                renderUnisonWith<false, false, false>(left, right, leftGain, rightGain, envelope, numSamples);
+        }
+    }
+    else if (right != nullptr) {
+        if (fm)
+            renderAddingWith<true, true, false>(left, right, leftGain, rightGain, envelope, numSamples);
+        else
+            renderAddingWith<false, true, false>(left, right, leftGain, rightGain, envelope, numSamples);
+    }
+    else {
+        if (fm)
+            renderAddingWith<true, false, false>(left, right, leftGain, rightGain, envelope, numSamples);
+        else
+            renderAddingWith<false, false, false>(left, right, leftGain, rightGain, envelope, numSamples);
+    }
+}
+
+/**
+ * The fused loop. The phases and the envelope delta are copied into locals first: the output is
+ * also float, so the compiler could not otherwise keep them in registers across the stores. The
+ * same goes for the modulation ramps in the ramped version.
+ */
+template <bool fm, bool stereo, bool ramped>
+void OscData::renderAddingWith(float* left, float* right, float leftGain, float rightGain,
+                               AdsrData::Segment& envelope, int numSamples) noexcept {
+    const float* const wave = table;
+    float carrierPhase = phase;
+    float modulatorPhase = fmPhase;
+    float delta = envelope.delta;
+    const float offset = envelope.offset;
+    const float coefficient = envelope.coefficient;
+    const float rate = envelope.rate;
+
+    float pitch = pitchRamp.value;
+    float depth = fmDepthIncrement + depthRamp.value;
+    float fmRatio = fmRatioRamp.value;
+    float leftLevel = leftRamp.value;
+    float rightLevel = rightRamp.value;
+
+    for (int s = 0; s < numSamples; ++s) {
+        const float sample = WavetableBank::read(wave, carrierPhase) * (offset + delta);
+        delta = delta * coefficient + rate;
+
+        if constexpr (ramped) {
+            left[s] += sample * leftGain * leftLevel;
+
+            if constexpr (stereo)
+                right[s] += sample * rightGain * rightLevel;
+
+            leftLevel += leftRamp.step;
+            rightLevel += rightRamp.step;
+
+            carrierPhase = DspMath::wrapSignedPhase(carrierPhase + phaseIncrement * pitch + DspMath::sinCycle(modulatorPhase) * depth);
+
+            modulatorPhase += fmIncrement * fmRatio;
+            if (modulatorPhase >= 1.0f)
+                modulatorPhase -= 1.0f;
+
+            pitch += pitchRamp.step;
+            depth += depthRamp.step;
+            fmRatio += fmRatioRamp.step;
+            continue;
+        }
+
+        left[s] += sample * leftGain;
+
+        if constexpr (stereo)
+            right[s] += sample * rightGain;
+
+        if constexpr (fm) {
+            // Deep modulation can push the instantaneous frequency below zero, so wrap both ways.
+            carrierPhase = DspMath::wrapSignedPhase(carrierPhase + phaseIncrement + DspMath::sinCycle(modulatorPhase) * fmDepthIncrement);
+
+            modulatorPhase += fmIncrement;
+            if (modulatorPhase >= 1.0f)
+                modulatorPhase -= 1.0f;
+        }
+        else {
+            carrierPhase += phaseIncrement;
+            if (carrierPhase >= 1.0f)
+                carrierPhase -= 1.0f;
+        }
+    }
+
+    phase = carrierPhase;
+    fmPhase = modulatorPhase;
+    envelope.delta = delta;
+
+    if constexpr (ramped) {
+        pitchRamp.value = pitch;
+        depthRamp.value = depth - fmDepthIncrement;
+        fmRatioRamp.value = fmRatio;
+        leftRamp.value = leftLevel;
+        rightRamp.value = rightLevel;
+    }
+}
+
+/**
+ * The unison loop. Copies are processed one SIMD register at a time, each register running
+ * through the whole range; the envelope, the modulator and the modulation ramps are scalar and
+ * shared, so every register replays them from the same starting point. With 8 copies or fewer
+ * and AVX that is a single pass. Builds without SIMD support run the same loop one copy at a time.
  */
-void OscData::processFmOsc(juce::dsp::AudioBlock<float>& block) {
-    for (int ch = 0; ch < block.getNumChannels(); ++ch) {
-        for (int s = 0; s < block.getNumSamples(); ++s) {
-            // Apply frequency modulation to each sample
-            fmMod = fmOsc.processSample(block.getSample(ch, s)) * fmDepth;
+template <bool fm, bool stereo, bool ramped>
+void OscData::renderUnisonWith(float* left, float* right, float leftGain, float rightGain,
+                               AdsrData::Segment& envelope, int numSamples) noexcept {
+    const float* const wave = table;
+    const float offset = envelope.offset;
+    const float coefficient = envelope.coefficient;
+    const float rate = envelope.rate;
+    float endModulatorPhase = fmPhase;
+    float endDelta = envelope.delta;
+    Ramp endPitch = pitchRamp, endDepth = depthRamp, endFmRatio = fmRatioRamp, endLeft = leftRamp, endRight = rightRamp;
+
+#if JUCE_USE_SIMD
+    using Vec = juce::dsp::SIMDRegister<float>;
+    constexpr int width = (int) Vec::SIMDNumElements;
+    static_assert(maxUnison % width == 0, "Unison voices must fill a whole number of SIMD registers");
+
+    const Vec zero = Vec::expand(0.0f);
+    const Vec one = Vec::expand(1.0f);
+
+    alignas(64) float phases[width];
+    alignas(64) float samples[width];
+
+    for (int first = 0; first < unisonVoices; first += width) {
+        Vec voicePhase = Vec::fromRawArray(unisonPhase.data() + first);
+        const Vec voiceIncrement = Vec::fromRawArray(unisonIncrement.data() + first);
+        const Vec voiceLeft = Vec::fromRawArray((stereo ? unisonLeft.data() : unisonMono.data()) + first);
+        const Vec voiceRight = Vec::fromRawArray(unisonRight.data() + first);
+        float modulatorPhase = fmPhase;
+        float delta = envelope.delta;
+        float pitch = pitchRamp.value;
+        float depth = fmDepthIncrement + depthRamp.value;
+        float fmRatio = fmRatioRamp.value;
+        float leftLevel = leftRamp.value;
+        float rightLevel = rightRamp.value;
+
+        for (int s = 0; s < numSamples; ++s) {
+            // Every copy reads the same table, but at its own position, so the reads are gathered one by one.
+            voicePhase.copyToRawArray(phases);
+
+            for (int i = 0; i < width; ++i)
+                samples[i] = WavetableBank::read(wave, phases[i]);
+
+            const Vec voices = Vec::fromRawArray(samples);
+            const float level = offset + delta;
+            delta = delta * coefficient + rate;
+
+            if constexpr (ramped) {
+                left[s] += (voices * voiceLeft).sum() * level * leftGain * leftLevel;
+
+                if constexpr (stereo)
+                    right[s] += (voices * voiceRight).sum() * level * rightGain * rightLevel;
+
+                leftLevel += leftRamp.step;
+                rightLevel += rightRamp.step;
+
+                const float modulation = DspMath::sinCycle(modulatorPhase) * depth;
+                modulatorPhase += fmIncrement * fmRatio;
+                if (modulatorPhase >= 1.0f)
+                    modulatorPhase -= 1.0f;
+
+                voicePhase = voicePhase + voiceIncrement * pitch + modulation;
+                voicePhase = voicePhase - (one & Vec::greaterThanOrEqual(voicePhase, one))
+                                        + (one & Vec::lessThan(voicePhase, zero));
+                voicePhase = voicePhase - (voicePhase & Vec::greaterThanOrEqual(voicePhase, one));
+
+                pitch += pitchRamp.step;
+                depth += depthRamp.step;
+                fmRatio += fmRatioRamp.step;
+                continue;
+            }
+
+            left[s] += (voices * voiceLeft).sum() * level * leftGain;
+
+            if constexpr (stereo)
+                right[s] += (voices * voiceRight).sum() * level * rightGain;
+
+            if constexpr (fm) {
+                const float modulation = DspMath::sinCycle(modulatorPhase) * fmDepthIncrement;
+                modulatorPhase += fmIncrement;
+                if (modulatorPhase >= 1.0f)
+                    modulatorPhase -= 1.0f;
+
+                voicePhase = voicePhase + voiceIncrement + modulation;
+                voicePhase = voicePhase - (one & Vec::greaterThanOrEqual(voicePhase, one))
+                                        + (one & Vec::lessThan(voicePhase, zero));
+                voicePhase = voicePhase - (voicePhase & Vec::greaterThanOrEqual(voicePhase, one));
+            }
+            else {
+                voicePhase = voicePhase + voiceIncrement;
+                voicePhase = voicePhase - (one & Vec::greaterThanOrEqual(voicePhase, one));
+            }
         }
+
+        voicePhase.copyToRawArray(unisonPhase.data() + first);
+        endModulatorPhase = modulatorPhase;
+        endDelta = delta;
+        endPitch.value = pitch;
+        endDepth.value = depth - fmDepthIncrement;
+        endFmRatio.value = fmRatio;
+        endLeft.value = leftLevel;
+        endRight.value = rightLevel;
+    }
+#else
+    for (int voice = 0; voice < unisonVoices; ++voice) {
+        const auto v = (size_t) voice;
+        const float voiceLeft = stereo ? unisonLeft[v] : unisonMono[v];
+        const float voiceRight = unisonRight[v];
+        float voicePhase = unisonPhase[v];
+        float modulatorPhase = fmPhase;
+        float delta = envelope.delta;
+        float pitch = pitchRamp.value;
+        float depth = fmDepthIncrement + depthRamp.value;
+        float fmRatio = fmRatioRamp.value;
+        float leftLevel = leftRamp.value;
+        float rightLevel = rightRamp.value;
+
+        for (int s = 0; s < numSamples; ++s) {
+            const float sample = WavetableBank::read(wave, voicePhase) * (offset + delta);
+            delta = delta * coefficient + rate;
+
+            if constexpr (ramped) {
+                left[s] += sample * voiceLeft * leftGain * leftLevel;
+
+                if constexpr (stereo)
+                    right[s] += sample * voiceRight * rightGain * rightLevel;
+
+                leftLevel += leftRamp.step;
+                rightLevel += rightRamp.step;
+
+                voicePhase = DspMath::wrapSignedPhase(voicePhase + unisonIncrement[v] * pitch + DspMath::sinCycle(modulatorPhase) * depth);
+
+                modulatorPhase += fmIncrement * fmRatio;
+                if (modulatorPhase >= 1.0f)
+                    modulatorPhase -= 1.0f;
+
+                pitch += pitchRamp.step;
+                depth += depthRamp.step;
+                fmRatio += fmRatioRamp.step;
+                continue;
+            }
+
+            left[s] += sample * voiceLeft * leftGain;
+
+            if constexpr (stereo)
+                right[s] += sample * voiceRight * rightGain;
+
+            if constexpr (fm) {
+                voicePhase = DspMath::wrapSignedPhase(voicePhase + unisonIncrement[v] + DspMath::sinCycle(modulatorPhase) * fmDepthIncrement);
+
+                modulatorPhase += fmIncrement;
+                if (modulatorPhase >= 1.0f)
+                    modulatorPhase -= 1.0f;
+            }
+            else {
+                voicePhase += unisonIncrement[v];
+                if (voicePhase >= 1.0f)
+                    voicePhase -= 1.0f;
+            }
+        }
+
+        unisonPhase[v] = voicePhase;
+        endModulatorPhase = modulatorPhase;
+        endDelta = delta;
+        endPitch.value = pitch;
+        endDepth.value = depth - fmDepthIncrement;
+        endFmRatio.value = fmRatio;
+        endLeft.value = leftLevel;
+        endRight.value = rightLevel;
+    }
+#endif
+
+    fmPhase = endModulatorPhase;
+    envelope.delta = endDelta;
+
+    if constexpr (ramped) {
+        pitchRamp = endPitch;
+        depthRamp = endDepth;
+        fmRatioRamp = endFmRatio;
+        leftRamp = endLeft;
+        rightRamp = endRight;
     }
 }
 
 /**
- * Sets the parameters for frequency modulation including depth and frequency.
+ * Sets the parameters for frequency modulation including depth and frequency. Only needs to be
+ * called when one of them changes; the modulation itself is applied sample by sample in renderAdding.
  *
- * @param depth The depth of frequency modulation, affecting how much the base frequency is altered.
+ * @param depth The depth of frequency modulation in Hz, i.e. how far the carrier frequency swings either way.
  * @param freq The frequency of the modulation oscillator.
  */
 void OscData::setFmParams(const float depth, const float freq) {
-    fmOsc.setFrequency(freq); // Set the frequency of the modulation oscillator.
-    fmDepth = depth; // Set the depth of frequency modulation.
-    // Recalculate the frequency of the base oscillator to incorporate current frequency modulation.
-    auto currentFreq = juce::MidiMessage::getMidiNoteInHertz(lastMidiNote) + fmMod;
-    setFrequency(currentFreq >= 0 ? currentFreq : currentFreq * -1.0f);
+    fmDepth = depth;
+    fmFrequency = freq;
+    fmDepthIncrement = (float) (depth / sampleRate);
+    fmIncrement = (float) (freq / sampleRate);
+
+    // The highest instantaneous frequency depends on the depth, so pick the mip level again.
+    setFrequency(noteFrequency * pitchBend);
+}
+
+/**
+ * Sets the carrier frequency, converting it into a phase increment for the oscillator and each
+ * unison copy, and selecting the mip level with as many harmonics as fit below Nyquist at the
+ * highest frequency the modulation can reach.
+ *
+ * @param frequency The oscillator frequency in Hz.
+ */
+void OscData::setFrequency(const float frequency) {
+    phaseIncrement = juce::jlimit(0.0f, 0.5f, (float) (frequency / sampleRate));
+
+    // Every unison copy shares the table, so it must suit the highest of them.
+    for (int voice = 0; voice < unisonVoices; ++voice)
+        unisonIncrement[(size_t) voice] = juce::jlimit(0.0f, 0.5f, (float) (frequency * unisonRatio[(size_t) voice] / sampleRate));
+
+    selectTable();
+}
+
+/**
+ * Picks the mip level for the highest copy. While the modulation matrix is ramping, the level
+ * covers both ends of the ramp, so the table stays band-limited all the way through it.
+ */
+void OscData::selectTable() {
+    const float highestIncrement = unisonVoices > 1 ? phaseIncrement * unisonMaxRatio : phaseIncrement;
+    const float pitch = juce::jmax(pitchRamp.value, pitchRamp.end);
+    const float depth = juce::jmax(0.0f, depthRamp.value, depthRamp.end);
+
+    tableLevel = WavetableBank::getLevelForIncrement(juce::jmin(0.5f, highestIncrement * pitch) + fmDepthIncrement + depth);
+    table = wavetables->getTable(waveType, tableLevel);
+}
+
+/**
+ * Starts the next control-rate ramp. The values are limited here rather than in the render loops:
+ * the highest copy stays below Nyquist, the FM depth stays between zero and half a cycle per sample
+ * so the phases still wrap in one step, and the modulator stays below Nyquist.
+ *
+ * @param target The modulation at the end of the ramp.
+ * @param numSamples The length of the ramp in samples.
+ */
+void OscData::rampModulation(const Modulation& target, const int numSamples) {
+    const bool neutral = target.pitchRatio == 1.0f && target.fmDepth == 0.0f && target.fmFrequencyRatio == 1.0f
+                      && target.leftLevel == 1.0f && target.rightLevel == 1.0f;
+
+    // The previous ramp has already brought everything back, so render without modulation again.
+    if (neutral && pitchRamp.end == 1.0f && depthRamp.end == 0.0f && fmRatioRamp.end == 1.0f
+        && leftRamp.end == 1.0f && rightRamp.end == 1.0f) {
+        resetModulation();
+        return;
+    }
+
+    const float highestIncrement = unisonVoices > 1 ? phaseIncrement * unisonMaxRatio : phaseIncrement;
+    const float maxPitch = highestIncrement > 0.0f ? 0.5f / highestIncrement : 1.0f;
+    const float maxFmRatio = fmIncrement > 0.0f ? 0.5f / fmIncrement : 1.0f;
+    const float scale = 1.0f / (float) juce::jmax(1, numSamples);
+
+    pitchRamp.moveTo(juce::jlimit(0.0f, maxPitch, target.pitchRatio), scale);
+    depthRamp.moveTo(juce::jlimit(-fmDepthIncrement, 0.5f - fmDepthIncrement, (float) (target.fmDepth / sampleRate)), scale);
+    fmRatioRamp.moveTo(juce::jlimit(0.0f, maxFmRatio, target.fmFrequencyRatio), scale);
+    leftRamp.moveTo(target.leftLevel, scale);
+    rightRamp.moveTo(target.rightLevel, scale);
+    modulated = true;
+
+    selectTable();
+}
+
+void OscData::resetModulation() {
+    pitchRamp.set(1.0f);
+    depthRamp.set(0.0f);
+    fmRatioRamp.set(1.0f);
+    leftRamp.set(1.0f);
+    rightRamp.set(1.0f);
+
+    if (modulated) {
+        modulated = false;
+        selectTable();
+    }
 }
\ No newline at end of file
@@ -11,15 +11,51 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include <array>
+#include "WavetableBank.h"
+#include "DspMath.h"
+#include "AdsrData.h"
 
 /**
- * OscData class extends juce::dsp::Oscillator to provide additional functionalities
- * for audio synthesis, including waveform type selection, frequency modulation, and
- * integration with MIDI note frequencies.
+ * OscData is a wavetable oscillator that reads the band-limited tables in the shared
+ * WavetableBank with linear interpolation. It provides waveform type selection, frequency
+ * modulation, and integration with MIDI note frequencies. The mip level is picked whenever
+ * the frequency changes, so notes in every octave stay free of aliasing.
+ *
+ * Frequency modulation runs at audio rate: a sine modulator is evaluated for every sample
+ * of the block and added to the carrier's phase increment, so the result does not depend
+ * on the host's buffer size.
+ *
+ * The oscillator renders through one fused loop that also applies the voice's gain and
+ * envelope and adds the result to the output, so a voice never writes an intermediate buffer.
+ *
+ * A note can render at 2x, 4x or 8x the prepared rate when its FM would otherwise need more
+ * bandwidth than the base rate has; the voice's output is then decimated by OversampledMix.
+ *
+ * In unison mode the oscillator plays up to maxUnison detuned copies of itself, spread across
+ * the stereo field. Their phases, increments and pan gains are packed in aligned arrays, so a
+ * SIMD register advances juce::dsp::SIMDRegister<float>::size() copies at once and the whole
+ * stack shares one envelope, one modulator and one table.
+ *
+ * The modulation matrix moves the pitch, the FM depth and frequency and the channel levels at
+ * control rate. Each control point starts a linear ramp to the new values, which the render
+ * loops step through sample by sample, so the matrix never causes zipper noise.
  */
-class OscData : public juce::dsp::Oscillator<float> {
+class OscData {
 
 public:
+    /** The largest number of unison voices. */
+    static constexpr int maxUnison = 16;
+
+    /** The values the modulation matrix applies on top of the oscillator's settings. */
+    struct Modulation {
+        float pitchRatio{ 1.0f };        ///< Multiplies the frequency of every copy.
+        float fmDepth{ 0.0f };           ///< Added to the FM depth, in Hz.
+        float fmFrequencyRatio{ 1.0f };  ///< Multiplies the frequency of the modulator.
+        float leftLevel{ 1.0f };         ///< Multiplies the gain of the first channel.
+        float rightLevel{ 1.0f };        ///< Multiplies the gain of the second channel.
+    };
+
     /**
      * Prepares the oscillator for playback. This must be called before using the oscillator
      * in an audio processing context.
@@ -29,18 +65,34 @@ public:
     void prepareToPlay(juce::dsp::ProcessSpec& spec);
 
     /**
-     * Processes the next block of audio samples, applying frequency modulation and waveform generation.
+     * Renders the next samples of the oscillator and adds them to the output. Each sample is
+     * read from the table, scaled by the envelope and added to the channels in a single loop,
+     * with all of the state kept in registers.
+     *
+     * @param left The first output channel.
+     * @param right The second output channel, or nullptr if the output is mono.
+     * @param leftGain The gain of the first channel, including the voice's level and pan.
+     * @param rightGain The gain of the second channel, ignored if right is nullptr.
+     * @param envelope The envelope segment covering every sample; its delta is advanced through them.
+     * @param numSamples The number of samples to render.
+     */
+    void renderAdding(float* left, float* right, float leftGain, float rightGain,
+                      AdsrData::Segment& envelope, int numSamples) noexcept;
+
+    /**
+     * Sets the frequency of a new note, as looked up in the tuning table.
      *
-     * @param block The audio block that will be processed and modified by the oscillator.
+     * @param frequency The note frequency in Hz, before pitch bend.
      */
-    void getNextAudioBlock(juce::dsp::AudioBlock<float>& block);
+    void setWaveFrequency(const float frequency);
 
     /**
-     * Sets the frequency of the oscillator based on a MIDI note number.
+     * Bends the note by a frequency ratio. Only a multiply and a division, so it is cheap enough
+     * for every pitch wheel message.
      *
-     * @param midiNoteNumber The MIDI note number which is converted to a frequency in Hz.
+     * @param ratio The ratio applied to the note frequency; 1 for no bend.
      */
-    void setWaveFrequency(const int midiNoteNumber);
+    void setPitchBend(const float ratio);
 
     /**
      * Sets the waveform type of the oscillator based on a given choice.
@@ -51,24 +103,182 @@ public:
 
     /**
      * Sets the parameters for frequency modulation, influencing the timbre and characteristics of the produced sound.
+     * Only needs to be called when the parameters change.
      *
      * @param depth The depth of the frequency modulation.
      * @param freq The frequency at which the modulation oscillator operates.
      */
     void setFmParams(const float depth, const float freq);
 
+    /**
+     * Sets the unison stack. The copies are detuned evenly between -detune and +detune cents and
+     * panned evenly between the two sides of the spread, with their level scaled so that the
+     * stack is about as loud as a single oscillator. Copies keep their phases unless the count
+     * changes, in which case each starts at its own offset so they do not begin in step.
+     *
+     * @param voices The number of copies, from 1 (unison off) to maxUnison.
+     * @param detune The detune of the outermost copies, in cents.
+     * @param spread The stereo width of the stack, from 0 for centred to 1 for hard left and right.
+     */
+    void setUnison(const int voices, const float detune, const float spread);
+
+    /**
+     * Returns the number of unison copies the oscillator plays.
+     */
+    int getUnisonVoices() const { return unisonVoices; }
+
+    /**
+     * Returns the frequency of the last MIDI note in Hz, before any modulation.
+     */
+    float getNoteFrequency() const { return noteFrequency; }
+
+    /**
+     * Returns the frequency the oscillator plays in Hz: the note bent by the pitch wheel, before FM.
+     */
+    float getFrequency() const { return noteFrequency * pitchBend; }
+
+    /**
+     * Returns the read position of the carrier within its cycle, in [0, 1).
+     */
+    float getPhase() const { return phase; }
+
+    /**
+     * Returns the phase of the FM modulator, in [0, 1).
+     */
+    float getFmPhase() const { return fmPhase; }
+
+    /**
+     * Moves the carrier and the FM modulator to given phases, so a note taken over from the voice
+     * bank carries on without a jump. Unison copies keep their own phases.
+     *
+     * @param newPhase The carrier phase, in [0, 1).
+     * @param newFmPhase The modulator phase, in [0, 1).
+     */
+    void setPhases(const float newPhase, const float newFmPhase);
+
+    /**
+     * Renders at 2^level times the prepared sample rate from now on. The phases carry on, and the
+     * increments and mip level are recomputed for the new rate, so the oscillator keeps more
+     * harmonics and its FM sidebands can rise above the base Nyquist frequency without folding back.
+     *
+     * @param level The oversampling level, 0 for the prepared rate.
+     */
+    void setOversamplingLevel(const int level);
+
+    /**
+     * Starts a linear ramp from the values the previous ramp was heading for to a new set of
+     * modulation values. renderAdding() steps the ramp on every sample, so the caller renders
+     * exactly numSamples before starting the next one. When a ramp back to no modulation has
+     * completed, the next call ends modulated rendering. The pitch and the modulator are limited
+     * so that nothing runs above Nyquist.
+     *
+     * @param target The values at the end of the ramp.
+     * @param numSamples The length of the ramp, at the oscillator's rate.
+     */
+    void rampModulation(const Modulation& target, const int numSamples);
+
+    /** Stops any modulation straight away, as at the start of a note. */
+    void resetModulation();
+
+    /** Returns true while the modulation matrix moves the oscillator away from its settings. */
+    bool isModulated() const { return modulated; }
+
+    /**
+     * Returns the oversampling level the oscillator renders at.
+     */
+    int getOversamplingLevel() const { return oversamplingLevel; }
+
+    /**
+     * Chooses the lowest oversampling level at which a note keeps its audible content with the
+     * current waveform and FM settings. See the definition for the rule.
+     *
+     * @param frequency The note frequency in Hz.
+     * @param maxLevel The highest level allowed; 0 always returns 0.
+     */
+    int chooseOversamplingLevel(const float frequency, const int maxLevel) const;
+
 private:
+    /** A value that moves by a fixed step every sample, towards the end of the current ramp. */
+    struct Ramp {
+        float value{ 0.0f };   ///< The value at the next sample.
+        float step{ 0.0f };    ///< Added to value after every sample.
+        float end{ 0.0f };     ///< The value the ramp is heading for.
+
+        /** Starts a ramp from the end of the previous one, so rounding never accumulates. */
+        void moveTo(float target, float scale) noexcept {
+            value = end;
+            step = (target - end) * scale;
+            end = target;
+        }
+
+        /** Jumps to a value and stays there. */
+        void set(float target) noexcept {
+            value = end = target;
+            step = 0.0f;
+        }
+    };
+
+    /**
+     * The body of renderAdding(), compiled once for each combination of FM, channel count and
+     * modulation ramp so the loop itself never branches on them. Ramped loops always include FM.
+     */
+    template <bool fm, bool stereo, bool ramped>
+    void renderAddingWith(float* left, float* right, float leftGain, float rightGain,
+                          AdsrData::Segment& envelope, int numSamples) noexcept;
+
     /**
-     * Processes frequency modulation for an audio block, affecting the pitch based on the modulation depth and frequency.
+     * The unison version of renderAddingWith(): every copy is read, panned and summed, then the
+     * sum is scaled by the envelope and added to the output.
+     */
+    template <bool fm, bool stereo, bool ramped>
+    void renderUnisonWith(float* left, float* right, float leftGain, float rightGain,
+                          AdsrData::Segment& envelope, int numSamples) noexcept;
+
+    /** Picks the mip level for the highest increment any copy reaches, modulation included. */
+    void selectTable();
+
+    /**
+     * Sets the carrier frequency and picks the matching mip level of the current waveform.
      *
-     * @param block The audio block that will receive the frequency modulation effects.
+     * @param frequency The oscillator frequency in Hz.
      */
-    void processFmOsc(juce::dsp::AudioBlock<float>& block);
+    void setFrequency(const float frequency);
+
+    juce::SharedResourcePointer<WavetableBank> wavetables; // Band-limited tables shared by every voice.
+    const float* table{ nullptr }; // The mip level currently being read.
+    int waveType{ WavetableBank::sine }; // The selected waveform.
+    int tableLevel{ 0 }; // The mip level selected for the current frequency.
+    float phase{ 0.0f }; // Read position within the cycle, in [0, 1).
+    float phaseIncrement{ 0.0f }; // Cycles advanced per sample without modulation.
+    double sampleRate{ 44100.0 }; // Sample rate used to convert frequencies into increments.
+    double baseSampleRate{ 44100.0 }; // The prepared sample rate, before oversampling.
+    int oversamplingLevel{ 0 }; // The oscillator renders at baseSampleRate * 2^oversamplingLevel.
+
+    float fmPhase{ 0.0f }; // Phase of the sine modulator, in [0, 1).
+    float fmIncrement{ 0.0f }; // Cycles the modulator advances per sample.
+    float fmDepth{ 0.0f }; // Depth of frequency modulation in Hz.
+    float fmFrequency{ 0.0f }; // Frequency of the modulator in Hz.
+    float fmDepthIncrement{ 0.0f }; // Depth of frequency modulation in cycles per sample.
+    float noteFrequency{ 0.0f }; // Frequency of the last MIDI note in Hz, from the tuning table.
+    float pitchBend{ 1.0f }; // Frequency ratio of the pitch wheel.
 
-    juce::dsp::Oscillator<float> fmOsc{ [](float x) {return std::sin(x); } }; // The oscillator used for frequency modulation.
+    // Unison state, one entry per copy. Entries from unisonVoices on have no increment and no
+    // gain, so a SIMD register reaching past the last copy adds nothing.
+    alignas(64) std::array<float, maxUnison> unisonPhase{}; // Read position of each copy, in [0, 1).
+    alignas(64) std::array<float, maxUnison> unisonIncrement{}; // Cycles each copy advances per sample without modulation.
+    alignas(64) std::array<float, maxUnison> unisonRatio{}; // Frequency of each copy relative to the note.
+    alignas(64) std::array<float, maxUnison> unisonLeft{}; // Gain of each copy in the left channel.
+    alignas(64) std::array<float, maxUnison> unisonRight{}; // Gain of each copy in the right channel.
+    alignas(64) std::array<float, maxUnison> unisonMono{}; // Gain of each copy when the output is mono.
+    int unisonVoices{ 1 }; // Number of copies; 1 renders through the single-oscillator loop.
+    float unisonMaxRatio{ 1.0f }; // Ratio of the highest copy, which decides the mip level.
 
-    float fmMod{ 0.0f }; // Current frequency modulation value.
-    float fmDepth{ 0.0f }; // Depth of frequency modulation.
-    int lastMidiNote{ 0 }; // Last MIDI note received, used to calculate frequency changes.
+    // Modulation matrix state, ramped from one control point to the next.
+    Ramp pitchRamp{ 1.0f, 0.0f, 1.0f }; // Ratio applied to every increment.
+    Ramp depthRamp; // Added to fmDepthIncrement, in cycles per sample.
+    Ramp fmRatioRamp{ 1.0f, 0.0f, 1.0f }; // Ratio applied to fmIncrement.
+    Ramp leftRamp{ 1.0f, 0.0f, 1.0f }; // Multiplies the gain of the first channel.
+    Ramp rightRamp{ 1.0f, 0.0f, 1.0f }; // Multiplies the gain of the second channel.
+    bool modulated{ false }; // Whether renderAdding() runs the ramped loops.
 
 };
\ No newline at end of file
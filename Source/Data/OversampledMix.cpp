@@ -0,0 +1,143 @@
+/*
+  ==============================================================================
+
+    OversampledMix.cpp
+    Implements the oversampled buses, the decimation cascade and the delays
+    that keep every level aligned.
+
+  ==============================================================================
+*/
+
+#include "OversampledMix.h"
+
+// Each level's delay is halved when counted at the level below, so it must stay even.
+static_assert(HalfbandDecimator::latency % (1 << (OversampledMix::maxLevel - 1)) == 0,
+              "The filter latency must keep the delay of every level a whole number of samples");
+
+void OversampledMix::prepare(int newNumChannels, int maxBlockSize) {
+    numChannels = juce::jlimit(1, maxChannels, newNumChannels);
+    decimators.clear();
+
+    for (int level = 0; level <= maxLevel; ++level) {
+        buses[(size_t) level].setSize(numChannels, level > 0 ? maxBlockSize << level : 0);
+        delayLines[(size_t) level].setSize(numChannels, juce::jmax(1, getDelay(level)));
+
+        for (int channel = 0; level > 0 && channel < numChannels; ++channel)
+            decimators.add(new HalfbandDecimator())->prepare(maxBlockSize << level);
+    }
+
+    reset();
+}
+
+void OversampledMix::reset() noexcept {
+    for (int level = 0; level <= maxLevel; ++level) {
+        buses[(size_t) level].clear();
+        delayLines[(size_t) level].clear();
+        delayPositions[(size_t) level] = 0;
+        used[(size_t) level] = false;
+        tailLeft[(size_t) level] = 0;
+    }
+
+    for (auto* decimator : decimators)
+        decimator->reset();
+}
+
+void OversampledMix::setLatencyCompensated(bool shouldCompensate) noexcept {
+    if (shouldCompensate != latencyCompensated) {
+        latencyCompensated = shouldCompensate;
+        delayLines[0].clear();
+        delayPositions[0] = 0;
+    }
+}
+
+juce::AudioBuffer<float>& OversampledMix::getBus(int level, int numSamples) noexcept {
+    jassert(level > 0 && level <= maxLevel && (numSamples << level) <= buses[(size_t) level].getNumSamples());
+
+    auto& bus = buses[(size_t) level];
+
+    if (!used[(size_t) level]) {
+        bus.clear(0, numSamples << level);
+        used[(size_t) level] = true;
+    }
+
+    return bus;
+}
+
+//==============================================================================
+// Runs the cascade from the highest level with anything in it down to the output.
+void OversampledMix::addTo(juce::AudioBuffer<float>& output, int startSample, int numSamples) noexcept {
+    int top = 0;
+
+    for (int level = 1; level <= maxLevel; ++level)
+        if (used[(size_t) level] || tailLeft[(size_t) level] > 0)
+            top = level;
+
+    const int outputChannels = juce::jmin(numChannels, output.getNumChannels());
+
+    for (int level = top; level >= 0; --level) {
+        const int length = numSamples << level;
+        float* channels[maxChannels]{};
+
+        if (level > 0) {
+            // Clears the bus if no voice of this level rendered, since it still carries the levels above.
+            auto& bus = getBus(level, numSamples);
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                channels[channel] = bus.getWritePointer(channel);
+        }
+        else {
+            for (int channel = 0; channel < outputChannels; ++channel)
+                channels[channel] = output.getWritePointer(channel, startSample);
+        }
+
+        const int count = level > 0 ? numChannels : outputChannels;
+
+        // Line this level's own signal up with what arrives from above, then add that.
+        if (getDelay(level) > 0 && (level > 0 || latencyCompensated))
+            delay(level, channels, count, length);
+
+        if (level < top) {
+            const auto& above = buses[(size_t) level + 1];
+
+            for (int channel = 0; channel < count; ++channel)
+                decimators[level * numChannels + channel]->processAdding(above.getReadPointer(channel), channels[channel], length);
+        }
+    }
+
+    for (int level = 1; level <= maxLevel; ++level) {
+        tailLeft[(size_t) level] = used[(size_t) level] ? getTailLength() : juce::jmax(0, tailLeft[(size_t) level] - numSamples);
+        used[(size_t) level] = false;
+    }
+}
+
+// The output delay holds the last samples of the voices that rendered straight into the output,
+// which only the delay line itself knows about.
+bool OversampledMix::isSilent() const noexcept {
+    for (int level = 1; level <= maxLevel; ++level)
+        if (used[(size_t) level] || tailLeft[(size_t) level] > 0)
+            return false;
+
+    return !latencyCompensated || delayLines[0].getMagnitude(0, getDelay(0)) == 0.0f;
+}
+
+// Swaps each sample with the one stored getDelay(level) samples ago.
+void OversampledMix::delay(int level, float* const* channels, int count, int numSamples) noexcept {
+    auto& line = delayLines[(size_t) level];
+    const int length = getDelay(level);
+    const int start = delayPositions[(size_t) level];
+
+    for (int channel = 0; channel < count; ++channel) {
+        float* samples = channels[channel];
+        float* stored = line.getWritePointer(channel);
+        int position = start;
+
+        for (int i = 0; i < numSamples; ++i) {
+            std::swap(samples[i], stored[position]);
+
+            if (++position == length)
+                position = 0;
+        }
+    }
+
+    delayPositions[(size_t) level] = (start + numSamples) % length;
+}
\ No newline at end of file
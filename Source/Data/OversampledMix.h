@@ -0,0 +1,115 @@
+/*
+  ==============================================================================
+
+    OversampledMix.h
+    Mix buses at 2x, 4x and 8x the sample rate for voices that render
+    oversampled, decimated into the output with a constant latency.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include "HalfbandDecimator.h"
+
+/**
+ * OversampledMix collects voices that render above the host's sample rate. Level k holds the
+ * mix at 2^k times the rate; every voice adds itself to the bus of its own level, so the cost
+ * of filtering is paid once per bus rather than once per voice. At the end of each block the
+ * buses are decimated in a cascade, 8x into 4x into 2x into the output, one HalfbandDecimator
+ * per stage and channel.
+ *
+ * Signals that enter the cascade at different levels pass through different numbers of
+ * filters, so each level's own signal is delayed until it lines up with what arrives from the
+ * level above. The delays are whole samples at every level, so voices at every rate, including
+ * those written straight to the output, come out with the same latency of getLatency() samples.
+ *
+ * Buses that received no voice and whose filters have run dry are skipped, so a block in which
+ * every voice renders at the base rate costs no more than the output's alignment delay.
+ */
+class OversampledMix {
+
+public:
+    /** The highest level: buses run at up to 2^maxLevel times the sample rate. */
+    static constexpr int maxLevel = 3;
+
+    /** The largest number of channels. */
+    static constexpr int maxChannels = 2;
+
+    /** Returns the delay added to the output while latency compensation is on, in samples at the base rate. */
+    static constexpr int getLatency() noexcept { return getDelay(0); }
+
+    /**
+     * Allocates the buses and filters and clears them. Must not be called from the audio thread.
+     *
+     * @param numChannels The number of output channels, at most maxChannels.
+     * @param maxBlockSize The largest number of base-rate samples per block.
+     */
+    void prepare(int numChannels, int maxBlockSize);
+
+    /** Clears every bus, filter and delay. */
+    void reset() noexcept;
+
+    /**
+     * Chooses whether signals written straight to the output are delayed to line up with the
+     * oversampled ones. Turning it off removes the latency, but oversampled voices then lag
+     * the others.
+     *
+     * @param shouldCompensate True to delay the output by getLatency() samples.
+     */
+    void setLatencyCompensated(bool shouldCompensate) noexcept;
+
+    /**
+     * Returns the bus of a level for the current block, cleared on first use in the block.
+     * Voices of that level render numSamples << level samples into it, starting at sample 0.
+     *
+     * @param level The oversampling level, in [1, maxLevel].
+     * @param numSamples The length of the block at the base rate, at most the prepared block size.
+     */
+    juce::AudioBuffer<float>& getBus(int level, int numSamples) noexcept;
+
+    /**
+     * Ends the block: delays what the output already holds if compensating, then decimates the
+     * buses that are in use and adds the result.
+     *
+     * @param output The buffer the base-rate voices were rendered into.
+     * @param startSample The first sample of the block in the output.
+     * @param numSamples The length of the block.
+     */
+    void addTo(juce::AudioBuffer<float>& output, int startSample, int numSamples) noexcept;
+
+    /**
+     * Returns true once nothing is left in the buses, the filters or the output delay, so
+     * blocks without voices would add nothing and need not be run.
+     */
+    bool isSilent() const noexcept;
+
+private:
+    /**
+     * Returns the delay applied to a level's own signal, in samples at that level's rate. A level
+     * receives the level above after one decimation stage, which adds the filter's latency to the
+     * delay the level above already had, now counted at half the rate.
+     */
+    static constexpr int getDelay(int level) noexcept {
+        return level >= maxLevel ? 0 : HalfbandDecimator::latency + getDelay(level + 1) / 2;
+    }
+
+    /** Delays numSamples of every channel in place through a level's delay line. */
+    void delay(int level, float* const* channels, int count, int numSamples) noexcept;
+
+    /** Returns the base-rate samples after a level's last voice until its filters and delays hold only silence. */
+    static constexpr int getTailLength() noexcept { return getLatency() + 4 * HalfbandDecimator::numCoefficients; }
+
+    int numChannels{ 0 };
+    std::array<juce::AudioBuffer<float>, maxLevel + 1> buses;          ///< Level 0 is unused; the output plays its part.
+    std::array<juce::AudioBuffer<float>, maxLevel + 1> delayLines;     ///< Circular, getDelay(level) samples long.
+    std::array<int, maxLevel + 1> delayPositions{};
+    juce::OwnedArray<HalfbandDecimator> decimators;                     ///< Per level from 1 and channel, into the level below.
+    std::array<bool, maxLevel + 1> used{};                              ///< Whether a voice rendered into the bus this block.
+    std::array<int, maxLevel + 1> tailLeft{};                           ///< Base-rate samples until the level runs dry.
+    bool latencyCompensated{ false };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OversampledMix)
+};
\ No newline at end of file
@@ -0,0 +1,199 @@
+/*
+  ==============================================================================
+
+    ParameterCache.cpp
+    Resolves the plugin's parameters once and tracks which of them changed
+    since the previous audio block.
+
+  ==============================================================================
+*/
+
+#include "ParameterCache.h"
+
+// Looks the parameter up by ID once, so the audio thread never has to.
+void CachedParameter::attach(juce::AudioProcessorValueTreeState& apvts, const juce::String& parameterId) {
+    source = apvts.getRawParameterValue(parameterId);
+    jassert(source != nullptr); // The ID does not match any parameter in createParameters().
+
+    parameter = apvts.getParameter(parameterId);
+
+    if (parameter != nullptr)
+        index = parameter->getParameterIndex();
+
+    value = source->load();
+    forceChange = true;
+}
+
+// Compares the current value with the last one seen and bumps the version if it moved.
+bool CachedParameter::refresh() noexcept {
+    float current = source->load(std::memory_order_relaxed);
+
+    // A held value stands in for the parameter until the parameter itself moves, which also
+    // ends a controller glide.
+    if (holding && current == heldSource) {
+        current = heldValue;
+    }
+    else {
+        holding = false;
+        rampSamplesLeft = 0;
+    }
+
+    changed = forceChange || current != value;
+    forceChange = false;
+
+    if (changed) {
+        value = current;
+        ++version;
+    }
+
+    return changed;
+}
+
+void CachedParameter::hold(float newValue) noexcept {
+    heldValue = newValue;
+    heldSource = source->load(std::memory_order_relaxed);
+    holding = true;
+}
+
+void CachedParameter::setFromController(float normalisedValue, int rampSamples) noexcept {
+    if (parameter == nullptr || !parameter->isAutomatable())
+        return;
+
+    const float target = parameter->convertFrom0to1(juce::jlimit(0.0f, 1.0f, normalisedValue));
+
+    // Hold the current value from the start of a glide, so the next refresh() keeps the glide
+    // going unless the parameter itself has moved.
+    if (rampSamples > 0 && !parameter->isDiscrete()) {
+        rampTarget = target;
+        rampSamplesLeft = rampSamples;
+        hold(value);
+        return;
+    }
+
+    rampSamplesLeft = 0;
+    setHeldValue(target);
+}
+
+// Steps in a straight line, so the glide always takes its full length whatever the step size.
+void CachedParameter::advanceRamp(int numSamples) noexcept {
+    if (rampSamplesLeft <= 0)
+        return;
+
+    const int step = juce::jmin(numSamples, rampSamplesLeft);
+    const float next = value + (rampTarget - value) * (float) step / (float) rampSamplesLeft;
+
+    rampSamplesLeft -= step;
+    setHeldValue(rampSamplesLeft > 0 ? next : rampTarget);
+}
+
+void CachedParameter::setHeldValue(float newValue) noexcept {
+    hold(newValue);
+
+    if (newValue != value) {
+        value = newValue;
+        changed = true;
+        ++version;
+    }
+}
+
+//==============================================================================
+ParameterCache::ParameterCache(juce::AudioProcessorValueTreeState& apvts) {
+    attack.attach(apvts, "ATTACK");
+    decay.attach(apvts, "DECAY");
+    sustain.attach(apvts, "SUSTAIN");
+    release.attach(apvts, "RELEASE");
+    envCurve.attach(apvts, "ENVCURVE");
+
+    waveType.attach(apvts, "OSC1WAVETYPE");
+    fmFreq.attach(apvts, "OSC1FMFREQ");
+    fmDepth.attach(apvts, "OSC1FMDEPTH");
+    unison.attach(apvts, "UNISON");
+    detune.attach(apvts, "DETUNE");
+    unisonSpread.attach(apvts, "UNISONSPREAD");
+
+    polyphony.attach(apvts, "POLYPHONY");
+    voiceSteal.attach(apvts, "VOICESTEAL");
+    voiceBank.attach(apvts, "VOICEBANK");
+    spread.attach(apvts, "SPREAD");
+    multiCore.attach(apvts, "MULTICORE");
+    oversampling.attach(apvts, "OVERSAMPLING");
+    silenceThreshold.attach(apvts, "SILENCE");
+    controllerSmoothing.attach(apvts, "CCSMOOTHING");
+
+    for (int lfo = 0; lfo < ModMatrix::numLfos; ++lfo) {
+        const auto prefix = "LFO" + juce::String(lfo + 1);
+        lfoShape[(size_t) lfo].attach(apvts, prefix + "SHAPE");
+        lfoRate[(size_t) lfo].attach(apvts, prefix + "RATE");
+    }
+
+    for (int slot = 0; slot < ModMatrix::numSlots; ++slot) {
+        const auto prefix = "MOD" + juce::String(slot + 1);
+        modSource[(size_t) slot].attach(apvts, prefix + "SOURCE");
+        modTarget[(size_t) slot].attach(apvts, prefix + "TARGET");
+        modAmount[(size_t) slot].attach(apvts, prefix + "AMOUNT");
+    }
+}
+
+void ParameterCache::update() noexcept {
+    forEach([](CachedParameter& parameter) { parameter.refresh(); });
+}
+
+void ParameterCache::invalidate() noexcept {
+    forEach([](CachedParameter& parameter) { parameter.invalidate(); });
+}
+
+void ParameterCache::skipUpdate() noexcept {
+    forEach([](CachedParameter& parameter) { parameter.skip(); });
+}
+
+void ParameterCache::applyPatch(const PatchState& patch) noexcept {
+    forEach([&patch](CachedParameter& parameter) {
+        if (juce::isPositiveAndBelow(parameter.getIndex(), patch.getNumValues()))
+            parameter.hold(patch.getValue(parameter.getIndex()));
+    });
+}
+
+CachedParameter* ParameterCache::findParameter(int parameterIndex) noexcept {
+    CachedParameter* found = nullptr;
+
+    forEach([&found, parameterIndex](CachedParameter& parameter) {
+        if (parameter.getIndex() == parameterIndex)
+            found = &parameter;
+    });
+
+    return found;
+}
+
+bool ParameterCache::isRamping() noexcept {
+    bool ramping = false;
+    forEach([&ramping](CachedParameter& parameter) { ramping = ramping || parameter.isRamping(); });
+    return ramping;
+}
+
+void ParameterCache::advanceRamps(int numSamples) noexcept {
+    forEach([numSamples](CachedParameter& parameter) {
+        parameter.skip();
+        parameter.advanceRamp(numSamples);
+    });
+}
+
+bool ParameterCache::adsrChanged() const noexcept {
+    return attack.hasChanged() || decay.hasChanged() || sustain.hasChanged() || release.hasChanged()
+        || envCurve.hasChanged();
+}
+
+bool ParameterCache::lfoChanged() const noexcept {
+    for (int lfo = 0; lfo < ModMatrix::numLfos; ++lfo)
+        if (lfoShape[(size_t) lfo].hasChanged() || lfoRate[(size_t) lfo].hasChanged())
+            return true;
+
+    return false;
+}
+
+bool ParameterCache::modMatrixChanged() const noexcept {
+    for (int slot = 0; slot < ModMatrix::numSlots; ++slot)
+        if (modSource[(size_t) slot].hasChanged() || modTarget[(size_t) slot].hasChanged() || modAmount[(size_t) slot].hasChanged())
+            return true;
+
+    return false;
+}
\ No newline at end of file
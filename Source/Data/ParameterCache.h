@@ -0,0 +1,237 @@
+/*
+  ==============================================================================
+
+    ParameterCache.h
+    Resolves the plugin's parameters once and tracks which of them changed
+    since the previous audio block.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PatchState.h"
+#include "ModMatrix.h"
+
+/**
+ * CachedParameter holds the atomic value pointer of one parameter in the
+ * AudioProcessorValueTreeState, looked up once by ID, together with the last value the
+ * audio thread saw and a version number that is bumped every time that value moves.
+ */
+class CachedParameter {
+
+public:
+    /**
+     * Resolves the parameter's atomic value. Must be called before refresh().
+     *
+     * @param apvts The value tree state that owns the parameter.
+     * @param parameterId The ID the parameter was created with.
+     */
+    void attach(juce::AudioProcessorValueTreeState& apvts, const juce::String& parameterId);
+
+    /**
+     * Reads the parameter's current value.
+     *
+     * @return True if the value differs from the one seen on the previous call.
+     */
+    bool refresh() noexcept;
+
+    /** Marks the parameter as changed so that the next refresh() reports it. */
+    void invalidate() noexcept { forceChange = true; }
+
+    /**
+     * Makes refresh() report a value that has not reached the parameter yet, as when a patch is
+     * applied on the audio thread before the host-visible parameter is set. The held value is
+     * used until the parameter itself moves.
+     *
+     * @param newValue The value to report.
+     */
+    void hold(float newValue) noexcept;
+
+    /**
+     * Moves the value from a MIDI controller, on the audio thread and without going through the
+     * host-visible parameter. Like hold(), the value stands until the parameter itself moves.
+     * Continuous parameters glide to the new value over the given number of samples, which
+     * advanceRamp() steps through; discrete ones jump. Parameters that are not automatable
+     * ignore controllers.
+     *
+     * @param normalisedValue The controller's position, from 0 to 1.
+     * @param rampSamples The length of the glide, or 0 to jump.
+     */
+    void setFromController(float normalisedValue, int rampSamples) noexcept;
+
+    /**
+     * Moves a glide started by setFromController() on, and reports a change if the value moved.
+     *
+     * @param numSamples The number of samples since the last step.
+     */
+    void advanceRamp(int numSamples) noexcept;
+
+    /** Returns true while a glide started by setFromController() is under way. */
+    bool isRamping() const noexcept { return rampSamplesLeft > 0; }
+
+    /** Clears the change flag without reading the parameter. */
+    void skip() noexcept { changed = false; }
+
+    /** Returns the index of the parameter in AudioProcessor::getParameters(). */
+    int getIndex() const noexcept { return index; }
+
+    /** Returns true if the last refresh() saw a new value. */
+    bool hasChanged() const noexcept { return changed; }
+
+    /** Returns the value read by the last refresh(). */
+    float get() const noexcept { return value; }
+
+    /** Returns a counter that increases every time the value changes. */
+    juce::uint32 getVersion() const noexcept { return version; }
+
+private:
+    /** Holds a new value straight away, reporting a change if it differs from the current one. */
+    void setHeldValue(float newValue) noexcept;
+
+    std::atomic<float>* source{ nullptr }; ///< The parameter's value, owned by the value tree state.
+    juce::RangedAudioParameter* parameter{ nullptr }; ///< The parameter itself, for its range.
+    float value{ 0.0f };                   ///< The value seen by the last refresh().
+    juce::uint32 version{ 0 };             ///< Incremented on every change.
+    bool changed{ false };                 ///< Whether the last refresh() saw a change.
+    bool forceChange{ true };              ///< Reports a change on the next refresh() regardless of the value.
+    bool holding{ false };                 ///< Whether heldValue replaces the parameter's value.
+    float heldValue{ 0.0f };               ///< The value reported while holding.
+    float heldSource{ 0.0f };              ///< The parameter's value when the hold started.
+    int index{ -1 };                       ///< Index of the parameter in the processor.
+    float rampTarget{ 0.0f };              ///< The value a controller glide ends at.
+    int rampSamplesLeft{ 0 };              ///< Samples until the glide reaches its target.
+};
+
+/**
+ * ParameterCache groups the cached parameters used by the audio thread. It is refreshed once
+ * per block, and the processor only pushes a group of settings to the voices when one of the
+ * parameters in that group has actually moved.
+ */
+class ParameterCache {
+
+public:
+    /**
+     * Resolves every parameter used by the audio thread.
+     *
+     * @param apvts The value tree state that owns the parameters.
+     */
+    explicit ParameterCache(juce::AudioProcessorValueTreeState& apvts);
+
+    /** Reads every parameter once and updates the change flags. Called at the start of each block. */
+    void update() noexcept;
+
+    /** Makes the next update() report every parameter as changed, e.g. after prepareToPlay. */
+    void invalidate() noexcept;
+
+    /** Keeps every parameter at its current value for this block and reports no changes. */
+    void skipUpdate() noexcept;
+
+    /**
+     * Makes the next update() report the values of a patch, ahead of the host-visible parameters.
+     * Real-time safe.
+     *
+     * @param patch The patch to apply.
+     */
+    void applyPatch(const PatchState& patch) noexcept;
+
+    /**
+     * Returns the cached parameter with a given index, or nullptr if the audio thread does not use it.
+     *
+     * @param parameterIndex The parameter's index in AudioProcessor::getParameters().
+     */
+    CachedParameter* findParameter(int parameterIndex) noexcept;
+
+    /** Returns true while any parameter is gliding to a controller's value. */
+    bool isRamping() noexcept;
+
+    /**
+     * Moves every controller glide on. The change flags then report only the parameters that moved.
+     *
+     * @param numSamples The number of samples since the last step.
+     */
+    void advanceRamps(int numSamples) noexcept;
+
+    /** Returns true if any envelope parameter changed in the last update(). */
+    bool adsrChanged() const noexcept;
+
+    /** Returns true if the waveform choice changed in the last update(). */
+    bool waveTypeChanged() const noexcept { return waveType.hasChanged(); }
+
+    /** Returns true if the FM depth or frequency changed in the last update(). */
+    bool fmChanged() const noexcept { return fmDepth.hasChanged() || fmFreq.hasChanged(); }
+
+    /** Returns true if the polyphony or voice stealing mode changed in the last update(). */
+    bool voicePoolChanged() const noexcept { return polyphony.hasChanged() || voiceSteal.hasChanged(); }
+
+    /** Returns true if the stereo spread changed in the last update(). */
+    bool spreadChanged() const noexcept { return spread.hasChanged(); }
+
+    /** Returns true if the multi-core rendering switch changed in the last update(). */
+    bool multiCoreChanged() const noexcept { return multiCore.hasChanged(); }
+
+    /** Returns true if the choice of renderer changed in the last update(). */
+    bool voiceBankChanged() const noexcept { return voiceBank.hasChanged(); }
+
+    /** Returns true if the unison count, detune or spread changed in the last update(). */
+    bool unisonChanged() const noexcept { return unison.hasChanged() || detune.hasChanged() || unisonSpread.hasChanged(); }
+
+    /** Returns true if the oversampling mode changed in the last update(). */
+    bool oversamplingChanged() const noexcept { return oversampling.hasChanged(); }
+
+    /** Returns true if the silence threshold changed in the last update(). */
+    bool silenceThresholdChanged() const noexcept { return silenceThreshold.hasChanged(); }
+
+    /** Returns true if the shape or rate of either LFO changed in the last update(). */
+    bool lfoChanged() const noexcept;
+
+    /** Returns true if the source, target or amount of any modulation slot changed in the last update(). */
+    bool modMatrixChanged() const noexcept;
+
+    CachedParameter attack;
+    CachedParameter decay;
+    CachedParameter sustain;
+    CachedParameter release;
+    CachedParameter envCurve;
+
+    CachedParameter waveType;
+    CachedParameter fmFreq;
+    CachedParameter fmDepth;
+    CachedParameter unison;
+    CachedParameter detune;
+    CachedParameter unisonSpread;
+
+    CachedParameter polyphony;
+    CachedParameter voiceSteal;
+    CachedParameter voiceBank;
+    CachedParameter spread;
+    CachedParameter multiCore;
+    CachedParameter oversampling;
+    CachedParameter silenceThreshold;
+    CachedParameter controllerSmoothing;
+
+    std::array<CachedParameter, ModMatrix::numLfos> lfoShape;
+    std::array<CachedParameter, ModMatrix::numLfos> lfoRate;
+    std::array<CachedParameter, ModMatrix::numSlots> modSource;
+    std::array<CachedParameter, ModMatrix::numSlots> modTarget;
+    std::array<CachedParameter, ModMatrix::numSlots> modAmount;
+
+private:
+    /** Applies a function to every cached parameter. */
+    template <typename Function>
+    void forEach(Function&& function) {
+        for (auto* parameter : { &attack, &decay, &sustain, &release, &envCurve, &waveType, &fmFreq, &fmDepth, &unison, &detune, &unisonSpread, &polyphony, &voiceSteal, &voiceBank, &spread, &multiCore, &oversampling, &silenceThreshold, &controllerSmoothing })
+            function(*parameter);
+
+        for (auto* group : { &lfoShape, &lfoRate })
+            for (auto& parameter : *group)
+                function(parameter);
+
+        for (auto* group : { &modSource, &modTarget, &modAmount })
+            for (auto& parameter : *group)
+                function(parameter);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ParameterCache)
+};
\ No newline at end of file
@@ -0,0 +1,154 @@
+/*
+  ==============================================================================
+
+    PatchState.cpp
+    A snapshot of every plugin parameter, with a compact versioned binary
+    form used for the plugin state and for presets.
+
+  ==============================================================================
+*/
+
+#include "PatchState.h"
+
+namespace {
+// Every parameter of this plugin is ranged; the ID and the range come from there.
+const juce::RangedAudioParameter* getRanged(const juce::AudioProcessorParameter* parameter) {
+    auto* ranged = dynamic_cast<const juce::RangedAudioParameter*>(parameter);
+    jassert(ranged != nullptr);
+    return ranged;
+}
+
+// Returns the index of the parameter with an ID, or -1.
+int findParameter(const juce::Array<juce::AudioProcessorParameter*>& parameters, const juce::String& parameterId) {
+    for (int index = 0; index < parameters.size(); ++index) {
+        auto* ranged = getRanged(parameters[index]);
+
+        if (ranged != nullptr && ranged->getParameterID() == parameterId)
+            return index;
+    }
+
+    return -1;
+}
+
+// Writes an ID as its length in one byte, then its UTF-8 bytes.
+void writeId(juce::MemoryOutputStream& output, const juce::String& id) {
+    const int idLength = juce::jmin(255, (int) id.getNumBytesAsUTF8());
+
+    output.writeByte((char) idLength);
+    output.write(id.toRawUTF8(), (size_t) idLength);
+}
+}
+
+// Reads every parameter's current value in its own range.
+std::unique_ptr<PatchState> PatchState::capture(const juce::AudioProcessor& processor) {
+    std::unique_ptr<PatchState> patch(new PatchState());
+
+    for (auto* parameter : processor.getParameters()) {
+        auto* ranged = getRanged(parameter);
+        patch->values.push_back(ranged != nullptr ? ranged->convertFrom0to1(ranged->getValue()) : parameter->getValue());
+    }
+
+    return patch;
+}
+
+// Starts from the defaults, then overwrites every parameter the data has an entry for.
+std::unique_ptr<PatchState> PatchState::read(const juce::AudioProcessor& processor, const void* data, size_t size) {
+    juce::MemoryInputStream input(data, size, false);
+
+    char header[sizeof(magic)] = {};
+
+    if (input.read(header, (int) sizeof(header)) != (int) sizeof(header) || std::memcmp(header, magic, sizeof(magic)) != 0)
+        return nullptr;
+
+    const auto version = (juce::uint32) input.readInt();
+
+    if (version == 0 || version > formatVersion)
+        return nullptr;
+
+    const auto& parameters = processor.getParameters();
+    std::unique_ptr<PatchState> patch(new PatchState());
+
+    for (auto* parameter : parameters) {
+        auto* ranged = getRanged(parameter);
+        patch->values.push_back(ranged != nullptr ? ranged->convertFrom0to1(ranged->getDefaultValue()) : parameter->getDefaultValue());
+    }
+
+    const auto count = (juce::uint32) input.readInt();
+
+    for (juce::uint32 entry = 0; entry < count; ++entry) {
+        char id[256];
+        const int idLength = (int) (juce::uint8) input.readByte();
+
+        if (input.read(id, idLength) != idLength || input.getNumBytesRemaining() < (juce::int64) sizeof(float))
+            return nullptr; // Truncated.
+
+        const float value = input.readFloat();
+        const int index = findParameter(parameters, juce::String::fromUTF8(id, idLength));
+
+        if (index >= 0) {
+            // Clamp into the range so that a damaged file cannot push a parameter outside it.
+            const auto& range = getRanged(parameters[index])->getNormalisableRange();
+            patch->values[(size_t) index] = juce::jlimit(range.start, range.end, value);
+        }
+    }
+
+    if (version < 2)
+        return patch;
+
+    if (input.getNumBytesRemaining() < (juce::int64) sizeof(juce::uint32))
+        return nullptr; // Truncated.
+
+    const auto routeCount = (juce::uint32) input.readInt();
+    patch->hasRoutes = true;
+
+    for (juce::uint32 entry = 0; entry < routeCount; ++entry) {
+        char id[256];
+        const int midiChannel = (int) (juce::uint8) input.readByte();
+        const int controllerNumber = (int) (juce::uint8) input.readByte();
+        const int idLength = (int) (juce::uint8) input.readByte();
+
+        if (input.read(id, idLength) != idLength)
+            return nullptr; // Truncated.
+
+        // Routes to parameters this version does not have are dropped.
+        const int index = findParameter(parameters, juce::String::fromUTF8(id, idLength));
+
+        if (index >= 0)
+            patch->routes.push_back({ midiChannel, controllerNumber, index });
+    }
+
+    return patch;
+}
+
+void PatchState::setControllerRoutes(std::vector<ControllerRoute> newRoutes) {
+    routes = std::move(newRoutes);
+    hasRoutes = true;
+}
+
+void PatchState::write(const juce::AudioProcessor& processor, juce::MemoryBlock& destination) const {
+    const auto& parameters = processor.getParameters();
+    jassert(parameters.size() == getNumValues()); // The patch was captured from a different processor.
+
+    destination.reset();
+    juce::MemoryOutputStream output(destination, false);
+
+    output.write(magic, sizeof(magic));
+    output.writeInt((int) formatVersion);
+    output.writeInt(juce::jmin(parameters.size(), getNumValues()));
+
+    for (int index = 0; index < juce::jmin(parameters.size(), getNumValues()); ++index) {
+        auto* ranged = getRanged(parameters[index]);
+        writeId(output, ranged != nullptr ? ranged->getParameterID() : juce::String());
+        output.writeFloat(values[(size_t) index]);
+    }
+
+    output.writeInt((int) routes.size());
+
+    for (const auto& route : routes) {
+        auto* ranged = juce::isPositiveAndBelow(route.parameterIndex, parameters.size()) ? getRanged(parameters[route.parameterIndex]) : nullptr;
+
+        output.writeByte((char) route.midiChannel);
+        output.writeByte((char) route.controllerNumber);
+        writeId(output, ranged != nullptr ? ranged->getParameterID() : juce::String());
+    }
+}
\ No newline at end of file
@@ -0,0 +1,106 @@
+/*
+  ==============================================================================
+
+    PatchState.h
+    A snapshot of every plugin parameter, with a compact versioned binary
+    form used for the plugin state and for presets.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ * PatchState holds the value of every parameter of a processor, in the same order as
+ * AudioProcessor::getParameters(), so the audio thread can apply it without looking
+ * anything up by name.
+ *
+ * The binary form is a header followed by one entry per parameter, and from version 2 by the
+ * MIDI controllers learned for the parameters:
+ *
+ *     "SYNP"          4 bytes, identifies the format
+ *     version         uint32, little endian
+ *     count           uint32, number of entries
+ *     entries         uint8 ID length, UTF-8 ID, float32 value (not normalised)
+ *     route count     uint32, number of routes (version 2 and later)
+ *     routes          uint8 MIDI channel, uint8 controller number, uint8 ID length, UTF-8 ID
+ *
+ * Entries and routes are matched by parameter ID rather than position, so a state saved before a
+ * parameter was added still loads: unknown IDs are skipped and missing parameters take their
+ * default. Version 1 data has no routes, which hasControllerRoutes() reports.
+ */
+class PatchState {
+
+public:
+    /** The version written by write(). Data with a higher version is rejected by read(). */
+    static constexpr juce::uint32 formatVersion = 2;
+
+    /** A MIDI controller routed to a parameter by MIDI learn. */
+    struct ControllerRoute {
+        int midiChannel{ 1 };        ///< The MIDI channel, from 1 to 16.
+        int controllerNumber{ 0 };   ///< The controller number, from 0 to 127.
+        int parameterIndex{ -1 };    ///< The parameter's index in AudioProcessor::getParameters().
+    };
+
+    /**
+     * Takes a snapshot of the current value of every parameter.
+     *
+     * @param processor The processor whose parameters are read.
+     */
+    static std::unique_ptr<PatchState> capture(const juce::AudioProcessor& processor);
+
+    /**
+     * Parses the binary form. Allocates, so it must not be called from the audio thread.
+     *
+     * @param processor The processor the patch is for, used to resolve parameter IDs.
+     * @param data The binary data.
+     * @param size The number of bytes of data.
+     * @return The parsed patch, or nullptr if the data is not a valid patch.
+     */
+    static std::unique_ptr<PatchState> read(const juce::AudioProcessor& processor, const void* data, size_t size);
+
+    /**
+     * Replaces the contents of a memory block with the binary form of the patch.
+     *
+     * @param processor The processor the patch was captured from, used for the parameter IDs.
+     * @param destination Receives the binary data.
+     */
+    void write(const juce::AudioProcessor& processor, juce::MemoryBlock& destination) const;
+
+    /** Returns the number of parameters in the patch. */
+    int getNumValues() const noexcept { return (int) values.size(); }
+
+    /**
+     * Returns the value of a parameter, in its own range rather than normalised.
+     *
+     * @param parameterIndex The parameter's index in AudioProcessor::getParameters().
+     */
+    float getValue(int parameterIndex) const noexcept { return values[(size_t) parameterIndex]; }
+
+    /** Returns true if the patch carries learned controllers, which data older than version 2 does not. */
+    bool hasControllerRoutes() const noexcept { return hasRoutes; }
+
+    /** Returns the learned controllers, empty if there are none. */
+    const std::vector<ControllerRoute>& getControllerRoutes() const noexcept { return routes; }
+
+    /**
+     * Sets the learned controllers written with the patch.
+     *
+     * @param newRoutes Every controller that is routed to a parameter.
+     */
+    void setControllerRoutes(std::vector<ControllerRoute> newRoutes);
+
+private:
+    PatchState() = default;
+
+    /** Identifies the binary form, stored as the first four bytes. */
+    static constexpr char magic[4] = { 'S', 'Y', 'N', 'P' };
+
+    std::vector<float> values;   ///< The value of every parameter, indexed like getParameters().
+    std::vector<ControllerRoute> routes; ///< Learned controllers, by parameter index.
+    bool hasRoutes{ false };     ///< Whether the patch came with a route section.
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PatchState)
+};
\ No newline at end of file
@@ -0,0 +1,177 @@
+/*
+  ==============================================================================
+
+    PresetBank.cpp
+    A read-only bank of presets in one memory-mapped file, shared by every
+    instance of the plugin in the process.
+
+  ==============================================================================
+*/
+
+#include "PresetBank.h"
+
+PresetBank::PresetBank() {
+    const auto file = getDefaultFile();
+
+    if (!file.existsAsFile())
+        return;
+
+    mappedFile = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly);
+    base = static_cast<const char*>(mappedFile->getData());
+    fileSize = mappedFile->getSize();
+
+    if (base == nullptr || !validate()) {
+        jassertfalse; // The bank file is damaged or from a different version.
+        mappedFile.reset();
+        base = nullptr;
+        fileSize = 0;
+        return;
+    }
+
+    numPrograms = (int) readWord(8);
+    nameTableSize = readWord(12);
+}
+
+juce::File PresetBank::getDefaultFile() {
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile(JucePlugin_Name)
+        .getChildFile("Presets.synthbank");
+}
+
+//==============================================================================
+juce::String PresetBank::getProgramName(int program) const {
+    if (!juce::isPositiveAndBelow(program, numPrograms))
+        return {};
+
+    const size_t entry = headerSize + (size_t) program * entrySize;
+    return juce::String::fromUTF8(base + readWord(entry), (int) readWord(entry + 4));
+}
+
+// Probes the name table from the name's hash until it finds the name or an empty slot.
+int PresetBank::findProgram(const juce::String& name) const noexcept {
+    if (nameTableSize == 0)
+        return -1;
+
+    const char* utf8 = name.toRawUTF8();
+    const size_t length = name.getNumBytesAsUTF8();
+    const size_t tableStart = headerSize + (size_t) numPrograms * entrySize;
+    juce::uint32 slot = hashName(utf8, length) & (nameTableSize - 1);
+
+    for (juce::uint32 probe = 0; probe < nameTableSize; ++probe) {
+        const juce::uint32 value = readWord(tableStart + (size_t) slot * 4);
+
+        if (value == 0)
+            return -1;
+
+        const size_t entry = headerSize + (size_t) (value - 1) * entrySize;
+
+        if (readWord(entry + 4) == length && std::memcmp(base + readWord(entry), utf8, length) == 0)
+            return (int) value - 1;
+
+        slot = (slot + 1) & (nameTableSize - 1);
+    }
+
+    return -1;
+}
+
+bool PresetBank::getPatchData(int program, const void*& data, size_t& size) const noexcept {
+    if (!juce::isPositiveAndBelow(program, numPrograms))
+        return false;
+
+    const size_t entry = headerSize + (size_t) program * entrySize;
+    data = base + readWord(entry + 8);
+    size = readWord(entry + 12);
+    return true;
+}
+
+//==============================================================================
+bool PresetBank::write(const juce::File& file, const juce::StringArray& names, const juce::Array<juce::MemoryBlock>& patches) {
+    jassert(names.size() == patches.size());
+
+    const int count = juce::jmin(names.size(), patches.size());
+    const auto tableSize = (juce::uint32) juce::nextPowerOfTwo(juce::jmax(1, count * 2));
+    const size_t dataStart = headerSize + (size_t) count * entrySize + (size_t) tableSize * 4;
+
+    // Lay out the names and patches after the tables, and hash every name into its slot.
+    std::vector<juce::uint32> entries;
+    std::vector<juce::uint32> table(tableSize, 0);
+    juce::MemoryBlock data;
+
+    for (int program = 0; program < count; ++program) {
+        const juce::String& name = names[program];
+        const auto nameLength = name.getNumBytesAsUTF8();
+
+        entries.push_back((juce::uint32) (dataStart + data.getSize()));
+        entries.push_back((juce::uint32) nameLength);
+        data.append(name.toRawUTF8(), nameLength);
+
+        entries.push_back((juce::uint32) (dataStart + data.getSize()));
+        entries.push_back((juce::uint32) patches[program].getSize());
+        data.append(patches[program].getData(), patches[program].getSize());
+
+        juce::uint32 slot = hashName(name.toRawUTF8(), nameLength) & (tableSize - 1);
+
+        while (table[slot] != 0)
+            slot = (slot + 1) & (tableSize - 1);
+
+        table[slot] = (juce::uint32) program + 1;
+    }
+
+    juce::MemoryOutputStream output;
+    output.write(magic, sizeof(magic));
+    output.writeInt((int) formatVersion);
+    output.writeInt(count);
+    output.writeInt((int) tableSize);
+
+    for (auto word : entries)
+        output.writeInt((int) word);
+
+    for (auto word : table)
+        output.writeInt((int) word);
+
+    output.write(data.getData(), data.getSize());
+
+    // Replacing the file rather than writing into it leaves banks that are already mapped intact.
+    file.getParentDirectory().createDirectory();
+    return file.replaceWithData(output.getData(), output.getDataSize());
+}
+
+//==============================================================================
+bool PresetBank::validate() const noexcept {
+    if (fileSize < headerSize || std::memcmp(base, magic, sizeof(magic)) != 0 || readWord(4) != formatVersion)
+        return false;
+
+    const juce::uint64 count = readWord(8);
+    const juce::uint64 tableSize = readWord(12);
+
+    if (tableSize == 0 || !juce::isPowerOfTwo(tableSize) || tableSize < count
+        || headerSize + count * entrySize + tableSize * 4 > fileSize)
+        return false;
+
+    for (juce::uint64 program = 0; program < count; ++program) {
+        const size_t entry = headerSize + (size_t) program * entrySize;
+
+        if ((juce::uint64) readWord(entry) + readWord(entry + 4) > fileSize
+            || (juce::uint64) readWord(entry + 8) + readWord(entry + 12) > fileSize)
+            return false;
+    }
+
+    const size_t tableStart = headerSize + (size_t) count * entrySize;
+
+    for (juce::uint64 slot = 0; slot < tableSize; ++slot)
+        if (readWord(tableStart + (size_t) slot * 4) > count)
+            return false;
+
+    return true;
+}
+
+juce::uint32 PresetBank::hashName(const char* name, size_t length) noexcept {
+    juce::uint32 hash = 2166136261u;
+
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= (juce::uint8) name[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
\ No newline at end of file
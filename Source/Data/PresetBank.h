@@ -0,0 +1,98 @@
+/*
+  ==============================================================================
+
+    PresetBank.h
+    A read-only bank of presets in one memory-mapped file, shared by every
+    instance of the plugin in the process.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ * PresetBank maps a bank file into memory once per process and is shared by every plugin
+ * instance through juce::SharedResourcePointer. Nothing is parsed or copied when the bank is
+ * opened beyond checking that its offsets are in range; a preset is only parsed when it is
+ * selected, straight from the mapped bytes.
+ *
+ * The file is laid out as, with every integer a little-endian uint32:
+ *
+ *     header      "SYNB", version, number of programs, size of the name table
+ *     index       per program: name offset, name length, patch offset, patch size
+ *     name table  open-addressed hash of the names; each slot holds program + 1, or 0 if empty
+ *     data        the UTF-8 names and the PatchState data of every program
+ *
+ * The index gives O(1) lookup by program number and the name table O(1) lookup by name.
+ */
+class PresetBank {
+
+public:
+    /** The version written by write(). Files with a different version are ignored. */
+    static constexpr juce::uint32 formatVersion = 1;
+
+    /** Maps the bank at getDefaultFile(), if there is one. */
+    PresetBank();
+
+    /** Returns where the bank is read from: Presets.synthbank in the plugin's application data folder. */
+    static juce::File getDefaultFile();
+
+    /** Returns the number of programs in the bank, or 0 if no valid bank was found. */
+    int getNumPrograms() const noexcept { return numPrograms; }
+
+    /**
+     * Returns the name of a program, or an empty string if the number is out of range.
+     * @param program The program number.
+     */
+    juce::String getProgramName(int program) const;
+
+    /**
+     * Finds a program by its exact name.
+     * @param name The name to look for.
+     * @return The program number, or -1 if no program has that name.
+     */
+    int findProgram(const juce::String& name) const noexcept;
+
+    /**
+     * Returns a program's patch data, in the PatchState format, without copying it. The data
+     * stays valid for as long as the bank exists. Real-time safe.
+     * @param program The program number.
+     * @param data Receives a pointer to the mapped data.
+     * @param size Receives the number of bytes.
+     * @return False if the number is out of range.
+     */
+    bool getPatchData(int program, const void*& data, size_t& size) const noexcept;
+
+    /**
+     * Writes a bank file.
+     * @param file The file to create or replace.
+     * @param names The name of every program.
+     * @param patches The PatchState data of every program, in the same order as names.
+     * @return False if the file could not be written.
+     */
+    static bool write(const juce::File& file, const juce::StringArray& names, const juce::Array<juce::MemoryBlock>& patches);
+
+private:
+    /** Checks the header and every offset, so that lookups never need to. */
+    bool validate() const noexcept;
+
+    /** Returns the little-endian uint32 at a byte offset of the file. */
+    juce::uint32 readWord(size_t offset) const noexcept { return juce::ByteOrder::littleEndianInt(base + offset); }
+
+    /** Returns the FNV-1a hash of a name, used for the name table. */
+    static juce::uint32 hashName(const char* name, size_t length) noexcept;
+
+    static constexpr char magic[4] = { 'S', 'Y', 'N', 'B' };
+    static constexpr size_t headerSize = 16;
+    static constexpr size_t entrySize = 16;
+
+    std::unique_ptr<juce::MemoryMappedFile> mappedFile;
+    const char* base{ nullptr };       ///< Start of the mapped file.
+    size_t fileSize{ 0 };
+    int numPrograms{ 0 };
+    juce::uint32 nameTableSize{ 0 };   ///< Number of slots in the name table, a power of two.
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PresetBank)
+};
\ No newline at end of file
@@ -0,0 +1,24 @@
+/*
+  ==============================================================================
+
+    ScratchArena.cpp
+    Allocates and lays out the scratch arena.
+
+  ==============================================================================
+*/
+
+#include "ScratchArena.h"
+
+void ScratchArena::allocate(int newNumSlices, int floatsPerSlice) {
+    constexpr size_t floatsPerLine = alignment / sizeof(float);
+
+    numSlices = juce::jmax(0, newNumSlices);
+    sliceStride = ((size_t) juce::jmax(1, floatsPerSlice) + floatsPerLine - 1) / floatsPerLine * floatsPerLine;
+
+    const size_t bytes = (size_t) numSlices * sliceStride * sizeof(float);
+    storage.calloc(bytes + alignment);
+
+    // HeapBlock does not align, so over-allocate and start at the first cache line boundary.
+    const auto address = reinterpret_cast<juce::pointer_sized_uint>(storage.get());
+    base = reinterpret_cast<float*>((address + alignment - 1) & ~(juce::pointer_sized_uint) (alignment - 1));
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+/*
+  ==============================================================================
+
+    ScratchArena.h
+    One preallocated, cache-aligned block of memory that is split into the
+    scratch buffers used while rendering.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ * ScratchArena owns a single allocation made in prepareToPlay and hands out fixed slices of
+ * it as float buffers. Every slice starts on a cache line, so buffers used by different
+ * threads never share one. Nothing is allocated or freed after allocate() returns, so the
+ * audio thread can use any slice freely.
+ */
+class ScratchArena {
+
+public:
+    /** Alignment of the arena and of every slice, in bytes. */
+    static constexpr size_t alignment = 64;
+
+    /**
+     * Replaces the arena with one large enough for a number of equally sized slices.
+     * Any pointers previously returned by getSlice() become invalid. Must not be called from
+     * the audio thread.
+     *
+     * @param numSlices The number of slices.
+     * @param floatsPerSlice The minimum number of floats in each slice.
+     */
+    void allocate(int numSlices, int floatsPerSlice);
+
+    /**
+     * Returns the start of a slice.
+     *
+     * @param index The slice, in [0, getNumSlices()).
+     */
+    float* getSlice(int index) const noexcept {
+        jassert(juce::isPositiveAndBelow(index, numSlices));
+        return base + (size_t) index * sliceStride;
+    }
+
+    /** Returns the number of slices. */
+    int getNumSlices() const noexcept { return numSlices; }
+
+    /** Returns the number of floats in every slice. */
+    int getSliceSize() const noexcept { return (int) sliceStride; }
+
+private:
+    juce::HeapBlock<char> storage;   ///< The allocation, with room to align its start.
+    float* base{ nullptr };          ///< The first aligned float in storage.
+    size_t sliceStride{ 0 };         ///< Floats per slice, rounded up to whole cache lines.
+    int numSlices{ 0 };
+};
\ No newline at end of file
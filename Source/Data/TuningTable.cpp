@@ -0,0 +1,233 @@
+/*
+  ==============================================================================
+
+    TuningTable.cpp
+    Builds the note frequencies from equal temperament or from Scala scale
+    and keyboard mapping files.
+
+  ==============================================================================
+*/
+
+#include "TuningTable.h"
+
+namespace {
+/** The settings of a Scala keyboard mapping. A map size of 0 maps keys to degrees one to one. */
+struct KeyboardMapping {
+    int mapSize{ 0 };
+    int firstNote{ 0 };
+    int lastNote{ TuningTable::numNotes - 1 };
+    int middleNote{ 60 };
+    int referenceNote{ 69 };
+    double referenceFrequency{ 440.0 };
+    int octaveDegree{ 0 };             ///< The degree one repetition of the map spans; 0 for the scale's period.
+    std::vector<int> degrees;          ///< The degree of each key of the map, or -1 for "x".
+};
+
+/** Rounds the quotient towards minus infinity, so negative offsets wrap into the previous repetition. */
+int floorDivide(int value, int divisor) {
+    return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+/** Returns the first word of a line; Scala allows any text after the value. */
+juce::String firstWord(const juce::String& line) {
+    return line.trim().initialSectionNotContaining(" \t");
+}
+
+/** Splits a Scala file into lines, dropping comments, which start with an exclamation mark. */
+juce::StringArray getLines(const juce::String& text) {
+    juce::StringArray lines;
+    lines.addLines(text);
+
+    for (int i = lines.size(); --i >= 0;)
+        if (lines[i].startsWithChar('!'))
+            lines.remove(i);
+
+    return lines;
+}
+
+/** Parses a pitch of a scale: cents if it contains a period, otherwise a ratio or a whole number. */
+bool parsePitch(const juce::String& word, double& cents) {
+    if (word.containsChar('.')) {
+        if (!word.containsOnly("0123456789.+-"))
+            return false;
+
+        cents = word.getDoubleValue();
+        return true;
+    }
+
+    if (word.isEmpty() || !word.containsOnly("0123456789/"))
+        return false;
+
+    const double numerator = word.upToFirstOccurrenceOf("/", false, false).getDoubleValue();
+    const double denominator = word.containsChar('/') ? word.fromFirstOccurrenceOf("/", false, false).getDoubleValue() : 1.0;
+
+    if (numerator <= 0.0 || denominator <= 0.0)
+        return false;
+
+    cents = 1200.0 * std::log2(numerator / denominator);
+    return true;
+}
+
+/** Reads the pitches of a .scl file, with the unison at index 0 and the period last. */
+bool parseScale(const juce::String& text, std::vector<double>& pitches, juce::String& description, juce::String& error) {
+    auto lines = getLines(text);
+
+    // The description comes first and may be empty; blank lines after it carry nothing.
+    description = lines.isEmpty() ? juce::String() : lines[0].trim();
+    lines.remove(0);
+    lines.removeEmptyStrings();
+
+    const int count = lines.isEmpty() ? 0 : firstWord(lines[0]).getIntValue();
+
+    if (count <= 0 || lines.size() < count + 1) {
+        error = "the scale has no pitches, or fewer than it declares";
+        return false;
+    }
+
+    pitches.assign(1, 0.0);
+
+    for (int i = 1; i <= count; ++i) {
+        double cents = 0.0;
+
+        if (!parsePitch(firstWord(lines[i]), cents)) {
+            error = "the scale has an invalid pitch: " + lines[i].trim();
+            return false;
+        }
+
+        pitches.push_back(cents);
+    }
+
+    return true;
+}
+
+/** Reads the settings and the key map of a .kbm file. */
+bool parseKeyboardMapping(const juce::String& text, KeyboardMapping& mapping, juce::String& error) {
+    auto lines = getLines(text);
+    lines.removeEmptyStrings();
+
+    if (lines.size() < 7) {
+        error = "the keyboard mapping is missing some of its seven settings";
+        return false;
+    }
+
+    mapping.mapSize = firstWord(lines[0]).getIntValue();
+    mapping.firstNote = juce::jlimit(0, TuningTable::numNotes - 1, firstWord(lines[1]).getIntValue());
+    mapping.lastNote = juce::jlimit(0, TuningTable::numNotes - 1, firstWord(lines[2]).getIntValue());
+    mapping.middleNote = firstWord(lines[3]).getIntValue();
+    mapping.referenceNote = firstWord(lines[4]).getIntValue();
+    mapping.referenceFrequency = firstWord(lines[5]).getDoubleValue();
+    mapping.octaveDegree = firstWord(lines[6]).getIntValue();
+
+    if (mapping.mapSize < 0 || mapping.referenceFrequency <= 0.0
+        || !juce::isPositiveAndBelow(mapping.referenceNote, TuningTable::numNotes)) {
+        error = "the keyboard mapping has an invalid map size, reference note or reference frequency";
+        return false;
+    }
+
+    // Keys the file has no entry for are unmapped, as they are in Scala.
+    mapping.degrees.assign((size_t) mapping.mapSize, -1);
+
+    for (int key = 0; key < mapping.mapSize && key + 7 < lines.size(); ++key) {
+        const auto word = firstWord(lines[key + 7]);
+
+        if (word != "x" && word != "X")
+            mapping.degrees[(size_t) key] = word.getIntValue();
+    }
+
+    return true;
+}
+
+/** Returns the pitch of a scale degree in cents; degrees past the last repeat the scale a period higher. */
+double getDegreeCents(const std::vector<double>& pitches, int degree) {
+    const int count = (int) pitches.size() - 1;
+    const int periods = floorDivide(degree, count);
+
+    return periods * pitches.back() + pitches[(size_t) (degree - periods * count)];
+}
+
+/**
+ * Returns the pitch of a note in cents above the degree the middle note plays, ignoring the
+ * mapped range. Returns false if the key is mapped to "x".
+ */
+bool getNoteCents(const std::vector<double>& pitches, const KeyboardMapping& mapping, int note, double& cents) {
+    const int offset = note - mapping.middleNote;
+
+    if (mapping.mapSize == 0) {
+        cents = getDegreeCents(pitches, offset);
+        return true;
+    }
+
+    const int repetitions = floorDivide(offset, mapping.mapSize);
+    const int degree = mapping.degrees[(size_t) (offset - repetitions * mapping.mapSize)];
+
+    if (degree < 0)
+        return false;
+
+    const int octaveDegree = mapping.octaveDegree > 0 ? mapping.octaveDegree : (int) pitches.size() - 1;
+    cents = repetitions * getDegreeCents(pitches, octaveDegree) + getDegreeCents(pitches, degree);
+    return true;
+}
+}
+
+//==============================================================================
+std::unique_ptr<TuningTable> TuningTable::createEqualTemperament() {
+    std::unique_ptr<TuningTable> table(new TuningTable());
+    table->description = "12-tone equal temperament";
+
+    for (int note = 0; note < numNotes; ++note)
+        table->frequencies[(size_t) note] = (float) juce::MidiMessage::getMidiNoteInHertz(note);
+
+    return table;
+}
+
+// Every note is tuned relative to the reference note, so the reference lands exactly on its frequency.
+std::unique_ptr<TuningTable> TuningTable::fromScala(const juce::String& scale, const juce::String& keyboardMapping, juce::String& error) {
+    std::vector<double> pitches;
+    juce::String description;
+
+    if (!parseScale(scale, pitches, description, error))
+        return nullptr;
+
+    KeyboardMapping mapping;
+
+    if (keyboardMapping.isNotEmpty() && !parseKeyboardMapping(keyboardMapping, mapping, error))
+        return nullptr;
+
+    double referenceCents = 0.0;
+
+    if (!getNoteCents(pitches, mapping, mapping.referenceNote, referenceCents)) {
+        error = "the keyboard mapping leaves its reference note unmapped";
+        return nullptr;
+    }
+
+    std::unique_ptr<TuningTable> table(new TuningTable());
+    table->description = description;
+
+    for (int note = mapping.firstNote; note <= mapping.lastNote; ++note) {
+        double cents = 0.0;
+
+        if (getNoteCents(pitches, mapping, note, cents)) {
+            const double frequency = mapping.referenceFrequency * std::exp2((cents - referenceCents) / 1200.0);
+
+            if (std::isfinite(frequency) && frequency > 0.0)
+                table->frequencies[(size_t) note] = (float) frequency;
+        }
+    }
+
+    return table;
+}
+
+std::unique_ptr<TuningTable> TuningTable::fromFiles(const juce::File& scaleFile, const juce::File& keyboardMappingFile, juce::String& error) {
+    if (!scaleFile.existsAsFile()) {
+        error = "cannot read " + scaleFile.getFullPathName();
+        return nullptr;
+    }
+
+    if (keyboardMappingFile != juce::File() && !keyboardMappingFile.existsAsFile()) {
+        error = "cannot read " + keyboardMappingFile.getFullPathName();
+        return nullptr;
+    }
+
+    const auto mapping = keyboardMappingFile != juce::File() ? keyboardMappingFile.loadFileAsString() : juce::String();
+    return fromScala(scaleFile.loadFileAsString(), mapping, error);
+}
\ No newline at end of file
@@ -0,0 +1,84 @@
+/*
+  ==============================================================================
+
+    TuningTable.h
+    The frequency of every MIDI note, computed once from twelve-tone equal
+    temperament or from a Scala scale and keyboard mapping.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+/**
+ * TuningTable holds the frequency of each of the 128 MIDI notes, so a voice looks its pitch up
+ * instead of computing a power of two for every note. Tables are immutable once built; a new
+ * tuning is a new table, handed to the audio thread by TuningLoader.
+ *
+ * A table is built from a Scala scale (.scl) and, optionally, a Scala keyboard mapping (.kbm):
+ *
+ * - The scale lists the pitches of its degrees above the unison, in cents when the value
+ *   contains a period and as a ratio (3/2, or a whole number) otherwise. The last pitch is the
+ *   period the scale repeats at, normally the octave.
+ * - The mapping assigns a scale degree to each key around a middle note, repeating every map
+ *   size keys, and tunes one reference note to a given frequency. Keys mapped to "x" and keys
+ *   outside the mapped range are unmapped and do not play. Without a mapping, consecutive keys
+ *   play consecutive degrees, note 60 plays the unison and note 69 is tuned to 440 Hz.
+ */
+class TuningTable {
+
+public:
+    /** The number of MIDI notes. */
+    static constexpr int numNotes = 128;
+
+    /** Returns a table of twelve-tone equal temperament with A4 at 440 Hz. */
+    static std::unique_ptr<TuningTable> createEqualTemperament();
+
+    /**
+     * Builds a table from the text of a Scala scale and keyboard mapping.
+     *
+     * @param scale The contents of a .scl file.
+     * @param keyboardMapping The contents of a .kbm file, or an empty string for the default mapping.
+     * @param error Receives a description of the problem if the text is not valid.
+     * @return The table, or nullptr if either text is not valid.
+     */
+    static std::unique_ptr<TuningTable> fromScala(const juce::String& scale, const juce::String& keyboardMapping, juce::String& error);
+
+    /**
+     * Reads a Scala scale and keyboard mapping from disk and builds a table from them.
+     *
+     * @param scaleFile The .scl file.
+     * @param keyboardMappingFile The .kbm file, or a default File for the default mapping.
+     * @param error Receives a description of the problem if a file cannot be read or is not valid.
+     * @return The table, or nullptr on failure.
+     */
+    static std::unique_ptr<TuningTable> fromFiles(const juce::File& scaleFile, const juce::File& keyboardMappingFile, juce::String& error);
+
+    /**
+     * Returns the frequency of a note in Hz. Unmapped notes return 0.
+     *
+     * @param note The MIDI note number, in [0, numNotes).
+     */
+    float getFrequency(int note) const noexcept { return frequencies[(size_t) note]; }
+
+    /**
+     * Returns true if the note has a pitch in this tuning.
+     *
+     * @param note The MIDI note number, in [0, numNotes).
+     */
+    bool isMapped(int note) const noexcept { return frequencies[(size_t) note] > 0.0f; }
+
+    /** Returns the description line of the scale. */
+    const juce::String& getDescription() const noexcept { return description; }
+
+private:
+    TuningTable() = default;
+
+    std::array<float, numNotes> frequencies{};   ///< Hz per MIDI note, or 0 if the note is unmapped.
+    juce::String description;                    ///< The first line of the scale file.
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TuningTable)
+};
\ No newline at end of file
@@ -0,0 +1,391 @@
+/*
+  ==============================================================================
+
+    VoiceBank.cpp
+    Implements the lane bookkeeping, the segment envelope and the SIMD render
+    loop of the voice bank.
+
+  ==============================================================================
+*/
+
+#include "VoiceBank.h"
+
+VoiceBank::VoiceBank() {
+    slotToLane.fill(-1);
+    laneToSlot.fill(-1);
+    samplesLeft.fill(AdsrData::endless);
+    envCoefficient.fill(1.0f);
+    slotPanLeft.fill(1.0f);
+    slotPanRight.fill(1.0f);
+    table.fill(wavetables->getTable(WavetableBank::sine, 0));
+}
+
+// Sizes the mix buffer and converts every frequency setting for the new sample rate.
+void VoiceBank::prepare(double newSampleRate, int samplesPerBlock) {
+    // Increments and segment lengths of sounding lanes belong to the old sample rate, so end them.
+    while (numLanes > 0)
+        removeLane(numLanes - 1);
+
+    sampleRate = newSampleRate;
+    envelope.setSampleRate(newSampleRate);
+    mixLeft.assign((size_t) juce::jmax(1, samplesPerBlock), 0.0f);
+    mixRight.assign(mixLeft.size(), 0.0f);
+
+    setFmParams(fmDepth, fmFrequency);
+}
+
+void VoiceBank::setWaveType(int choice) {
+    if (!juce::isPositiveAndBelow(choice, (int) WavetableBank::numWaveforms)) {
+        jassertfalse; // An undefined wave type was selected.
+        return;
+    }
+
+    waveType = choice;
+
+    for (int lane = 0; lane < numLanes; ++lane)
+        updateTable(lane);
+}
+
+void VoiceBank::setFmParams(float depth, float freq) {
+    fmDepth = depth;
+    fmFrequency = freq;
+    fmDepthIncrement = (float) (depth / sampleRate);
+    fmIncrement = (float) (freq / sampleRate);
+
+    // The highest instantaneous frequency depends on the depth, so pick the mip levels again.
+    for (int lane = 0; lane < numLanes; ++lane)
+        updateTable(lane);
+}
+
+void VoiceBank::setEnvelope(float attackSeconds, float decaySeconds, float sustain, float releaseSeconds) {
+    envelope.updateADSR(attackSeconds, decaySeconds, sustain, releaseSeconds);
+
+    for (int lane = 0; lane < numLanes; ++lane)
+        if (stage[(size_t) lane] == Stage::sustainStage)
+            enterSustain(lane);
+}
+
+void VoiceBank::setPanGains(int slot, float left, float right) {
+    slotPanLeft[(size_t) slot] = left;
+    slotPanRight[(size_t) slot] = right;
+
+    const int lane = slotToLane[(size_t) slot];
+
+    if (lane >= 0) {
+        panLeft[(size_t) lane] = left;
+        panRight[(size_t) lane] = right;
+    }
+}
+
+//==============================================================================
+void VoiceBank::noteOn(int slot, float frequency) {
+    int lane = slotToLane[(size_t) slot];
+
+    if (lane < 0) {
+        lane = numLanes++;
+        laneToSlot[(size_t) lane] = slot;
+        slotToLane[(size_t) slot] = lane;
+        envOffset[(size_t) lane] = 0.0f;
+        envDelta[(size_t) lane] = 0.0f;
+        panLeft[(size_t) lane] = slotPanLeft[(size_t) slot];
+        panRight[(size_t) lane] = slotPanRight[(size_t) slot];
+    }
+
+    phase[(size_t) lane] = 0.0f;
+    fmPhase[(size_t) lane] = 0.0f;
+    increment[(size_t) lane] = juce::jlimit(0.0f, 0.5f, (float) (frequency / sampleRate));
+
+    updateTable(lane);
+    enterAttack(lane);
+}
+
+void VoiceBank::setFrequency(int slot, float frequency) {
+    const int lane = slotToLane[(size_t) slot];
+
+    if (lane >= 0) {
+        increment[(size_t) lane] = juce::jlimit(0.0f, 0.5f, (float) (frequency / sampleRate));
+        updateTable(lane);
+    }
+}
+
+void VoiceBank::noteOff(int slot) {
+    const int lane = slotToLane[(size_t) slot];
+
+    if (lane >= 0 && stage[(size_t) lane] != Stage::releaseStage)
+        enterRelease(lane);
+}
+
+void VoiceBank::stop(int slot) {
+    const int lane = slotToLane[(size_t) slot];
+
+    if (lane >= 0)
+        removeLane(lane);
+}
+
+// The bank's stages are AdsrData's without idle, which a sounding lane never is.
+bool VoiceBank::getNoteState(int slot, AdsrData::Position& envelopePosition, float& carrierPhase, float& modulatorPhase) const noexcept {
+    const int lane = slotToLane[(size_t) slot];
+
+    if (lane < 0)
+        return false;
+
+    const auto l = (size_t) lane;
+    envelopePosition.stage = (AdsrData::Stage) (stage[l] + (int) AdsrData::Stage::attack);
+    envelopePosition.segment.offset = envOffset[l];
+    envelopePosition.segment.delta = envDelta[l];
+    envelopePosition.segment.coefficient = envCoefficient[l];
+    envelopePosition.segment.rate = envRate[l];
+    envelopePosition.segment.length = samplesLeft[l];
+    carrierPhase = phase[l];
+    modulatorPhase = fmPhase[l];
+    return true;
+}
+
+void VoiceBank::setNoteState(int slot, const AdsrData::Position& envelopePosition, float carrierPhase, float modulatorPhase) noexcept {
+    const int lane = slotToLane[(size_t) slot];
+
+    if (lane < 0)
+        return;
+
+    if (envelopePosition.stage == AdsrData::Stage::idle) {
+        removeLane(lane);
+        return;
+    }
+
+    startSegment(lane, (Stage) ((int) envelopePosition.stage - (int) AdsrData::Stage::attack), envelopePosition.segment);
+    phase[(size_t) lane] = carrierPhase;
+    fmPhase[(size_t) lane] = modulatorPhase;
+}
+
+//==============================================================================
+// Renders the block as a series of segments that end wherever some lane changes stage.
+void VoiceBank::render(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples) {
+    if (numLanes == 0)
+        return;
+
+    for (int done = 0; done < numSamples && numLanes > 0;) {
+        // Process in chunks that fit the mix buffer, in case the host exceeds the prepared block size.
+        const int chunk = juce::jmin(numSamples - done, (int) mixLeft.size());
+        float* left = mixLeft.data();
+        float* right = mixRight.data();
+        juce::FloatVectorOperations::clear(left, chunk);
+        juce::FloatVectorOperations::clear(right, chunk);
+
+        for (int offset = 0; offset < chunk && numLanes > 0;) {
+            int segment = chunk - offset;
+
+            for (int lane = 0; lane < numLanes; ++lane)
+                segment = juce::jmin(segment, samplesLeft[(size_t) lane]);
+
+            renderSegment(left + offset, right + offset, segment);
+
+            // Walk backwards so that a removal, which moves the last lane forward, never skips one.
+            const float silenceThreshold = envelope.getSilenceThreshold();
+
+            for (int lane = numLanes - 1; lane >= 0; --lane) {
+                if (samplesLeft[(size_t) lane] != AdsrData::endless)
+                    samplesLeft[(size_t) lane] -= segment;
+
+                if (samplesLeft[(size_t) lane] == 0)
+                    advanceStage(lane);
+                else if (stage[(size_t) lane] == Stage::releaseStage && getLevel(lane) < silenceThreshold)
+                    removeLane(lane);
+            }
+
+            offset += segment;
+        }
+
+        if (outputBuffer.getNumChannels() == 1) {
+            outputBuffer.addFrom(0, startSample + done, left, chunk, gain * 0.5f);
+            outputBuffer.addFrom(0, startSample + done, right, chunk, gain * 0.5f);
+        }
+        else {
+            for (int channel = 0; channel < outputBuffer.getNumChannels(); ++channel)
+                outputBuffer.addFrom(channel, startSample + done, channel % 2 == 0 ? left : right, chunk, gain);
+        }
+
+        done += chunk;
+    }
+}
+
+// The inner loop: oscillator, FM, envelope and pan of every lane, summed into the two mixes.
+void VoiceBank::renderSegment(float* mixL, float* mixR, int numSamples) noexcept {
+#if JUCE_USE_SIMD
+    using Vec = juce::dsp::SIMDRegister<float>;
+    constexpr int width = (int) Vec::SIMDNumElements;
+    static_assert(maxLanes % width == 0, "Lanes must fill a whole number of SIMD registers");
+
+    const Vec zero = Vec::expand(0.0f);
+    const Vec one = Vec::expand(1.0f);
+
+    alignas(64) float positions[width];
+    alignas(64) float samples[width];
+
+    for (int first = 0; first < numLanes; first += width) {
+        Vec lanePhase = Vec::fromRawArray(phase.data() + first);
+        Vec laneModPhase = Vec::fromRawArray(fmPhase.data() + first);
+        Vec laneDelta = Vec::fromRawArray(envDelta.data() + first);
+        const Vec laneOffset = Vec::fromRawArray(envOffset.data() + first);
+        const Vec laneCoefficient = Vec::fromRawArray(envCoefficient.data() + first);
+        const Vec laneRate = Vec::fromRawArray(envRate.data() + first);
+        const Vec laneIncrement = Vec::fromRawArray(increment.data() + first);
+        const Vec laneLeft = Vec::fromRawArray(panLeft.data() + first);
+        const Vec laneRight = Vec::fromRawArray(panRight.data() + first);
+        const float* const* laneTable = table.data() + first;
+
+        for (int s = 0; s < numSamples; ++s) {
+            // Tables differ per lane, so the reads themselves are gathered one lane at a time.
+            (lanePhase * (float) WavetableBank::tableSize).copyToRawArray(positions);
+
+            for (int i = 0; i < width; ++i) {
+                const int index = juce::jmin(WavetableBank::tableSize - 1, (int) positions[i]);
+                const float* t = laneTable[i];
+                samples[i] = t[index] + (positions[i] - (float) index) * (t[index + 1] - t[index]);
+            }
+
+            const Vec voices = Vec::fromRawArray(samples) * (laneOffset + laneDelta);
+            mixL[s] += (voices * laneLeft).sum();
+            mixR[s] += (voices * laneRight).sum();
+
+            // Advance the modulator, then the carrier by its modulated increment, wrapping both ways.
+            const Vec modulation = DspMath::sinCycle(laneModPhase);
+            laneModPhase = laneModPhase + fmIncrement;
+            laneModPhase = laneModPhase - (one & Vec::greaterThanOrEqual(laneModPhase, one));
+
+            lanePhase = lanePhase + laneIncrement + modulation * fmDepthIncrement;
+            lanePhase = lanePhase - (one & Vec::greaterThanOrEqual(lanePhase, one))
+                                  + (one & Vec::lessThan(lanePhase, zero));
+
+            // A tiny negative phase plus one rounds up to exactly one, so fold that back to zero.
+            lanePhase = lanePhase - (lanePhase & Vec::greaterThanOrEqual(lanePhase, one));
+
+            laneDelta = laneDelta * laneCoefficient + laneRate;
+        }
+
+        lanePhase.copyToRawArray(phase.data() + first);
+        laneModPhase.copyToRawArray(fmPhase.data() + first);
+        laneDelta.copyToRawArray(envDelta.data() + first);
+    }
+#else
+    for (int lane = 0; lane < numLanes; ++lane) {
+        const auto l = (size_t) lane;
+        float lanePhase = phase[l];
+        float laneModPhase = fmPhase[l];
+        float laneDelta = envDelta[l];
+
+        for (int s = 0; s < numSamples; ++s) {
+            const float voice = WavetableBank::read(table[l], lanePhase) * (envOffset[l] + laneDelta);
+            mixL[s] += voice * panLeft[l];
+            mixR[s] += voice * panRight[l];
+
+            const float modulation = DspMath::sinCycle(laneModPhase);
+            laneModPhase += fmIncrement;
+            if (laneModPhase >= 1.0f)
+                laneModPhase -= 1.0f;
+
+            lanePhase = DspMath::wrapSignedPhase(lanePhase + increment[l] + modulation * fmDepthIncrement);
+
+            laneDelta = laneDelta * envCoefficient[l] + envRate[l];
+        }
+
+        phase[l] = lanePhase;
+        fmPhase[l] = laneModPhase;
+        envDelta[l] = laneDelta;
+    }
+#endif
+}
+
+//==============================================================================
+// A retriggered lane attacks from its current level, so the note does not click.
+void VoiceBank::enterAttack(int lane) noexcept {
+    startSegment(lane, Stage::attackStage, envelope.makeAttack(getLevel(lane)));
+
+    if (samplesLeft[(size_t) lane] == 0)
+        enterDecay(lane);
+}
+
+void VoiceBank::enterDecay(int lane) noexcept {
+    startSegment(lane, Stage::decayStage, envelope.makeDecay());
+}
+
+void VoiceBank::enterSustain(int lane) noexcept {
+    startSegment(lane, Stage::sustainStage, envelope.makeSustain());
+}
+
+void VoiceBank::enterRelease(int lane) noexcept {
+    startSegment(lane, Stage::releaseStage, envelope.makeRelease(getLevel(lane)));
+}
+
+void VoiceBank::advanceStage(int lane) noexcept {
+    switch (stage[(size_t) lane]) {
+    case Stage::attackStage:
+        enterDecay(lane);
+        break;
+    case Stage::decayStage:
+    case Stage::sustainStage:
+        enterSustain(lane);
+        break;
+    case Stage::releaseStage:
+        removeLane(lane);
+        break;
+    default:
+        jassertfalse;
+        break;
+    }
+}
+
+void VoiceBank::startSegment(int lane, Stage newStage, const AdsrData::Segment& segment) noexcept {
+    const auto l = (size_t) lane;
+
+    stage[l] = newStage;
+    envOffset[l] = segment.offset;
+    envDelta[l] = segment.delta;
+    envCoefficient[l] = segment.coefficient;
+    envRate[l] = segment.rate;
+    samplesLeft[l] = segment.length;
+}
+
+void VoiceBank::removeLane(int lane) noexcept {
+    const auto l = (size_t) lane;
+    const auto last = (size_t) (numLanes - 1);
+
+    slotToLane[(size_t) laneToSlot[l]] = -1;
+
+    if (l != last) {
+        phase[l] = phase[last];
+        increment[l] = increment[last];
+        fmPhase[l] = fmPhase[last];
+        envOffset[l] = envOffset[last];
+        envDelta[l] = envDelta[last];
+        envCoefficient[l] = envCoefficient[last];
+        envRate[l] = envRate[last];
+        panLeft[l] = panLeft[last];
+        panRight[l] = panRight[last];
+        samplesLeft[l] = samplesLeft[last];
+        stage[l] = stage[last];
+        table[l] = table[last];
+        laneToSlot[l] = laneToSlot[last];
+        slotToLane[(size_t) laneToSlot[l]] = lane;
+    }
+
+    // Leave the vacated lane silent, since the SIMD loop may still read it.
+    phase[last] = 0.0f;
+    increment[last] = 0.0f;
+    fmPhase[last] = 0.0f;
+    envOffset[last] = 0.0f;
+    envDelta[last] = 0.0f;
+    envCoefficient[last] = 1.0f;
+    envRate[last] = 0.0f;
+    panLeft[last] = 0.0f;
+    panRight[last] = 0.0f;
+    samplesLeft[last] = AdsrData::endless;
+    table[last] = wavetables->getTable(WavetableBank::sine, 0);
+    laneToSlot[last] = -1;
+
+    --numLanes;
+}
+
+void VoiceBank::updateTable(int lane) noexcept {
+    const auto l = (size_t) lane;
+    table[l] = wavetables->getTable(waveType, WavetableBank::getLevelForIncrement(increment[l] + fmDepthIncrement));
+}
\ No newline at end of file
@@ -0,0 +1,256 @@
+/*
+  ==============================================================================
+
+    VoiceBank.h
+    Structure-of-arrays render engine that processes several voices at once
+    with SIMD registers.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include "WavetableBank.h"
+#include "DspMath.h"
+#include "AdsrData.h"
+
+/**
+ * VoiceBank renders every sounding voice from one set of packed arrays instead of one
+ * SynthVoice at a time. Oscillator phases and increments, FM phases and envelope levels are
+ * stored per lane, and the lanes of active notes are kept dense by swap-removal, so the render
+ * loop processes juce::dsp::SIMDRegister<float>::size() voices per instruction (4 with SSE or
+ * NEON, 8 with AVX). Builds without SIMD support fall back to a scalar loop over the same arrays.
+ *
+ * The envelope uses the same closed-form segments as AdsrData, so both renderers sound alike:
+ * between two stage changes every lane only updates its delta with one multiply and one add,
+ * whether the segment is linear or exponential, and the stage changes themselves are handled
+ * in scalar code at segment boundaries.
+ *
+ * Each lane is mixed into a left and a right sum with its own pan gains, so voices can be
+ * spread across the stereo field without rendering them twice.
+ *
+ * Lanes are addressed by the voice pool slot of the SynthVoice that owns the note, so the voice
+ * objects keep handling note bookkeeping while the bank does the rendering.
+ */
+class VoiceBank {
+
+public:
+    /** Number of lanes available, one per voice pool slot. */
+    static constexpr int maxLanes = 128;
+
+    VoiceBank();
+
+    /**
+     * Prepares the bank for playback. Must not be called from the audio thread.
+     *
+     * @param sampleRate The audio sample rate.
+     * @param samplesPerBlock The maximum number of samples per block.
+     */
+    void prepare(double sampleRate, int samplesPerBlock);
+
+    /**
+     * Selects the waveform of every lane.
+     *
+     * @param choice An integer representing the waveform type (0 for sine, 1 for saw, 2 for square).
+     */
+    void setWaveType(int choice);
+
+    /**
+     * Sets the frequency modulation applied to every lane.
+     *
+     * @param depth The depth of the frequency modulation in Hz.
+     * @param freq The frequency of the modulation oscillator in Hz.
+     */
+    void setFmParams(float depth, float freq);
+
+    /**
+     * Sets the envelope used by notes started from now on. A new sustain level is also applied
+     * to lanes that are already sustaining, as juce::ADSR does.
+     *
+     * @param attack The attack time in seconds.
+     * @param decay The decay time in seconds.
+     * @param sustain The sustain level.
+     * @param release The release time in seconds.
+     */
+    void setEnvelope(float attack, float decay, float sustain, float release);
+
+    /**
+     * Selects the shape of the envelope segments started from now on.
+     *
+     * @param curve The segment shape.
+     */
+    void setEnvelopeCurve(AdsrData::Curve curve) { envelope.setCurve(curve); }
+
+    /**
+     * Sets the envelope level below which a releasing lane is removed early.
+     *
+     * @param level The linear level, or 0 to always run the release to its end.
+     */
+    void setSilenceThreshold(float level) { envelope.setSilenceThreshold(level); }
+
+    /**
+     * Sets the linear gain applied to every lane.
+     *
+     * @param newGain The output gain of a single voice.
+     */
+    void setGain(float newGain) { gain = newGain; }
+
+    /**
+     * Sets the pan gains of the lane owned by a voice pool slot. They are kept for the slot,
+     * so notes started on it later use them too.
+     *
+     * @param slot The voice pool slot.
+     * @param left The gain applied to the left channel.
+     * @param right The gain applied to the right channel.
+     */
+    void setPanGains(int slot, float left, float right);
+
+    /**
+     * Starts a note in the lane owned by a voice pool slot, or restarts it if the lane is
+     * already sounding. A restarted lane attacks from its current level.
+     *
+     * @param slot The voice pool slot that plays the note.
+     * @param frequency The note frequency in Hz.
+     */
+    void noteOn(int slot, float frequency);
+
+    /**
+     * Changes the frequency of the lane owned by a voice pool slot, as the pitch wheel does,
+     * keeping its phase and envelope. Does nothing if the lane is not sounding.
+     *
+     * @param slot The voice pool slot that plays the note.
+     * @param frequency The new frequency in Hz.
+     */
+    void setFrequency(int slot, float frequency);
+
+    /**
+     * Moves the lane owned by a voice pool slot into its release stage.
+     *
+     * @param slot The voice pool slot that plays the note.
+     */
+    void noteOff(int slot);
+
+    /**
+     * Silences the lane owned by a voice pool slot immediately.
+     *
+     * @param slot The voice pool slot that played the note.
+     */
+    void stop(int slot);
+
+    /**
+     * Reads where the note in the lane owned by a voice pool slot has got to, so the voice can
+     * carry it on. The envelope position is at the bank's sample rate.
+     *
+     * @param slot The voice pool slot that plays the note.
+     * @param envelopePosition Receives the lane's envelope stage and remaining segment.
+     * @param carrierPhase Receives the lane's oscillator phase.
+     * @param modulatorPhase Receives the lane's FM phase.
+     * @return False if the lane is not sounding.
+     */
+    bool getNoteState(int slot, AdsrData::Position& envelopePosition, float& carrierPhase, float& modulatorPhase) const noexcept;
+
+    /**
+     * Carries on a note that the voice owning a slot has been rendering, from the voice's
+     * envelope and phases instead of the lane's own. Does nothing if the lane is not sounding.
+     *
+     * @param slot The voice pool slot that plays the note.
+     * @param envelopePosition The envelope stage and remaining segment, at the bank's sample rate.
+     *                         An idle envelope silences the lane.
+     * @param carrierPhase The oscillator phase.
+     * @param modulatorPhase The FM phase.
+     */
+    void setNoteState(int slot, const AdsrData::Position& envelopePosition, float carrierPhase, float modulatorPhase) noexcept;
+
+    /**
+     * Returns true while the lane owned by a voice pool slot is still sounding.
+     *
+     * @param slot The voice pool slot to check.
+     */
+    bool isSounding(int slot) const noexcept { return slotToLane[(size_t) slot] >= 0; }
+
+    /** Returns the number of lanes currently sounding. */
+    int getNumSounding() const noexcept { return numLanes; }
+
+    /**
+     * Renders every sounding lane and adds the panned mix to the buffer. A mono buffer
+     * receives the average of the two sides. Lanes whose release finishes during the block, or
+     * falls below the silence threshold, are removed.
+     *
+     * @param outputBuffer The buffer the voices are added to.
+     * @param startSample The first sample of the buffer to write.
+     * @param numSamples The number of samples to render.
+     */
+    void render(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples);
+
+private:
+    enum Stage { attackStage = 0, decayStage, sustainStage, releaseStage };
+
+    /**
+     * Adds numSamples of every lane to the left and right mixes without any stage change.
+     * The caller guarantees that no lane's segment ends inside the range.
+     */
+    void renderSegment(float* mixLeft, float* mixRight, int numSamples) noexcept;
+
+    /** Starts the attack stage of a lane from its current level. */
+    void enterAttack(int lane) noexcept;
+
+    /** Starts the decay stage of a lane from full level. */
+    void enterDecay(int lane) noexcept;
+
+    /** Holds a lane at the sustain level until its note is released. */
+    void enterSustain(int lane) noexcept;
+
+    /** Starts the release stage of a lane from its current level. */
+    void enterRelease(int lane) noexcept;
+
+    /** Moves a lane to the next stage once its segment has ended. */
+    void advanceStage(int lane) noexcept;
+
+    /** Loads a segment into a lane and enters the given stage. */
+    void startSegment(int lane, Stage newStage, const AdsrData::Segment& segment) noexcept;
+
+    /** Returns the envelope level a lane is currently at. */
+    float getLevel(int lane) const noexcept { return envOffset[(size_t) lane] + envDelta[(size_t) lane]; }
+
+    /** Removes a lane by moving the last sounding lane into its place. */
+    void removeLane(int lane) noexcept;
+
+    /** Points a lane at the table level of the current waveform that suits its frequency and the FM depth. */
+    void updateTable(int lane) noexcept;
+
+    // Per-lane state. Only the first numLanes entries are sounding; the rest are kept silent so
+    // that a SIMD register reaching past the last lane reads harmless values.
+    alignas(64) std::array<float, maxLanes> phase{};         ///< Read position within the cycle, in [0, 1).
+    alignas(64) std::array<float, maxLanes> increment{};     ///< Carrier cycles per sample without modulation.
+    alignas(64) std::array<float, maxLanes> fmPhase{};       ///< Phase of each lane's sine modulator, in [0, 1).
+    alignas(64) std::array<float, maxLanes> envOffset{};     ///< Level the current envelope segment is expressed around.
+    alignas(64) std::array<float, maxLanes> envDelta{};      ///< Current envelope level minus the offset.
+    alignas(64) std::array<float, maxLanes> envCoefficient{}; ///< Multiplier applied to the delta every sample.
+    alignas(64) std::array<float, maxLanes> envRate{};       ///< Amount added to the delta every sample.
+    alignas(64) std::array<float, maxLanes> panLeft{};       ///< Gain of each lane in the left mix.
+    alignas(64) std::array<float, maxLanes> panRight{};      ///< Gain of each lane in the right mix.
+    std::array<int, maxLanes> samplesLeft{};                 ///< Samples until the current segment ends.
+    std::array<int, maxLanes> stage{};                       ///< The envelope Stage of each lane.
+    std::array<const float*, maxLanes> table{};              ///< The table each lane reads from.
+    std::array<int, maxLanes> laneToSlot{};                  ///< The voice pool slot that owns each lane.
+    std::array<int, maxLanes> slotToLane{};                  ///< The lane of each voice pool slot, or -1.
+    int numLanes{ 0 };                                       ///< Number of sounding lanes.
+    std::array<float, maxLanes> slotPanLeft{};               ///< Left gain of each voice pool slot.
+    std::array<float, maxLanes> slotPanRight{};              ///< Right gain of each voice pool slot.
+
+    juce::SharedResourcePointer<WavetableBank> wavetables;   ///< Band-limited tables shared with OscData.
+    std::vector<float> mixLeft;                              ///< Left sum of every lane, sized in prepare().
+    std::vector<float> mixRight;                             ///< Right sum of every lane, sized in prepare().
+    double sampleRate{ 44100.0 };
+    int waveType{ WavetableBank::sine };
+    float fmIncrement{ 0.0f };                               ///< Modulator cycles per sample.
+    float fmDepthIncrement{ 0.0f };                          ///< FM depth in cycles per sample.
+    float fmDepth{ 0.0f };
+    float fmFrequency{ 0.0f };
+    float gain{ 0.3f };
+    AdsrData envelope;                                       ///< Envelope settings; builds the segments of every lane.
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(VoiceBank)
+};
\ No newline at end of file
@@ -0,0 +1,81 @@
+/*
+  ==============================================================================
+
+    WavetableBank.cpp
+    Builds the band-limited wavetables from the Fourier series of each waveform.
+
+  ==============================================================================
+*/
+
+#include "WavetableBank.h"
+
+WavetableBank::WavetableBank() {
+    tables.resize((size_t) (numWaveforms * numLevels) * (size_t) (tableSize + 1));
+
+    // One cycle of a sine, used to evaluate every harmonic by index instead of calling std::sin.
+    std::vector<double> sineTable((size_t) tableSize);
+    for (int i = 0; i < tableSize; ++i)
+        sineTable[(size_t) i] = std::sin(juce::MathConstants<double>::twoPi * i / tableSize);
+
+    for (int waveform = 0; waveform < numWaveforms; ++waveform) {
+        for (int level = 0; level < numLevels; ++level) {
+            // The harmonic at tableSize / 2 is the table's own Nyquist frequency and is always zero.
+            const int maxHarmonic = juce::jmin((tableSize / 2) >> level, tableSize / 2 - 1);
+            buildLevel(waveform, level, juce::jmax(1, maxHarmonic), sineTable);
+        }
+    }
+}
+
+// Sums the Fourier series of the waveform up to maxHarmonic into one table.
+void WavetableBank::buildLevel(int waveform, int level, int maxHarmonic, const std::vector<double>& sineTable) {
+    std::vector<double> sum((size_t) tableSize, 0.0);
+
+    for (int harmonic = 1; harmonic <= maxHarmonic; ++harmonic) {
+        double amplitude = 0.0;
+
+        switch (waveform) {
+        case sine:
+            amplitude = harmonic == 1 ? 1.0 : 0.0;
+            break;
+        case saw:
+            // Rising ramp, jumping from 1 to -1 half way through the cycle.
+            amplitude = (harmonic % 2 == 1 ? 2.0 : -2.0) / (juce::MathConstants<double>::pi * harmonic);
+            break;
+        case square:
+            // Odd harmonics only.
+            amplitude = harmonic % 2 == 1 ? 4.0 / (juce::MathConstants<double>::pi * harmonic) : 0.0;
+            break;
+        default:
+            jassertfalse;
+            break;
+        }
+
+        if (amplitude == 0.0)
+            continue;
+
+        for (int i = 0; i < tableSize; ++i)
+            sum[(size_t) i] += amplitude * sineTable[(size_t) ((harmonic * i) & (tableSize - 1))];
+    }
+
+    auto* table = tables.data() + (size_t) (waveform * numLevels + level) * (size_t) (tableSize + 1);
+
+    for (int i = 0; i < tableSize; ++i)
+        table[i] = (float) sum[(size_t) i];
+
+    table[tableSize] = table[0];
+}
+
+// Picks the smallest level whose highest harmonic, at this increment, is still below Nyquist.
+int WavetableBank::getLevelForIncrement(float phaseIncrement) noexcept {
+    // Level k is safe when ((tableSize / 2) >> k) * increment <= 0.5, i.e. 2^k >= tableSize * increment.
+    const float harmonicsAtNyquist = std::abs(phaseIncrement) * (float) tableSize;
+
+    if (harmonicsAtNyquist <= 1.0f)
+        return 0;
+
+    int exponent = 0;
+    const float mantissa = std::frexp(harmonicsAtNyquist, &exponent);
+    const int level = mantissa > 0.5f ? exponent : exponent - 1;
+
+    return juce::jmin(level, numLevels - 1);
+}
\ No newline at end of file
@@ -0,0 +1,85 @@
+/*
+  ==============================================================================
+
+    WavetableBank.h
+    Band-limited, per-octave mipmapped wavetables shared by every oscillator.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ * WavetableBank holds one single-cycle table per waveform and per octave. Each level is
+ * built additively with only the harmonics that stay below Nyquist for the notes it serves,
+ * so reading the right level never aliases. The tables are built once when the first
+ * oscillator is created and are read-only afterwards, so all voices share one instance
+ * through juce::SharedResourcePointer.
+ */
+class WavetableBank {
+
+public:
+    /** The waveforms available, in the same order as the OSC1WAVETYPE choices. */
+    enum Waveform {
+        sine = 0,
+        saw,
+        square,
+        numWaveforms
+    };
+
+    /** Number of samples in one cycle of every table. Must be a power of two. */
+    static constexpr int tableSize = 2048;
+
+    /** Number of mip levels. Level k holds at most (tableSize / 2) >> k harmonics. */
+    static constexpr int numLevels = 11;
+
+    /**
+     * Builds every table for every waveform. This is relatively expensive and is only
+     * ever done once per process.
+     */
+    WavetableBank();
+
+    /**
+     * Returns a table of tableSize + 1 samples, where the last sample repeats the first
+     * so that interpolated reads never need to wrap.
+     *
+     * @param waveform One of the Waveform values.
+     * @param level The mip level, as returned by getLevelForIncrement().
+     */
+    const float* getTable(int waveform, int level) const noexcept {
+        return tables.data() + (size_t) (waveform * numLevels + level) * (size_t) (tableSize + 1);
+    }
+
+    /**
+     * Chooses the mip level whose highest harmonic stays below Nyquist for a given
+     * phase increment.
+     *
+     * @param phaseIncrement The oscillator frequency divided by the sample rate.
+     * @return The mip level to read from, in [0, numLevels).
+     */
+    static int getLevelForIncrement(float phaseIncrement) noexcept;
+
+    /**
+     * Reads a table with linear interpolation.
+     *
+     * @param table A table returned by getTable().
+     * @param phase The read position as a fraction of a cycle, in [0, 1). A phase of exactly 1
+     *              reads the wrap-around sample rather than past the end of the table.
+     */
+    static float read(const float* table, float phase) noexcept {
+        const float position = phase * (float) tableSize;
+        const int index = juce::jlimit(0, tableSize - 1, (int) position);
+        const float fraction = position - (float) index;
+        return table[index] + fraction * (table[index + 1] - table[index]);
+    }
+
+private:
+    /** Fills one table from the Fourier series of a waveform, keeping at most maxHarmonic harmonics. */
+    void buildLevel(int waveform, int level, int maxHarmonic, const std::vector<double>& sineTable);
+
+    std::vector<float> tables; ///< All tables, stored contiguously by waveform and then by level.
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WavetableBank)
+};
\ No newline at end of file
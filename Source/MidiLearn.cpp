@@ -0,0 +1,79 @@
+/*
+  ==============================================================================
+
+    MidiLearn.cpp
+    Routes MIDI controllers to plugin parameters through a fixed table that
+    the audio thread reads without locking.
+
+  ==============================================================================
+*/
+
+#include "MidiLearn.h"
+
+MidiLearn::MidiLearn() {
+    clearAll();
+}
+
+int MidiLearn::getKey(int midiChannel, int controllerNumber) noexcept {
+    if (midiChannel < 1 || midiChannel > numChannels || !juce::isPositiveAndBelow(controllerNumber, numControllers))
+        return -1;
+
+    return (midiChannel - 1) * numControllers + controllerNumber;
+}
+
+void MidiLearn::setRoute(int midiChannel, int controllerNumber, int parameterIndex) noexcept {
+    const int key = getKey(midiChannel, controllerNumber);
+
+    if (key >= 0)
+        routes[(size_t) key].store(parameterIndex, std::memory_order_relaxed);
+}
+
+int MidiLearn::getRoute(int midiChannel, int controllerNumber) const noexcept {
+    const int key = getKey(midiChannel, controllerNumber);
+    return key >= 0 ? routes[(size_t) key].load(std::memory_order_relaxed) : -1;
+}
+
+bool MidiLearn::findController(int parameterIndex, int& midiChannel, int& controllerNumber) const noexcept {
+    for (int key = 0; key < numChannels * numControllers; ++key) {
+        if (routes[(size_t) key].load(std::memory_order_relaxed) == parameterIndex) {
+            midiChannel = key / numControllers + 1;
+            controllerNumber = key % numControllers;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void MidiLearn::clearRoutesTo(int parameterIndex) noexcept {
+    for (auto& route : routes) {
+        int expected = parameterIndex;
+        route.compare_exchange_strong(expected, -1, std::memory_order_relaxed);
+    }
+}
+
+void MidiLearn::clearAll() noexcept {
+    for (auto& route : routes)
+        route.store(-1, std::memory_order_relaxed);
+}
+
+//==============================================================================
+// Taking the armed parameter with an exchange means a learn completes at most once, even if
+// the UI arms another parameter at the same moment.
+int MidiLearn::handleController(int midiChannel, int controllerNumber) noexcept {
+    const int key = getKey(midiChannel, controllerNumber);
+
+    if (key < 0)
+        return -1;
+
+    if (learning.load(std::memory_order_relaxed) >= 0) {
+        const int parameterIndex = learning.exchange(-1);
+
+        if (parameterIndex >= 0) {
+            clearRoutesTo(parameterIndex);
+            routes[(size_t) key].store(parameterIndex, std::memory_order_relaxed);
+        }
+    }
+
+    return routes[(size_t) key].load(std::memory_order_relaxed);
+}
\ No newline at end of file
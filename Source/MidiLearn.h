@@ -0,0 +1,103 @@
+/*
+  ==============================================================================
+
+    MidiLearn.h
+    Routes MIDI controllers to plugin parameters through a fixed table that
+    the audio thread reads without locking.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+/**
+ * MidiLearn holds which parameter each of the 16 x 128 MIDI controllers moves. Every entry is
+ * an atomic parameter index, so the UI thread can change routes while the audio thread reads
+ * them, without either of them locking or allocating.
+ *
+ * A route is made by arming learning for a parameter on the UI thread; the next controller the
+ * audio thread sees is then routed to it, replacing any controller the parameter had before.
+ * Routes can also be set and cleared directly.
+ *
+ * Parameters are identified by their index in AudioProcessor::getParameters(). Only
+ * automatable parameters can be learned, since the others may need the host to be told
+ * about a change, as the oversampling mode does with its latency.
+ */
+class MidiLearn {
+
+public:
+    /** The number of MIDI channels. */
+    static constexpr int numChannels = 16;
+
+    /** The number of controllers per channel. */
+    static constexpr int numControllers = 128;
+
+    /** Clears every route. */
+    MidiLearn();
+
+    /**
+     * Routes the next controller that moves to a parameter. UI thread.
+     * @param parameterIndex The parameter's index in AudioProcessor::getParameters().
+     */
+    void startLearning(int parameterIndex) noexcept { learning.store(parameterIndex); }
+
+    /** Stops waiting for a controller to learn. */
+    void stopLearning() noexcept { learning.store(-1); }
+
+    /** Returns the parameter waiting for a controller, or -1. */
+    int getLearningParameter() const noexcept { return learning.load(); }
+
+    /**
+     * Routes a controller to a parameter, replacing the controller's previous route.
+     * @param midiChannel The MIDI channel, from 1 to 16.
+     * @param controllerNumber The controller number, from 0 to 127.
+     * @param parameterIndex The parameter's index, or -1 to clear the route.
+     */
+    void setRoute(int midiChannel, int controllerNumber, int parameterIndex) noexcept;
+
+    /**
+     * Returns the parameter a controller is routed to, or -1.
+     * @param midiChannel The MIDI channel, from 1 to 16.
+     * @param controllerNumber The controller number, from 0 to 127.
+     */
+    int getRoute(int midiChannel, int controllerNumber) const noexcept;
+
+    /**
+     * Finds the first controller routed to a parameter. UI thread.
+     * @param parameterIndex The parameter's index.
+     * @param midiChannel Receives the MIDI channel of the controller.
+     * @param controllerNumber Receives the controller number.
+     * @return False if no controller moves the parameter.
+     */
+    bool findController(int parameterIndex, int& midiChannel, int& controllerNumber) const noexcept;
+
+    /**
+     * Clears every route to a parameter.
+     * @param parameterIndex The parameter's index.
+     */
+    void clearRoutesTo(int parameterIndex) noexcept;
+
+    /** Clears every route. */
+    void clearAll() noexcept;
+
+    /**
+     * Called by the audio thread for every controller change. Completes a pending learn with
+     * this controller, then returns the parameter it is routed to.
+     * @param midiChannel The MIDI channel, from 1 to 16.
+     * @param controllerNumber The controller number, from 0 to 127.
+     * @return The parameter's index, or -1 if the controller is not routed.
+     */
+    int handleController(int midiChannel, int controllerNumber) noexcept;
+
+private:
+    /** Returns the index of a channel and controller in routes, or -1 if either is out of range. */
+    static int getKey(int midiChannel, int controllerNumber) noexcept;
+
+    std::array<std::atomic<int>, numChannels * numControllers> routes; ///< Parameter index of every controller, or -1.
+    std::atomic<int> learning{ -1 };                                    ///< The parameter waiting for a controller, or -1.
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MidiLearn)
+};
\ No newline at end of file
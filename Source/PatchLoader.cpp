@@ -0,0 +1,209 @@
+/*
+  ==============================================================================
+
+    PatchLoader.cpp
+    Parses new patches away from the audio thread and hands them to it through
+    an atomic pointer.
+
+  ==============================================================================
+*/
+
+#include "PatchLoader.h"
+
+PatchLoader::PatchLoader(juce::AudioProcessor& owner) : juce::Thread("Patch Loader"), processor(owner) {
+    // Program changes should be ready by the next block, so the thread is not given a background priority.
+    startThread(juce::Thread::Priority::normal);
+}
+
+PatchLoader::~PatchLoader() {
+    signalThreadShouldExit();
+    wakeUp.post();
+    stopThread(1000);
+    cancelPendingUpdate();
+
+    // Audio has stopped by now, so every patch can be freed here.
+    delete pending.exchange(nullptr);
+    delete retiring;
+    freeRetired();
+}
+
+void PatchLoader::loadNow(std::unique_ptr<PatchState> patch) {
+    jassert(patch != nullptr);
+    publish(std::move(patch), isAudioRunning());
+}
+
+void PatchLoader::loadAsync(const void* data, size_t size) {
+    {
+        const juce::ScopedLock sl(requestLock);
+        request.replaceAll(data, size);
+        hasRequest = true;
+    }
+
+    wakeUp.post();
+}
+
+// Thread::notify() would lock the thread's event, so the audio thread posts to the semaphore instead.
+void PatchLoader::requestProgram(int program) noexcept {
+    jassert(juce::isPositiveAndBelow(program, presetBank->getNumPrograms()));
+
+    requestedProgram.store(program, std::memory_order_release);
+    wakeUp.post();
+}
+
+// Called from processBlock, so audio is running by definition; no wall-clock check is involved.
+bool PatchLoader::loadProgramNow(int program) {
+    jassert(processor.isNonRealtime());
+
+    const void* programData = nullptr;
+    size_t programSize = 0;
+
+    if (!presetBank->getPatchData(program, programData, programSize))
+        return false;
+
+    auto patch = PatchState::read(processor, programData, programSize);
+
+    if (patch == nullptr)
+        return false;
+
+    publish(std::move(patch), true);
+    return true;
+}
+
+//==============================================================================
+PatchState* PatchLoader::poll(bool canAccept) noexcept {
+    lastPoll.store(juce::jmax((juce::uint32) 1, juce::Time::getMillisecondCounter()), std::memory_order_relaxed);
+
+    // Hand back a patch that found every slot full last time.
+    if (retiring != nullptr) {
+        PatchState* patch = retiring;
+        retiring = nullptr;
+        retire(patch);
+    }
+
+    return canAccept ? pending.exchange(nullptr, std::memory_order_acq_rel) : nullptr;
+}
+
+void PatchLoader::retire(PatchState* patch) noexcept {
+    for (auto& slot : retired) {
+        PatchState* expected = nullptr;
+
+        if (slot.compare_exchange_strong(expected, patch, std::memory_order_release))
+            return;
+    }
+
+    // Every slot is waiting to be freed; try again on the next poll.
+    jassert(retiring == nullptr);
+    retiring = patch;
+}
+
+//==============================================================================
+void PatchLoader::run() {
+    while (!threadShouldExit()) {
+        juce::MemoryBlock data;
+        bool hasData = false;
+
+        {
+            const juce::ScopedLock sl(requestLock);
+            std::swap(hasData, hasRequest);
+
+            if (hasData)
+                data.swapWith(request);
+        }
+
+        if (hasData)
+            if (auto patch = PatchState::read(processor, data.getData(), data.getSize()))
+                publish(std::move(patch), isAudioRunning());
+
+        // A program is parsed in place from the mapped bank, without copying it first.
+        const int program = requestedProgram.exchange(-1, std::memory_order_acquire);
+        const void* programData = nullptr;
+        size_t programSize = 0;
+
+        if (program >= 0 && presetBank->getPatchData(program, programData, programSize))
+            if (auto patch = PatchState::read(processor, programData, programSize))
+                publish(std::move(patch), isAudioRunning());
+
+        freeRetired();
+        wakeUp.wait(idleWaitMs);
+    }
+}
+
+// Nothing here waits for the audio thread: it ignores the parameters while the patch is pending,
+// so they may be set before or after it takes the patch.
+void PatchLoader::publish(std::unique_ptr<PatchState> patch, bool toAudioThread) {
+    const juce::ScopedLock sl(publishLock);
+
+    // Keep a copy of the values: once published, the patch belongs to whoever takes it.
+    std::vector<float> values;
+
+    for (int index = 0; index < patch->getNumValues(); ++index)
+        values.push_back(patch->getValue(index));
+
+    // Without audio running there is nothing to fade, and the parameter cache picks the new values
+    // up on the first block. A patch the audio thread never took is freed here.
+    if (toAudioThread)
+        delete pending.exchange(patch.release(), std::memory_order_acq_rel);
+
+    // Parameter listeners expect the message thread, so other threads hand the values over to it.
+    // An offline render may have no message loop to do that, so the values are set here instead.
+    // A write-back still queued from an older patch is replaced either way.
+    if (processor.isNonRealtime() || juce::MessageManager::existsAndIsCurrentThread()) {
+        {
+            const juce::ScopedLock wl(writeBackLock);
+            hasWriteBack = false;
+        }
+
+        setParameters(values);
+    }
+    else {
+        {
+            const juce::ScopedLock wl(writeBackLock);
+            writeBack = std::move(values);
+            hasWriteBack = true;
+        }
+
+        triggerAsyncUpdate();
+    }
+}
+
+void PatchLoader::handleAsyncUpdate() {
+    std::vector<float> values;
+
+    {
+        const juce::ScopedLock wl(writeBackLock);
+
+        if (!hasWriteBack)
+            return;
+
+        values.swap(writeBack);
+        hasWriteBack = false;
+    }
+
+    setParameters(values);
+}
+
+void PatchLoader::setParameters(const std::vector<float>& values) {
+    const auto& parameters = processor.getParameters();
+
+    for (int index = 0; index < juce::jmin(parameters.size(), (int) values.size()); ++index) {
+        auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameters[index]);
+
+        if (ranged == nullptr)
+            continue;
+
+        const float normalised = ranged->convertTo0to1(values[(size_t) index]);
+
+        if (ranged->getValue() != normalised)
+            ranged->setValueNotifyingHost(normalised);
+    }
+}
+
+void PatchLoader::freeRetired() {
+    for (auto& slot : retired)
+        delete slot.exchange(nullptr, std::memory_order_acquire);
+}
+
+bool PatchLoader::isAudioRunning() const noexcept {
+    const auto last = lastPoll.load(std::memory_order_relaxed);
+    return last != 0 && juce::Time::getMillisecondCounter() - last < audioTimeoutMs;
+}
\ No newline at end of file
@@ -0,0 +1,160 @@
+/*
+  ==============================================================================
+
+    PatchLoader.h
+    Parses new patches away from the audio thread and hands them to it through
+    an atomic pointer.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "Data/PatchState.h"
+#include "Data/PresetBank.h"
+#include "RealtimeSemaphore.h"
+
+/**
+ * PatchLoader moves a new patch from the thread that asked for it to the audio thread
+ * without the audio thread ever locking, allocating or freeing:
+ *
+ * 1. The data is parsed into a PatchState, either on the calling thread (loadNow) or on the
+ *    loader's background thread (loadAsync).
+ * 2. The parsed patch is published by swapping it into an atomic pointer. A patch that the
+ *    audio thread has not picked up yet is simply replaced and freed.
+ * 3. The audio thread takes the pointer in poll(), fades out, applies the values to its
+ *    parameter cache, fades back in and hands the patch back with retire(). While a patch is
+ *    pending it stops reading the host-visible parameters, so they can change at any time.
+ * 4. The host-visible parameters are set to the same values on the message thread, so the
+ *    editor and the host see the new patch, and listeners such as the latency update run where
+ *    they expect to. If audio is not running, the patch is not published at all and only the
+ *    parameters are set. Retired patches are freed by the background thread.
+ *
+ * While the processor renders offline there may be no message loop, so the parameters are set on
+ * the calling thread instead, and program changes are loaded synchronously with loadProgramNow()
+ * so a render does not depend on when the background thread runs.
+ *
+ * Programs of the shared PresetBank are requested by number, which is real-time safe, so a
+ * MIDI program change can be handled on the audio thread: the request is an atomic store and a
+ * lock-free semaphore post. Only the selected preset is parsed, straight from the mapped bank,
+ * and as with every patch the switch starts on the first block after the background thread has
+ * published it, so it is not tied to any particular block.
+ */
+class PatchLoader : private juce::Thread, private juce::AsyncUpdater {
+
+public:
+    /**
+     * Starts the background thread.
+     * @param processor The processor whose parameters the patches set.
+     */
+    explicit PatchLoader(juce::AudioProcessor& processor);
+
+    /** Stops the background thread and frees every patch still held. */
+    ~PatchLoader() override;
+
+    /**
+     * Publishes a patch the caller has parsed on its own thread. Used for the host's
+     * setStateInformation, which expects the parameters to be set when it returns: on the message
+     * thread they are set before it returns, and it never waits for the audio thread. Must not be
+     * called from the audio thread.
+     * @param patch The patch, read with PatchState::read().
+     */
+    void loadNow(std::unique_ptr<PatchState> patch);
+
+    /**
+     * Copies the data and lets the background thread parse and publish it. Must not be called
+     * from the audio thread. A request that has not been parsed yet is replaced.
+     * @param data The binary form of a PatchState.
+     * @param size The number of bytes of data.
+     */
+    void loadAsync(const void* data, size_t size);
+
+    /**
+     * Asks the background thread to load a program of the preset bank. Real-time safe, so it
+     * may be called from the audio thread. The patch is usually ready a block or two later, but
+     * that depends on the background thread being scheduled, so it is not guaranteed.
+     * @param program The program number, which must be in range.
+     */
+    void requestProgram(int program) noexcept;
+
+    /**
+     * Parses a program of the preset bank on the calling thread and publishes it straight to the
+     * audio thread, whose next poll() takes it. Only for the audio thread while the processor is
+     * rendering offline, where it may block and allocate; the result then depends only on the
+     * block in which the program change arrives.
+     * @param program The program number, which must be in range.
+     * @return False if the program could not be read.
+     */
+    bool loadProgramNow(int program);
+
+    /** Returns the preset bank shared by every instance. */
+    const PresetBank& getPresetBank() const noexcept { return *presetBank; }
+
+    /**
+     * Called by the audio thread at the start of every block.
+     * @param canAccept Whether the audio thread is ready to switch to a new patch.
+     * @return A newly published patch that the audio thread now owns until it passes it to
+     *         retire(), or nullptr.
+     */
+    PatchState* poll(bool canAccept) noexcept;
+
+    /**
+     * Returns true while a published patch waits for the audio thread. The audio thread must not
+     * read the host-visible parameters meanwhile, since they may already hold the new patch's values.
+     */
+    bool hasPending() const noexcept { return pending.load(std::memory_order_acquire) != nullptr; }
+
+    /**
+     * Hands a patch taken from poll() back to be freed on the background thread. Audio thread only.
+     * @param patch The patch, which the caller must not use afterwards.
+     */
+    void retire(PatchState* patch) noexcept;
+
+private:
+    void run() override;
+
+    /**
+     * Publishes a parsed patch and sets the parameters, straight away on the message thread or
+     * while rendering offline, and through the message thread otherwise.
+     * @param patch The parsed patch.
+     * @param toAudioThread Whether to hand the patch to the audio thread, or only set the parameters.
+     */
+    void publish(std::unique_ptr<PatchState> patch, bool toAudioThread);
+
+    /** Sets the parameters queued by publish() from another thread. */
+    void handleAsyncUpdate() override;
+
+    /** Sets the host-visible parameters to a patch's values. Message thread only. */
+    void setParameters(const std::vector<float>& values);
+
+    /** Frees the patches the audio thread has retired. */
+    void freeRetired();
+
+    /** Returns true if the audio thread has polled recently. */
+    bool isAudioRunning() const noexcept;
+
+    static constexpr int idleWaitMs = 20;            ///< Longest the background thread sleeps between checks.
+    static constexpr juce::uint32 audioTimeoutMs = 200; ///< Time without a poll after which audio counts as stopped.
+    static constexpr int maxRetired = 4;             ///< Patches the audio thread can hand back before they are freed.
+
+    juce::AudioProcessor& processor;
+    juce::SharedResourcePointer<PresetBank> presetBank;  ///< Mapped once per process.
+
+    juce::CriticalSection requestLock;               ///< Guards request; never taken by the audio thread.
+    juce::MemoryBlock request;                       ///< Data waiting for the background thread.
+    bool hasRequest{ false };
+    juce::CriticalSection publishLock;               ///< Serialises publish() between callers; never taken by the audio thread.
+    juce::CriticalSection writeBackLock;             ///< Guards writeBack; never taken by the audio thread.
+    std::vector<float> writeBack;                    ///< Values waiting to be set on the message thread.
+    bool hasWriteBack{ false };
+
+    std::atomic<PatchState*> pending{ nullptr };     ///< Parsed patch not yet taken by the audio thread.
+    std::array<std::atomic<PatchState*>, maxRetired> retired{}; ///< Patches handed back by the audio thread.
+    PatchState* retiring{ nullptr };                 ///< A retired patch waiting for a free slot, audio thread only.
+    std::atomic<juce::uint32> lastPoll{ 0 };         ///< Time of the audio thread's last poll, in milliseconds.
+    std::atomic<int> requestedProgram{ -1 };         ///< Program waiting for the background thread, or -1.
+    RealtimeSemaphore wakeUp;                        ///< Posted when there is a request; the thread also wakes every idleWaitMs.
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PatchLoader)
+};
\ No newline at end of file
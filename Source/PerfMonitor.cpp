@@ -0,0 +1,131 @@
+/*
+  ==============================================================================
+
+    PerfMonitor.cpp
+    Records how long each stage of the audio thread takes into a lock-free
+    ring, and tracks the DSP load and the blocks that missed their deadline.
+
+  ==============================================================================
+*/
+
+#include "PerfMonitor.h"
+
+static_assert((PerfMonitor::capacity & (PerfMonitor::capacity - 1)) == 0, "The ring is indexed with a mask");
+
+const char* PerfMonitor::getStageName(int stage) noexcept {
+    switch (stage) {
+        case blockStage:     return "Block";
+        case parameterStage: return "Parameters";
+        case voiceStage:     return "Voices";
+        case mixStage:       return "Mix";
+        case overrunStage:   return "Overrun";
+        default:             return "Unknown";
+    }
+}
+
+void PerfMonitor::prepare(double newSampleRate) noexcept {
+    sampleRate = newSampleRate;
+}
+
+//==============================================================================
+// The start counter is bumped before the slot is touched, and the release fence keeps the slot's
+// stores after it, so a reader that sees any of them also sees the bump.
+void PerfMonitor::record(Stage stage, juce::int64 start, juce::int64 end, int voices, int numSamples) noexcept {
+    const auto index = numStarted.load(std::memory_order_relaxed);
+    numStarted.store(index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    auto& slot = slots[(size_t) (index & (capacity - 1))];
+    slot.start.store(start, std::memory_order_relaxed);
+    slot.end.store(end, std::memory_order_relaxed);
+    slot.stage.store(stage, std::memory_order_relaxed);
+    slot.numVoices.store(voices, std::memory_order_relaxed);
+    slot.numSamples.store(numSamples, std::memory_order_relaxed);
+
+    numWritten.store(index + 1, std::memory_order_release);
+}
+
+// The load is the block's time over its duration, so 1 means the block only just made its deadline.
+void PerfMonitor::recordBlock(juce::int64 start, juce::int64 end, int voices, int numSamples) noexcept {
+    record(blockStage, start, end, voices, numSamples);
+    numVoices.store(voices, std::memory_order_relaxed);
+
+    if (numSamples <= 0 || sampleRate <= 0.0)
+        return;
+
+    const double duration = numSamples / sampleRate;
+    const float blockLoad = (float) ((double) (end - start) / ticksPerSecond / duration);
+
+    if (blockLoad > 1.0f) {
+        numOverruns.fetch_add(1, std::memory_order_relaxed);
+        record(overrunStage, end, end, voices, numSamples);
+    }
+
+    // One-pole smoothing and peak decay in seconds, so the meter moves the same way at every block size.
+    const float smoothing = (float) (1.0 - std::exp(-duration / loadSeconds));
+    const float decay = (float) std::exp(-duration / peakSeconds);
+    const float previous = load.load(std::memory_order_relaxed);
+
+    load.store(previous + (blockLoad - previous) * smoothing, std::memory_order_relaxed);
+    peakLoad.store(juce::jmax(blockLoad, peakLoad.load(std::memory_order_relaxed) * decay), std::memory_order_relaxed);
+}
+
+//==============================================================================
+// Copies first and checks afterwards: any slot a write has started on since the copy began is dropped.
+void PerfMonitor::getEvents(std::vector<Event>& destination) const {
+    const auto end = numWritten.load(std::memory_order_acquire);
+    const auto begin = end > (juce::uint64) capacity ? end - (juce::uint64) capacity : 0;
+
+    destination.clear();
+    destination.reserve((size_t) (end - begin));
+
+    for (auto index = begin; index < end; ++index) {
+        const auto& slot = slots[(size_t) (index & (capacity - 1))];
+        destination.push_back({ slot.start.load(std::memory_order_relaxed), slot.end.load(std::memory_order_relaxed),
+                                slot.stage.load(std::memory_order_relaxed), slot.numVoices.load(std::memory_order_relaxed),
+                                slot.numSamples.load(std::memory_order_relaxed) });
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    const auto started = numStarted.load(std::memory_order_relaxed);
+    const auto firstValid = started > (juce::uint64) capacity ? started - (juce::uint64) capacity : 0;
+
+    if (firstValid > begin)
+        destination.erase(destination.begin(), destination.begin() + (std::ptrdiff_t) juce::jmin((juce::uint64) destination.size(), firstValid - begin));
+}
+
+// Times are written in microseconds from the first event, which is what the trace format expects.
+bool PerfMonitor::writeChromeTrace(const juce::File& file) const {
+    std::vector<Event> events;
+    getEvents(events);
+
+    file.deleteFile();
+    juce::FileOutputStream output(file);
+
+    if (output.failedToOpen())
+        return false;
+
+    const juce::int64 origin = events.empty() ? 0 : events.front().start;
+    const auto toMicroseconds = [this, origin](juce::int64 ticks) { return (double) (ticks - origin) * 1.0e6 / ticksPerSecond; };
+
+    output << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    for (size_t i = 0; i < events.size(); ++i) {
+        const auto& event = events[i];
+        const bool instant = event.stage == overrunStage;
+
+        output << "{\"name\":\"" << getStageName(event.stage) << "\",\"cat\":\"audio\",\"ph\":\"" << (instant ? "i\",\"s\":\"t" : "X")
+               << "\",\"pid\":1,\"tid\":1,\"ts\":" << juce::String(toMicroseconds(event.start), 3);
+
+        if (!instant)
+            output << ",\"dur\":" << juce::String(toMicroseconds(event.end) - toMicroseconds(event.start), 3);
+
+        output << ",\"args\":{\"voices\":" << juce::String(event.numVoices) << ",\"samples\":" << juce::String(event.numSamples) << "}}"
+               << (i + 1 < events.size() ? ",\n" : "\n");
+    }
+
+    output << "]}\n";
+    output.flush();
+    return output.getStatus().wasOk();
+}
\ No newline at end of file
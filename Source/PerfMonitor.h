@@ -0,0 +1,142 @@
+/*
+  ==============================================================================
+
+    PerfMonitor.h
+    Records how long each stage of the audio thread takes into a lock-free
+    ring, and tracks the DSP load and the blocks that missed their deadline.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <vector>
+
+/**
+ * PerfMonitor is a flight recorder for the audio thread. The processor and the engine time their
+ * stages with the high-resolution clock and record each one as an event in a fixed ring. The ring
+ * has a single producer, the audio thread, which never waits: once it is full, every event
+ * overwrites the oldest one, so the ring always holds the most recent history.
+ *
+ * Readers copy the ring on another thread. Every event is written between two counters, so a
+ * reader can tell which of the events it copied the audio thread may have overwritten meanwhile,
+ * and drops them instead of returning torn data.
+ *
+ * Each block also updates the DSP load, the time the block took as a share of its duration, and
+ * counts the blocks that took longer than their duration, since those can make the host drop out.
+ * These are atomics that the editor polls for its meter.
+ */
+class PerfMonitor {
+
+public:
+    /** The stages the audio thread records. */
+    enum Stage {
+        blockStage = 0, ///< The whole of processBlock.
+        parameterStage, ///< Reading the parameters and pushing the changes to the engine.
+        voiceStage,     ///< One run of the voices: the oscillators and envelopes, fused in one loop.
+        mixStage,       ///< Decimating the oversampled voices and delaying the output to match them.
+        overrunStage,   ///< A block that took longer than its duration; recorded as an instant.
+        numStages
+    };
+
+    /** The number of events the ring holds. Must be a power of two. */
+    static constexpr int capacity = 1 << 13;
+
+    /** One recorded stage, with its times in high-resolution ticks. */
+    struct Event {
+        juce::int64 start{ 0 };
+        juce::int64 end{ 0 };
+        int stage{ blockStage };
+        int numVoices{ 0 };   ///< The voices that were sounding.
+        int numSamples{ 0 };  ///< The samples the stage covered.
+    };
+
+    /** Returns the current time in high-resolution ticks. */
+    static juce::int64 now() noexcept { return juce::Time::getHighResolutionTicks(); }
+
+    /** Returns the name a stage is shown with in a trace. */
+    static const char* getStageName(int stage) noexcept;
+
+    /**
+     * Sets the sample rate that block durations are measured against. Must not be called while
+     * the audio thread is recording.
+     * @param newSampleRate The audio sample rate.
+     */
+    void prepare(double newSampleRate) noexcept;
+
+    /**
+     * Adds an event to the ring. Audio thread only; never blocks or allocates.
+     * @param stage The stage that ran.
+     * @param start The time the stage started, from now().
+     * @param end The time the stage ended, from now().
+     * @param voices The number of voices that were sounding.
+     * @param numSamples The number of samples the stage covered.
+     */
+    void record(Stage stage, juce::int64 start, juce::int64 end, int voices, int numSamples) noexcept;
+
+    /**
+     * Records a whole block and updates the load and the overrun count from it. Audio thread only.
+     * @param start The time processBlock started.
+     * @param end The time processBlock ended.
+     * @param voices The number of voices sounding at the end of the block.
+     * @param numSamples The length of the block.
+     */
+    void recordBlock(juce::int64 start, juce::int64 end, int voices, int numSamples) noexcept;
+
+    /** Returns the DSP load smoothed over a few hundred milliseconds, where 1 is the whole block duration. */
+    float getLoad() const noexcept { return load.load(std::memory_order_relaxed); }
+
+    /** Returns the highest recent block load, decaying over a couple of seconds. */
+    float getPeakLoad() const noexcept { return peakLoad.load(std::memory_order_relaxed); }
+
+    /** Returns the number of blocks that took longer than their duration since the plugin was created. */
+    int getNumOverruns() const noexcept { return numOverruns.load(std::memory_order_relaxed); }
+
+    /** Returns the number of voices sounding at the end of the last block. */
+    int getNumVoices() const noexcept { return numVoices.load(std::memory_order_relaxed); }
+
+    /**
+     * Copies the events in the ring, oldest first. Allocates, so it must not be called from the audio thread.
+     * @param destination Replaced with the events that were not overwritten while they were copied.
+     */
+    void getEvents(std::vector<Event>& destination) const;
+
+    /**
+     * Writes the events in the ring as a Chrome trace, which chrome://tracing and Perfetto open.
+     * Each stage is a complete event on the audio thread's track, nested inside its block, and
+     * overruns are instant events. Must not be called from the audio thread.
+     * @param file The JSON file to write, replaced if it exists.
+     * @return False if the file cannot be written.
+     */
+    bool writeChromeTrace(const juce::File& file) const;
+
+private:
+    /** One entry of the ring. Atomic, so that a reader racing the audio thread is well defined. */
+    struct Slot {
+        std::atomic<juce::int64> start{ 0 };
+        std::atomic<juce::int64> end{ 0 };
+        std::atomic<int> stage{ blockStage };
+        std::atomic<int> numVoices{ 0 };
+        std::atomic<int> numSamples{ 0 };
+    };
+
+    /** How long the load takes to follow a change, and how long the peak takes to fall away. */
+    static constexpr double loadSeconds = 0.3;
+    static constexpr double peakSeconds = 2.0;
+
+    std::array<Slot, capacity> slots;                 ///< The ring, indexed by event number modulo capacity.
+    std::atomic<juce::uint64> numStarted{ 0 };        ///< Events the audio thread has begun to write.
+    std::atomic<juce::uint64> numWritten{ 0 };        ///< Events that are completely written.
+
+    double sampleRate{ 44100.0 };
+    double ticksPerSecond{ (double) juce::Time::getHighResolutionTicksPerSecond() };
+
+    std::atomic<float> load{ 0.0f };
+    std::atomic<float> peakLoad{ 0.0f };
+    std::atomic<int> numOverruns{ 0 };
+    std::atomic<int> numVoices{ 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PerfMonitor)
+};
\ No newline at end of file
@@ -20,16 +20,33 @@
 SynthAudioProcessorEditor::SynthAudioProcessorEditor(SynthAudioProcessor& p)
     : AudioProcessorEditor(&p), audioProcessor(p),
     osc(audioProcessor.apvts, "OSC1WAVETYPE", "OSC1FMFREQ", "OSC1FMDEPTH"),
-    adsr(audioProcessor.apvts)
+    adsr(audioProcessor.apvts),
+    perfMeter(audioProcessor.getPerfMonitor()),
+    scope(audioProcessor.getScopeFeed())
 {
     // Set the size of the plugin window. This should match the expected UI dimensions.
-    setSize(600, 500);
+    setSize(600, 700);
 
     // Adds the ADSR envelope controls to the visible interface and makes them interactable.
     addAndMakeVisible(adsr);
 
     // Adds the oscillator controls to the visible interface and makes them interactable.
     addAndMakeVisible(osc);
+
+    // Adds the DSP load meter below the oscillator controls.
+    addAndMakeVisible(perfMeter);
+
+    // Adds the oscilloscope and spectrum across the bottom of the window.
+    addAndMakeVisible(scope);
+
+    // Listens for right-clicks on every control, for MIDI learn.
+    addMouseListener(this, true);
+
+    // The editor fills every pixel its children leave uncovered.
+    setOpaque(true);
+
+    // Starts the frame timer that every display follows.
+    startTimerHz(frameRateHz);
 }
 
 /**
@@ -37,6 +54,9 @@ SynthAudioProcessorEditor::SynthAudioProcessorEditor(SynthAudioProcessor& p)
  */
 SynthAudioProcessorEditor::~SynthAudioProcessorEditor()
 {
+    stopTimer();
+    removeMouseListener(this);
+
     // Cleanup can be handled here if needed, such as disconnecting listeners.
 }
 
@@ -50,7 +70,8 @@ SynthAudioProcessorEditor::~SynthAudioProcessorEditor()
  */
 void SynthAudioProcessorEditor::paint(juce::Graphics& g)
 {
-    // Sets the background to black. Since the component is opaque, we need to paint every pixel.
+    // Sets the background to navy. Since the component is opaque, we need to paint every pixel; the
+    // children are opaque too, so this only fills the gaps between them.
     g.fillAll(juce::Colours::navy);
 
 }
@@ -63,8 +84,66 @@ void SynthAudioProcessorEditor::paint(juce::Graphics& g)
 void SynthAudioProcessorEditor::resized()
 {
     // Layout for the oscillator component, positioned at the top-left of the window.
-    osc.setBounds(10, 10, 280, 480);
+    osc.setBounds(10, 10, 280, 450);
+
+    // Layout for the DSP load meter, in the space left below the oscillator component.
+    perfMeter.setBounds(10, 466, 280, 24);
+
+    // Layout for the ADSR component, taking up the right half of the window above the displays.
+    adsr.setBounds(getWidth() / 2, 0, getWidth() / 2, 500);
+
+    // Layout for the oscilloscope and spectrum, across the rest of the window.
+    scope.setBounds(10, 500, getWidth() - 20, getHeight() - 510);
+}
+
+/**
+ * Moves every part of the editor on by one frame. Each one repaints only what changed, and the
+ * repaints of one frame reach the screen together.
+ */
+void SynthAudioProcessorEditor::timerCallback()
+{
+    osc.refresh();
+    adsr.refresh();
+    perfMeter.refresh();
+    scope.refresh();
+}
+
+/**
+ * Shows the MIDI learn menu for the parameter of the right-clicked control.
+ * The control, or one of its parents, is found by its component ID, which names the parameter.
+ *
+ * @param event The mouse event, from the editor or any of its children.
+ */
+void SynthAudioProcessorEditor::mouseDown(const juce::MouseEvent& event)
+{
+    if (!event.mods.isPopupMenu())
+        return;
+
+    // Finds the control the click landed on.
+    juce::RangedAudioParameter* parameter = nullptr;
+
+    for (auto* component = event.originalComponent; component != nullptr && component != this; component = component->getParentComponent()) {
+        if ((parameter = audioProcessor.apvts.getParameter(component->getComponentID())) != nullptr)
+            break;
+    }
+
+    if (parameter == nullptr || !parameter->isAutomatable())
+        return;
+
+    auto& midiLearn = audioProcessor.getMidiLearn();
+    const int parameterIndex = parameter->getParameterIndex();
+    int midiChannel = 0, controllerNumber = 0;
+
+    juce::PopupMenu menu;
+
+    if (midiLearn.getLearningParameter() == parameterIndex)
+        menu.addItem("Cancel MIDI Learn", [&midiLearn] { midiLearn.stopLearning(); });
+    else
+        menu.addItem("MIDI Learn", [&midiLearn, parameterIndex] { midiLearn.startLearning(parameterIndex); });
+
+    if (midiLearn.findController(parameterIndex, midiChannel, controllerNumber))
+        menu.addItem("Forget CC " + juce::String(controllerNumber) + " on Channel " + juce::String(midiChannel),
+                     [&midiLearn, parameterIndex] { midiLearn.clearRoutesTo(parameterIndex); });
 
-    // Layout for the ADSR component, taking up the right half of the window.
-    adsr.setBounds(getWidth() / 2, 0, getWidth() / 2, getHeight());
+    menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(event.originalComponent));
 }
\ No newline at end of file
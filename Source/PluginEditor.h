@@ -12,14 +12,21 @@
 #include "PluginProcessor.h"
 #include "UI/AdsrComponent.h"
 #include "UI/OscComponent.h"
+#include "UI/PerfMeterComponent.h"
+#include "UI/ScopeComponent.h"
 
 //==============================================================================
 /**
     SynthAudioProcessorEditor is the graphical interface for the audio processor.
     It inherits from juce::AudioProcessorEditor, which provides the basic framework
     for creating the UI components of an audio processing plugin.
+
+    A single timer paces every display: once per frame it moves the sliders to
+    parameter changes from the host, and updates the meter and the scope, so all
+    of them repaint together and at most frameRateHz times a second. Learned MIDI
+    controllers bypass the parameters, so the sliders do not follow them.
 */
-class SynthAudioProcessorEditor : public juce::AudioProcessorEditor
+class SynthAudioProcessorEditor : public juce::AudioProcessorEditor, private juce::Timer
 {
 public:
     /**
@@ -53,11 +60,30 @@ public:
      */
     void resized() override;
 
+    /**
+     * Opens the MIDI learn menu when a control is right-clicked.
+     *
+     * Every control that is named after a parameter offers to learn the next MIDI controller
+     * that moves, or to forget the controller it has learned.
+     *
+     * @param event The mouse event, from the editor or any of its children.
+     */
+    void mouseDown(const juce::MouseEvent& event) override;
+
 private:
+    /**
+     * Updates the sliders, the meter and the scope for the next frame.
+     */
+    void timerCallback() override;
+
+    static constexpr int frameRateHz = 30;  // The most often any part of the editor repaints on its own.
+
     // Member variables
     SynthAudioProcessor& audioProcessor;  // Reference to the audio processor associated with this editor.
     OscComponent osc;                     // Oscillator component part of the UI, handles oscillator settings.
     AdsrComponent adsr;                   // ADSR envelope component part of the UI, handles envelope settings.
+    PerfMeterComponent perfMeter;         // DSP load meter, shows how busy the audio thread is.
+    ScopeComponent scope;                 // Oscilloscope and spectrum of the output.
 
     // Macro to help with memory leaks detection during debugging.
     // It should be present in all classes that allocate memory dynamically.
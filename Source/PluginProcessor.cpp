@@ -7,6 +7,7 @@
 // Include the headers for the processor and editor
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "RealtimeTrap.h"
 
 //==============================================================================
 // Constructor for the audio processor class
@@ -23,14 +24,34 @@ SynthAudioProcessor::SynthAudioProcessor()
     ), apvts(*this, nullptr, "Parameters", createParameters())
 #endif
 {
-    // Add a new sound and voice to the synthesizer
+    // Add the sound to the synthesizer. The voice pool is allocated in prepareToPlay.
     synth.addSound(new SynthSound());
-    synth.addVoice(new SynthVoice());
+
+    // Notes are tuned in equal temperament until a Scala tuning is loaded
+    synth.setTuning(tuningLoader.getEqualTemperament());
+
+    // Oversampling adds latency, which the host has to be told about
+    apvts.addParameterListener("OVERSAMPLING", this);
+
+    // Learned MIDI controllers move parameters straight from the synth's MIDI handling
+    synth.setControllerListener(this);
+
+    // The synth times its voices and its mix into the same monitor as the blocks
+    synth.setPerfMonitor(&perfMonitor);
 }
 
 // Destructor for the audio processor class
 SynthAudioProcessor::~SynthAudioProcessor()
 {
+    apvts.removeParameterListener("OVERSAMPLING", this);
+    cancelPendingUpdate();
+
+    // Hand back a patch that was taken mid-switch, so the loader frees it
+    if (incomingPatch != nullptr)
+        patchLoader.retire(incomingPatch);
+
+    // Likewise the tuning in use
+    tuningLoader.retire(&synth.getTuning());
 }
 
 //==============================================================================
@@ -80,44 +101,63 @@ double SynthAudioProcessor::getTailLengthSeconds() const
 int SynthAudioProcessor::getNumPrograms()
 {
     // Some hosts do not handle 0 programs well, so return at least 1
-    return 1;
+    return juce::jmax(1, patchLoader.getPresetBank().getNumPrograms());
 }
 
 // Returns the current program number
 int SynthAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    return currentProgram.load();
 }
 
 // Sets the current program to the given index
 void SynthAudioProcessor::setCurrentProgram(int index)
 {
+    // The preset is parsed on the loader's thread and switched to with a fade
+    if (juce::isPositiveAndBelow(index, patchLoader.getPresetBank().getNumPrograms())) {
+        currentProgram = index;
+        patchLoader.requestProgram(index);
+    }
 }
 
 // Returns the name of the program at the given index
 const juce::String SynthAudioProcessor::getProgramName(int index)
 {
-    return {};
+    return patchLoader.getPresetBank().getProgramName(index);
 }
 
 // Changes the name of the program at the given index to newName
 void SynthAudioProcessor::changeProgramName(int index, const juce::String& newName)
 {
+    // The preset bank is shared read-only by every instance, so programs cannot be renamed from here
+    juce::ignoreUnused(index, newName);
 }
 
 //==============================================================================
 // Prepare the plugin for playing
 void SynthAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
 {
-    // Sets the current playback sample rate for the synthesizer
-    synth.setCurrentPlaybackSampleRate(sampleRate);
+    // Allocate the whole voice pool once, so that changing the polyphony never allocates on the audio thread
+    synth.allocateVoices();
 
-    // Prepare each voice for playing with the current configuration
-    for (int i = 0; i < synth.getNumVoices(); i++) {
-        if (auto voice = dynamic_cast<SynthVoice*>(synth.getVoice(i))) {
-            voice->prepareToPlay(sampleRate, samplesPerBlock, getTotalNumOutputChannels());
-        }
-    }
+    // Set the playback sample rate and prepare each voice for playing with the current configuration
+    synth.prepareToPlay(sampleRate, samplesPerBlock, getTotalNumOutputChannels());
+
+    // Measure the DSP load against the duration of a block at this sample rate
+    perfMonitor.prepare(sampleRate);
+
+    // Choose how far the output is decimated for the editor's displays
+    scopeFeed.prepare(sampleRate);
+
+    // Report the oversampling latency for the current mode before playback starts
+    updateLatency();
+
+    // Make sure every setting is pushed to the freshly prepared voices on the first block
+    parameters.invalidate();
+
+    // Set the length of the fades used when switching patches
+    switchGain.reset(sampleRate, patchFadeSeconds);
+    switchGain.setCurrentAndTargetValue(patchSwitch == PatchSwitch::fadingOut ? 0.0f : 1.0f);
 }
 
 // Releases any resources that are no longer needed
@@ -153,7 +193,14 @@ bool SynthAudioProcessor::isBusesLayoutSupported(const BusesLayout& layouts) con
 // The process block where audio processing happens
 void SynthAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    // Every block is timed as a whole, so the load includes everything below
+    const juce::int64 blockStart = PerfMonitor::now();
+
     juce::ScopedNoDenormals noDenormals;
+
+    // In builds with SYNTH_REALTIME_TRAP=1, abort if this block allocates or waits on a lock
+    RealtimeTrap::ScopedAudioThread realtimeTrap;
+
     auto totalNumInputChannels = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
@@ -161,29 +208,204 @@ void SynthAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::M
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear(i, 0, buffer.getNumSamples());
 
-    // Handle each voice's processing
-    for (int i = 0; i < synth.getNumVoices(); ++i) {
-        if (auto voice = dynamic_cast<SynthVoice*>(synth.getVoice(i))) {
+    // MIDI program changes select a program of the preset bank. In real time it is parsed on the
+    // loader's thread and usually ready a block or two later; offline it is parsed here, so the
+    // switch starts in this block and a render does not depend on thread timing
+    for (const auto metadata : midiMessages) {
+        const auto message = metadata.getMessage();
+
+        if (message.isProgramChange()
+            && juce::isPositiveAndBelow(message.getProgramChangeNumber(), patchLoader.getPresetBank().getNumPrograms())) {
+            currentProgram = message.getProgramChangeNumber();
+
+            if (isNonRealtime()) {
+                // Parsing and publishing allocate and lock, which is allowed offline but would trip the trap
+                RealtimeTrap::ScopedDisarm offlineLoad;
+                patchLoader.loadProgramNow(message.getProgramChangeNumber());
+            }
+            else
+                patchLoader.requestProgram(message.getProgramChangeNumber());
+        }
+    }
 
-            // Update oscillator and ADSR settings from parameters
-            auto& attack = *apvts.getRawParameterValue("ATTACK");
-            auto& decay = *apvts.getRawParameterValue("DECAY");
-            auto& sustain = *apvts.getRawParameterValue("SUSTAIN");
-            auto& release = *apvts.getRawParameterValue("RELEASE");
+    const juce::int64 parametersStart = PerfMonitor::now();
 
-            auto& oscWaveChoice = *apvts.getRawParameterValue("OSC1WAVETYPE");
-            auto& fmDepth = *apvts.getRawParameterValue("OSC1FMDEPTH");
-            auto& fmFreq = *apvts.getRawParameterValue("OSC1FMFREQ");
+    // Switch to a newly loaded tuning; notes that are already sounding keep their pitch
+    if (auto* table = tuningLoader.poll()) {
+        tuningLoader.retire(&synth.getTuning());
+        synth.setTuning(*table);
+    }
 
-            voice->getOscillator().setWaveType(oscWaveChoice);
-            voice->getOscillator().setFmParams(fmDepth, fmFreq);
+    // Start switching to a newly loaded patch, unless a switch is still in progress
+    if (auto* patch = patchLoader.poll(patchSwitch == PatchSwitch::idle)) {
+        incomingPatch = patch;
+        patchSwitch = PatchSwitch::fadingOut;
+        switchGain.setTargetValue(0.0f);
+    }
 
-            voice->updateADSR(attack.load(), decay.load(), sustain.load(), release.load());
-        }
+    // Read every parameter once and find out which ones moved since the previous block.
+    // While the old patch fades out its settings are held, so the change is never heard unfaded.
+    // A patch still waiting to be taken may already have set the parameters, so they are not read either.
+    if (patchSwitch == PatchSwitch::fadingOut || patchLoader.hasPending())
+        parameters.skipUpdate();
+    else
+        parameters.update();
+
+    // Push the parameters that moved to the synth
+    applyParameters();
+
+    perfMonitor.record(PerfMonitor::parameterStage, parametersStart, PerfMonitor::now(), synth.getNumActiveVoices(), buffer.getNumSamples());
+
+    // Render the current block of audio. With nothing sounding, no MIDI to start a note and no
+    // controller glide to finish, the synth is skipped, and clearing the whole buffer flags it as
+    // silent to the host
+    if (!midiMessages.isEmpty() || !synth.isSilent() || parameters.isRamping())
+        synth.renderBlock(buffer, midiMessages, 0, buffer.getNumSamples());
+    else if (totalNumInputChannels == 0)
+        buffer.clear();
+
+    if (patchSwitch != PatchSwitch::idle)
+        applyPatchSwitch(buffer);
+
+    // Copy the output for the editor's scope and spectrum; returns straight away while the editor is closed
+    scopeFeed.push(buffer, buffer.getNumSamples());
+
+    // Update the DSP load and count the block as an overrun if it took longer than its duration
+    perfMonitor.recordBlock(blockStart, PerfMonitor::now(), synth.getNumActiveVoices(), buffer.getNumSamples());
+}
+
+// Pushes every parameter group whose change flag is set to the synth
+void SynthAudioProcessor::applyParameters()
+{
+    // Update the voice pool settings from parameters
+    if (parameters.voicePoolChanged()) {
+        synth.setPolyphony((int) parameters.polyphony.get());
+        synth.setStealMode((SynthEngine::StealMode) (int) parameters.voiceSteal.get());
+    }
+
+    // Route the modulation sources to their targets, and set up both LFOs
+    if (parameters.modMatrixChanged())
+        for (int slot = 0; slot < ModMatrix::numSlots; ++slot)
+            synth.setModulation(slot, (int) parameters.modSource[(size_t) slot].get(), (int) parameters.modTarget[(size_t) slot].get(),
+                                parameters.modAmount[(size_t) slot].get());
+
+    if (parameters.lfoChanged())
+        for (int lfo = 0; lfo < ModMatrix::numLfos; ++lfo)
+            synth.setLfo(lfo, (int) parameters.lfoShape[(size_t) lfo].get(), parameters.lfoRate[(size_t) lfo].get());
+
+    // Choose between per-voice rendering and the vectorised voice bank. The bank has one
+    // oscillator per lane and no modulation matrix, so unison and modulated notes always render per voice
+    if (parameters.voiceBankChanged() || parameters.unisonChanged() || parameters.modMatrixChanged())
+        synth.setVoiceBankEnabled(parameters.voiceBank.get() >= 0.5f && (int) parameters.unison.get() == 1
+                                  && !synth.getModMatrix().isActive());
+
+    // Allow large voice counts to be rendered on the worker threads
+    if (parameters.multiCoreChanged())
+        synth.setMultiThreaded(parameters.multiCore.get() >= 0.5f);
+
+    // Spread the voices across the stereo field
+    if (parameters.spreadChanged())
+        synth.setStereoSpread(parameters.spread.get());
+
+    // Let notes with heavy FM render oversampled; the latency was reported when the mode changed
+    if (parameters.oversamplingChanged())
+        synth.setOversamplingEnabled(parameters.oversampling.get() >= 0.5f);
+
+    // Push oscillator and ADSR settings only when they have changed. The engine passes them to
+    // the voice bank and the sounding voices; free voices pick them up at their next note
+    if (parameters.waveTypeChanged())
+        synth.setWaveType((int) parameters.waveType.get());
+
+    if (parameters.fmChanged())
+        synth.setFmParams(parameters.fmDepth.get(), parameters.fmFreq.get());
+
+    if (parameters.unisonChanged())
+        synth.setUnison((int) parameters.unison.get(), parameters.detune.get(), parameters.unisonSpread.get());
+
+    if (parameters.adsrChanged())
+        synth.setEnvelope(parameters.attack.get(), parameters.decay.get(), parameters.sustain.get(), parameters.release.get(),
+                          (AdsrData::Curve) (int) parameters.envCurve.get());
+
+    // Free voices whose release has faded below the threshold
+    if (parameters.silenceThresholdChanged())
+        synth.setSilenceThreshold(parameters.silenceThreshold.get());
+}
+
+// Fades the output and applies the incoming patch at the quietest point
+void SynthAudioProcessor::applyPatchSwitch(juce::AudioBuffer<float>& buffer)
+{
+    switchGain.applyGain(buffer, buffer.getNumSamples());
+
+    if (switchGain.isSmoothing())
+        return;
+
+    if (patchSwitch == PatchSwitch::fadingOut) {
+        // Silent now: the next block reads the new patch's settings, then fades back in
+        parameters.applyPatch(*incomingPatch);
+        patchLoader.retire(incomingPatch);
+        incomingPatch = nullptr;
+
+        patchSwitch = PatchSwitch::fadingIn;
+        switchGain.setTargetValue(1.0f);
+    }
+    else {
+        patchSwitch = PatchSwitch::idle;
     }
+}
+
+// Moves the parameter a learned controller is routed to, on the audio thread and at the sub-block
+// the controller change lands in. The host-visible parameter is left alone, as with patch switches
+bool SynthAudioProcessor::controllerMoved(int midiChannel, int controllerNumber, int controllerValue)
+{
+    const int parameterIndex = midiLearn.handleController(midiChannel, controllerNumber);
+    auto* parameter = parameterIndex >= 0 ? parameters.findParameter(parameterIndex) : nullptr;
 
-    // Render the current block of audio
-    synth.renderNextBlock(buffer, midiMessages, 0, buffer.getNumSamples());
+    if (parameter == nullptr)
+        return false;
+
+    const int rampSamples = juce::roundToInt(parameters.controllerSmoothing.get() * 0.001 * getSampleRate());
+
+    parameters.skipUpdate();
+    parameter->setFromController((float) controllerValue / 127.0f, rampSamples);
+    applyParameters();
+    return true;
+}
+
+bool SynthAudioProcessor::isGliding()
+{
+    return parameters.isRamping();
+}
+
+void SynthAudioProcessor::advanceGlides(int numSamples)
+{
+    parameters.advanceRamps(numSamples);
+    applyParameters();
+}
+
+// Keeps the reported latency in step with the oversampling mode. Automation and patch loads can
+// change the mode on other threads, and the host is only told about latency on the message thread
+void SynthAudioProcessor::parameterChanged(const juce::String& parameterID, float newValue)
+{
+    juce::ignoreUnused(newValue);
+
+    if (parameterID != "OVERSAMPLING")
+        return;
+
+    if (juce::MessageManager::existsAndIsCurrentThread())
+        updateLatency();
+    else
+        triggerAsyncUpdate();
+}
+
+void SynthAudioProcessor::handleAsyncUpdate()
+{
+    updateLatency();
+}
+
+void SynthAudioProcessor::updateLatency()
+{
+    const bool oversampled = apvts.getRawParameterValue("OVERSAMPLING")->load() >= 0.5f;
+    setLatencySamples(oversampled ? OversampledMix::getLatency() : 0);
 }
 
 //==============================================================================
@@ -203,13 +425,72 @@ juce::AudioProcessorEditor* SynthAudioProcessor::createEditor()
 // Saves the current state of the plugin parameters
 void SynthAudioProcessor::getStateInformation(juce::MemoryBlock& destData)
 {
-    // Implementation would be here to save plugin state
+    // Write every parameter in the versioned binary patch format, with the learned MIDI controllers
+    auto patch = PatchState::capture(*this);
+    std::vector<PatchState::ControllerRoute> routes;
+
+    for (int channel = 1; channel <= MidiLearn::numChannels; ++channel) {
+        for (int controller = 0; controller < MidiLearn::numControllers; ++controller) {
+            const int parameterIndex = midiLearn.getRoute(channel, controller);
+
+            if (parameterIndex >= 0)
+                routes.push_back({ channel, controller, parameterIndex });
+        }
+    }
+
+    patch->setControllerRoutes(std::move(routes));
+    patch->write(*this, destData);
 }
 
 // Restores the plugin state from the given memory block
 void SynthAudioProcessor::setStateInformation(const void* data, int sizeInBytes)
 {
-    // Implementation would be here to load plugin state
+    // Parse here, since the host expects the parameters to be set on return; the audio thread
+    // still switches over with a fade if it is running
+    auto patch = sizeInBytes > 0 ? PatchState::read(*this, data, (size_t) sizeInBytes) : nullptr;
+
+    if (patch == nullptr)
+        return;
+
+    // Restore the learned MIDI controllers; states saved before they were stored keep the current ones
+    if (patch->hasControllerRoutes()) {
+        midiLearn.clearAll();
+
+        for (const auto& route : patch->getControllerRoutes())
+            midiLearn.setRoute(route.midiChannel, route.controllerNumber, route.parameterIndex);
+    }
+
+    patchLoader.loadNow(std::move(patch));
+}
+
+// Queues a patch to be parsed on the loader's thread and switched to during playback
+void SynthAudioProcessor::switchToPatch(const void* data, size_t sizeInBytes)
+{
+    patchLoader.loadAsync(data, sizeInBytes);
+}
+
+// Queues a Scala tuning to be read on the loader's thread
+void SynthAudioProcessor::loadTuning(const juce::File& scaleFile, const juce::File& keyboardMappingFile)
+{
+    tuningLoader.loadAsync(scaleFile, keyboardMappingFile);
+}
+
+// Reads a Scala tuning straight away, for callers that need it before the next block
+bool SynthAudioProcessor::loadTuningNow(const juce::File& scaleFile, const juce::File& keyboardMappingFile, juce::String& error)
+{
+    return tuningLoader.loadNow(scaleFile, keyboardMappingFile, error);
+}
+
+// Goes back to equal temperament
+void SynthAudioProcessor::resetTuning()
+{
+    tuningLoader.reset();
+}
+
+// Reports the error of the last background tuning load
+juce::String SynthAudioProcessor::getTuningError() const
+{
+    return tuningLoader.getLastError();
 }
 
 //==============================================================================
@@ -237,5 +518,58 @@ juce::AudioProcessorValueTreeState::ParameterLayout SynthAudioProcessor::createP
     params.push_back(std::make_unique<juce::AudioParameterFloat>("SUSTAIN", "Sustain", juce::NormalisableRange<float> { 0.1f, 1.0f, }, 1.0f));
     params.push_back(std::make_unique<juce::AudioParameterFloat>("RELEASE", "Release", juce::NormalisableRange<float> { 0.1f, 3.0f, }, 0.4f));
 
+    // Define parameters for the size of the voice pool and how voices are stolen once it is full
+    params.push_back(std::make_unique<juce::AudioParameterInt>("POLYPHONY", "Polyphony",
+        SynthEngine::minPolyphony, SynthEngine::maxPolyphony, 16));
+    params.push_back(std::make_unique<juce::AudioParameterChoice>("VOICESTEAL", "Voice Stealing", juce::StringArray{ "Releasing First", "Oldest" }, 0));
+
+    // Define a parameter that renders all voices together in the SIMD voice bank
+    params.push_back(std::make_unique<juce::AudioParameterBool>("VOICEBANK", "Voice Bank Renderer", false));
+
+    // Define a parameter for how widely the voices are spread across the stereo field
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("SPREAD", "Stereo Spread", juce::NormalisableRange<float> { 0.0f, 1.0f, }, 0.0f));
+
+    // Define a parameter that lets large numbers of voices render on several cores
+    params.push_back(std::make_unique<juce::AudioParameterBool>("MULTICORE", "Multi-Core Rendering", false));
+
+    // Define a parameter for the shape of the envelope segments
+    params.push_back(std::make_unique<juce::AudioParameterChoice>("ENVCURVE", "Envelope Curve", juce::StringArray{ "Linear", "Exponential" }, 0));
+
+    // Define a parameter that lets notes with heavy FM render at up to 8x the sample rate.
+    // It changes the latency, which hosts do not expect during playback, so it cannot be automated
+    params.push_back(std::make_unique<juce::AudioParameterChoice>("OVERSAMPLING", "Oversampling", juce::StringArray{ "Off", "Auto" }, 0,
+        juce::AudioParameterChoiceAttributes().withAutomatable(false)));
+
+    // Define parameters for the number of detuned unison oscillators per voice, how far apart they are and how wide they are panned
+    params.push_back(std::make_unique<juce::AudioParameterInt>("UNISON", "Unison Voices", 1, OscData::maxUnison, 1));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("DETUNE", "Unison Detune", juce::NormalisableRange<float> { 0.0f, 100.0f, 0.1f }, 20.0f));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("UNISONSPREAD", "Unison Spread", juce::NormalisableRange<float> { 0.0f, 1.0f, }, 0.5f));
+
+    // Define a parameter for the envelope level at which a released note is treated as silent and its voice is freed
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("SILENCE", "Silence Threshold", juce::NormalisableRange<float> { -120.0f, -48.0f, 1.0f }, -96.0f));
+
+    // Define a parameter for how long a parameter moved by a learned MIDI controller takes to glide to its new value
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("CCSMOOTHING", "MIDI CC Smoothing", juce::NormalisableRange<float> { 0.0f, 200.0f, 1.0f }, 10.0f));
+
+    // Define parameters for the two LFOs of the modulation matrix: one restarted by every note, one shared by all of them
+    const juce::StringArray lfoNames{ "Voice LFO", "Global LFO" };
+
+    for (int lfo = 0; lfo < ModMatrix::numLfos; ++lfo) {
+        const auto id = "LFO" + juce::String(lfo + 1);
+        params.push_back(std::make_unique<juce::AudioParameterChoice>(id + "SHAPE", lfoNames[lfo] + " Shape", juce::StringArray{ "Sine", "Triangle", "Saw", "Square" }, 0));
+        params.push_back(std::make_unique<juce::AudioParameterFloat>(id + "RATE", lfoNames[lfo] + " Rate", juce::NormalisableRange<float> { 0.05f, 20.0f, 0.01f, 0.3f }, 2.0f));
+    }
+
+    // Define the slots of the modulation matrix, each routing one source to one target by a signed amount
+    for (int slot = 0; slot < ModMatrix::numSlots; ++slot) {
+        const auto id = "MOD" + juce::String(slot + 1);
+        const auto name = "Mod " + juce::String(slot + 1);
+        params.push_back(std::make_unique<juce::AudioParameterChoice>(id + "SOURCE", name + " Source",
+            juce::StringArray{ "None", "Voice LFO", "Global LFO", "Envelope", "Velocity", "Pitch Wheel", "Mod Wheel" }, 0));
+        params.push_back(std::make_unique<juce::AudioParameterChoice>(id + "TARGET", name + " Target",
+            juce::StringArray{ "None", "Pitch", "FM Depth", "FM Frequency", "Amplitude", "Pan" }, 0));
+        params.push_back(std::make_unique<juce::AudioParameterFloat>(id + "AMOUNT", name + " Amount", juce::NormalisableRange<float> { -1.0f, 1.0f, 0.01f }, 0.0f));
+    }
+
     return { params.begin(), params.end() };
 }
\ No newline at end of file
@@ -10,13 +10,23 @@
 
 #include "SynthVoice.h" // Include the definition of our SynthVoice, which will handle the actual sound generation.
 #include "SynthSound.h" // Include the definition of our SynthSound, which will be used to determine if a given MIDI note should trigger a voice.
+#include "SynthEngine.h" // Include the definition of our SynthEngine, which owns the voice pool and handles voice stealing.
+#include "Data/ParameterCache.h" // Include the definition of our ParameterCache, which tracks parameter changes for the audio thread.
+#include "PatchLoader.h" // Include the definition of our PatchLoader, which hands new patches to the audio thread.
+#include "TuningLoader.h" // Include the definition of our TuningLoader, which hands new tunings to the audio thread.
+#include "MidiLearn.h" // Include the definition of our MidiLearn, which routes MIDI controllers to parameters.
+#include "PerfMonitor.h" // Include the definition of our PerfMonitor, which times the audio thread.
+#include "ScopeFeed.h" // Include the definition of our ScopeFeed, which copies the output to the editor's displays.
 
 //==============================================================================
 /**
  * The SynthAudioProcessor class defines the core functionality of our plugin.
  * It inherits from juce::AudioProcessor, which provides the basic framework for a JUCE plugin.
  */
-class SynthAudioProcessor : public juce::AudioProcessor
+class SynthAudioProcessor : public juce::AudioProcessor,
+                            private juce::AudioProcessorValueTreeState::Listener,
+                            private juce::AsyncUpdater,
+                            private SynthEngine::ControllerListener
 {
 public:
     //==============================================================================
@@ -75,13 +85,92 @@ public:
     void getStateInformation(juce::MemoryBlock& destData) override;
     // Restores the state of the plugin parameters from a given memory block.
     void setStateInformation(const void* data, int sizeInBytes) override;
+    // Switches to a patch in the state format during playback. It is parsed on a background thread
+    // and the audio fades out and back in around the change. Must not be called from the audio thread.
+    void switchToPatch(const void* data, size_t sizeInBytes);
+
+    //==============================================================================
+    // Tuning functions
+    // Switches to a Scala tuning, read on a background thread. A default File for the keyboard mapping
+    // uses the default one. Failures are reported by getTuningError(). Must not be called from the audio thread.
+    void loadTuning(const juce::File& scaleFile, const juce::File& keyboardMappingFile = {});
+    // Reads a Scala tuning on the calling thread, so it applies from the next block. Must not be called from the audio thread.
+    bool loadTuningNow(const juce::File& scaleFile, const juce::File& keyboardMappingFile, juce::String& error);
+    // Switches back to twelve-tone equal temperament.
+    void resetTuning();
+    // Returns why the last tuning loaded by loadTuning() failed, or an empty string.
+    juce::String getTuningError() const;
 
     // The AudioProcessorValueTreeState object, which manages the plugin's parameters and state.
     juce::AudioProcessorValueTreeState apvts;
 
+    // Returns the number of voices that were held or releasing at the end of the last block.
+    int getNumActiveVoices() const { return synth.getNumActiveVoices(); }
+
+    // The MIDI controller routes. The editor arms learning and clears routes through it; the audio
+    // thread reads it without locking.
+    MidiLearn& getMidiLearn() { return midiLearn; }
+
+    // The DSP load, overrun count and stage timings of the audio thread, polled by the editor's meter.
+    const PerfMonitor& getPerfMonitor() const { return perfMonitor; }
+
+    // The copy of the output that the editor's scope and spectrum read. Only fed while a display enables it.
+    ScopeFeed& getScopeFeed() { return scopeFeed; }
+
 private:
     // The synthesiser instance that will manage voices and sounds.
-    juce::Synthesiser synth;
+    SynthEngine synth;
+
+    // The parameters read by the audio thread, resolved once and refreshed at the start of every block.
+    ParameterCache parameters{ apvts };
+
+    // Parses patches away from the audio thread and publishes them to it.
+    PatchLoader patchLoader{ *this };
+
+    // Builds tuning tables away from the audio thread and publishes them to it.
+    TuningLoader tuningLoader;
+
+    // Which parameter each MIDI controller moves.
+    MidiLearn midiLearn;
+
+    // Times every block and its stages. The synth records the voices and the mix through a pointer to it.
+    PerfMonitor perfMonitor;
+
+    // Carries the output to the editor's scope and spectrum.
+    ScopeFeed scopeFeed;
+
+    // The program last selected by the host or a MIDI program change.
+    std::atomic<int> currentProgram{ 0 };
+
+    // The stages of a switch to a new patch, which fades out, applies the patch and fades back in.
+    enum class PatchSwitch { idle, fadingOut, fadingIn };
+
+    // Length of each fade when switching patches, short enough to feel instant.
+    static constexpr double patchFadeSeconds = 0.01;
+
+    PatchSwitch patchSwitch{ PatchSwitch::idle };
+    PatchState* incomingPatch{ nullptr }; // Taken from the loader; applied once the fade out ends.
+    juce::SmoothedValue<float> switchGain{ 1.0f };
+
+    // Pushes the parameter groups that changed to the synth.
+    void applyParameters();
+
+    // Moves the parameter a learned controller is routed to. Returns false for controllers without a route.
+    bool controllerMoved(int midiChannel, int controllerNumber, int controllerValue) override;
+    // Reports whether a parameter is still gliding to a controller's value.
+    bool isGliding() override;
+    // Moves the controller glides on by one sub-block.
+    void advanceGlides(int numSamples) override;
+
+    // Advances a patch switch after the block has been rendered.
+    void applyPatchSwitch(juce::AudioBuffer<float>& buffer);
+
+    // Reports the latency of the oversampling mode to the host whenever the mode changes.
+    void parameterChanged(const juce::String& parameterID, float newValue) override;
+    // Reports the latency for a mode change that arrived on another thread, from the message thread.
+    void handleAsyncUpdate() override;
+    // Sets the reported latency from the current oversampling mode.
+    void updateLatency();
 
     // Function to create and return the parameter layout for the plugin's parameters.
     juce::AudioProcessorValueTreeState::ParameterLayout createParameters();
@@ -0,0 +1,95 @@
+/*
+  ==============================================================================
+
+    RealtimeSemaphore.cpp
+    A counting semaphore that the audio thread can post to without taking a
+    lock.
+
+  ==============================================================================
+*/
+
+#include "RealtimeSemaphore.h"
+
+#if JUCE_WINDOWS
+ #ifndef NOMINMAX
+  #define NOMINMAX
+ #endif
+ #include <windows.h>
+#elif JUCE_MAC || JUCE_IOS
+ #include <dispatch/dispatch.h>
+#else
+ #include <cerrno>
+ #include <ctime>
+ #include <semaphore.h>
+#endif
+
+//==============================================================================
+#if JUCE_WINDOWS
+struct RealtimeSemaphore::Native {
+    HANDLE handle{ CreateSemaphoreW(nullptr, 0, 0x7fffffff, nullptr) };
+    ~Native() { CloseHandle(handle); }
+    void post() noexcept { ReleaseSemaphore(handle, 1, nullptr); }
+    bool wait(DWORD timeoutMs) noexcept { return WaitForSingleObject(handle, timeoutMs) == WAIT_OBJECT_0; }
+};
+#elif JUCE_MAC || JUCE_IOS
+struct RealtimeSemaphore::Native {
+    dispatch_semaphore_t semaphore{ dispatch_semaphore_create(0) };
+    ~Native() { dispatch_release(semaphore); }
+    void post() noexcept { dispatch_semaphore_signal(semaphore); }
+    bool wait(dispatch_time_t until) noexcept { return dispatch_semaphore_wait(semaphore, until) == 0; }
+};
+#else
+// sem_post is a futex operation, and only enters the kernel when a thread is waiting.
+struct RealtimeSemaphore::Native {
+    sem_t semaphore;
+    Native() { sem_init(&semaphore, 0, 0); }
+    ~Native() { sem_destroy(&semaphore); }
+    void post() noexcept { sem_post(&semaphore); }
+};
+#endif
+
+RealtimeSemaphore::RealtimeSemaphore() : native(std::make_unique<Native>()) {
+}
+
+RealtimeSemaphore::~RealtimeSemaphore() = default;
+
+void RealtimeSemaphore::post() noexcept {
+    native->post();
+}
+
+void RealtimeSemaphore::wait() noexcept {
+#if JUCE_WINDOWS
+    native->wait(INFINITE);
+#elif JUCE_MAC || JUCE_IOS
+    native->wait(DISPATCH_TIME_FOREVER);
+#else
+    while (sem_wait(&native->semaphore) != 0 && errno == EINTR) {}
+#endif
+}
+
+bool RealtimeSemaphore::wait(int timeoutMs) noexcept {
+#if JUCE_WINDOWS
+    return native->wait((DWORD) juce::jmax(0, timeoutMs));
+#elif JUCE_MAC || JUCE_IOS
+    return native->wait(dispatch_time(DISPATCH_TIME_NOW, (int64_t) juce::jmax(0, timeoutMs) * NSEC_PER_MSEC));
+#else
+    // sem_timedwait takes an absolute time on the realtime clock.
+    timespec until;
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_sec += timeoutMs / 1000;
+    until.tv_nsec += (long) (timeoutMs % 1000) * 1000000L;
+
+    if (until.tv_nsec >= 1000000000L) {
+        until.tv_sec += 1;
+        until.tv_nsec -= 1000000000L;
+    }
+
+    for (;;) {
+        if (sem_timedwait(&native->semaphore, &until) == 0)
+            return true;
+
+        if (errno != EINTR)
+            return false;
+    }
+#endif
+}
\ No newline at end of file
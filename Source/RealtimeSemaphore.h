@@ -0,0 +1,45 @@
+/*
+  ==============================================================================
+
+    RealtimeSemaphore.h
+    A counting semaphore that the audio thread can post to without taking a
+    lock.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ * RealtimeSemaphore wraps the platform's own counting semaphore. juce::WaitableEvent::signal locks
+ * a mutex, which the audio thread must never do; post() here is a single atomic operation, or a
+ * system call that takes no user-space lock when a thread is waiting, so the audio thread can use
+ * it to wake a worker. Only wait() ever blocks.
+ */
+class RealtimeSemaphore {
+
+public:
+    RealtimeSemaphore();
+    ~RealtimeSemaphore();
+
+    /** Releases one wait(). Real-time safe. */
+    void post() noexcept;
+
+    /** Blocks until post() has been called more times than wait() has returned. */
+    void wait() noexcept;
+
+    /**
+     * Blocks until a post() or until a timeout.
+     * @param timeoutMs The longest time to wait, in milliseconds.
+     * @return True if a post() released the wait, false if it timed out.
+     */
+    bool wait(int timeoutMs) noexcept;
+
+private:
+    struct Native;
+    std::unique_ptr<Native> native;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RealtimeSemaphore)
+};
\ No newline at end of file
@@ -0,0 +1,178 @@
+/*
+  ==============================================================================
+
+    RealtimeTrap.cpp
+    Replaces the allocation and mutex entry points with versions that check
+    whether the calling thread is processing audio.
+
+  ==============================================================================
+*/
+
+#include "RealtimeTrap.h"
+
+#if SYNTH_REALTIME_TRAP
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if defined(__linux__) && defined(__GLIBC__)
+#define SYNTH_REALTIME_TRAP_GLIBC 1
+#include <dlfcn.h>
+#include <pthread.h>
+#else
+#define SYNTH_REALTIME_TRAP_GLIBC 0
+#endif
+
+namespace {
+
+// Initial-exec TLS never allocates on first access, which matters because malloc reads it.
+#if defined(__GNUC__)
+__attribute__((tls_model("initial-exec")))
+#endif
+thread_local bool armed = false;
+
+}
+
+namespace RealtimeTrap {
+
+ScopedAudioThread::ScopedAudioThread() noexcept : wasArmed(armed) {
+    armed = true;
+}
+
+ScopedAudioThread::~ScopedAudioThread() noexcept {
+    armed = wasArmed;
+}
+
+ScopedDisarm::ScopedDisarm() noexcept : wasArmed(armed) {
+    armed = false;
+}
+
+ScopedDisarm::~ScopedDisarm() noexcept {
+    armed = wasArmed;
+}
+
+void check(const char* what) noexcept {
+    if (!armed)
+        return;
+
+    // Disarm first so that reporting cannot trip the trap again.
+    armed = false;
+    std::fputs("RealtimeTrap: ", stderr);
+    std::fputs(what, stderr);
+    std::fputs(" on the audio thread during processBlock\n", stderr);
+    std::abort();
+}
+
+}
+
+//==============================================================================
+// C++ allocation, on every platform. The nothrow and array forms forward to these.
+void* operator new(std::size_t size) {
+    RealtimeTrap::check("operator new");
+
+    if (void* p = std::malloc(size != 0 ? size : 1))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    RealtimeTrap::check("operator new");
+    return std::malloc(size != 0 ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept {
+    return operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept {
+    if (p != nullptr)
+        RealtimeTrap::check("operator delete");
+
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    operator delete(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    operator delete(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    operator delete(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    operator delete(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    operator delete(p);
+}
+
+//==============================================================================
+#if SYNTH_REALTIME_TRAP_GLIBC
+// glibc exports its allocator under these names, so the replacements can forward without dlsym.
+extern "C" {
+void* __libc_malloc(size_t);
+void* __libc_calloc(size_t, size_t);
+void* __libc_realloc(void*, size_t);
+void __libc_free(void*);
+
+void* malloc(size_t size) {
+    RealtimeTrap::check("malloc");
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+    RealtimeTrap::check("calloc");
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* p, size_t size) {
+    RealtimeTrap::check("realloc");
+    return __libc_realloc(p, size);
+}
+
+void free(void* p) {
+    // free(nullptr) does nothing, e.g. when an AudioBuffer that only refers to other memory is destroyed.
+    if (p != nullptr)
+        RealtimeTrap::check("free");
+
+    __libc_free(p);
+}
+
+using MutexFunction = int (*)(pthread_mutex_t*);
+
+static MutexFunction realMutexLock = nullptr;
+static MutexFunction realMutexTryLock = nullptr;
+
+// Resolves the real functions before main(), while nothing can be armed yet.
+__attribute__((constructor)) static void resolveMutexFunctions() {
+    realMutexLock = (MutexFunction) dlsym(RTLD_NEXT, "pthread_mutex_lock");
+    realMutexTryLock = (MutexFunction) dlsym(RTLD_NEXT, "pthread_mutex_trylock");
+}
+
+int pthread_mutex_lock(pthread_mutex_t* mutex) {
+    if (realMutexLock == nullptr)
+        resolveMutexFunctions();
+
+    // Taking a free mutex never blocks; only a mutex held elsewhere is a real-time hazard.
+    if (armed && realMutexTryLock(mutex) != 0)
+        RealtimeTrap::check("waiting on a locked mutex");
+    else if (armed)
+        return 0;
+
+    return realMutexLock(mutex);
+}
+}
+#endif
+
+#endif
\ No newline at end of file
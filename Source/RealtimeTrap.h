@@ -0,0 +1,83 @@
+/*
+  ==============================================================================
+
+    RealtimeTrap.h
+    Debug mode that aborts if the audio thread allocates, frees, or blocks on
+    a mutex while processing a block.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * Build with SYNTH_REALTIME_TRAP=1 to enable the trap. It is off by default and costs nothing
+ * when disabled.
+ *
+ * While a RealtimeTrap::ScopedAudioThread is alive on a thread, that thread aborts with a
+ * message on stderr if it:
+ * - calls operator new or delete (every platform);
+ * - calls malloc, calloc, realloc or free (Linux with glibc);
+ * - tries to lock a pthread mutex that another thread holds (Linux with glibc). Uncontended
+ *   locks, such as the one juce::Synthesiser takes around every block, never block and are
+ *   allowed.
+ *
+ * The replacements are only seen by code linked into the same executable, so use the trap
+ * with the benchmark or the Standalone plugin rather than a plugin loaded into a host.
+ */
+#ifndef SYNTH_REALTIME_TRAP
+#define SYNTH_REALTIME_TRAP 0
+#endif
+
+namespace RealtimeTrap {
+
+#if SYNTH_REALTIME_TRAP
+/** Arms the trap on the calling thread for the lifetime of the object. */
+class ScopedAudioThread {
+public:
+    ScopedAudioThread() noexcept;
+    ~ScopedAudioThread() noexcept;
+
+    ScopedAudioThread(const ScopedAudioThread&) = delete;
+    ScopedAudioThread& operator=(const ScopedAudioThread&) = delete;
+
+private:
+    bool wasArmed;
+};
+
+/**
+ * Disarms the trap on the calling thread for the lifetime of the object, for work that
+ * processBlock only does while rendering offline, where blocking and allocating are allowed.
+ */
+class ScopedDisarm {
+public:
+    ScopedDisarm() noexcept;
+    ~ScopedDisarm() noexcept;
+
+    ScopedDisarm(const ScopedDisarm&) = delete;
+    ScopedDisarm& operator=(const ScopedDisarm&) = delete;
+
+private:
+    bool wasArmed;
+};
+
+/**
+ * Aborts with a message if the trap is armed on the calling thread.
+ * @param what A short description of the forbidden call.
+ */
+void check(const char* what) noexcept;
+#else
+class ScopedAudioThread {
+public:
+    ScopedAudioThread() noexcept {}
+};
+
+class ScopedDisarm {
+public:
+    ScopedDisarm() noexcept {}
+};
+
+inline void check(const char*) noexcept {}
+#endif
+
+}
\ No newline at end of file
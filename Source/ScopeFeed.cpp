@@ -0,0 +1,73 @@
+/*
+  ==============================================================================
+
+    ScopeFeed.cpp
+    Hands a decimated mono copy of the output from the audio thread to the
+    editor's scope and spectrum through a wait-free FIFO.
+
+  ==============================================================================
+*/
+
+#include "ScopeFeed.h"
+
+void ScopeFeed::prepare(double sampleRate) noexcept {
+    decimation = juce::jmax(1, (int) (sampleRate / targetRate));
+    numSummed = 0;
+    sum = 0.0f;
+    outputRate.store(sampleRate / decimation, std::memory_order_relaxed);
+}
+
+// Only the reader's side of the FIFO is touched here, so the audio thread may be writing meanwhile.
+void ScopeFeed::setEnabled(bool shouldBeEnabled) noexcept {
+    if (shouldBeEnabled)
+        fifo.finishedRead(fifo.getNumReady());
+
+    enabled.store(shouldBeEnabled, std::memory_order_relaxed);
+}
+
+//==============================================================================
+// Averaging each run of input samples is a crude low-pass, but enough for a display.
+void ScopeFeed::push(const juce::AudioBuffer<float>& buffer, int numSamples) noexcept {
+    const int numChannels = buffer.getNumChannels();
+
+    if (!enabled.load(std::memory_order_relaxed) || numChannels == 0)
+        return;
+
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite((numSummed + numSamples) / decimation, start1, size1, start2, size2);
+
+    const auto* const* channels = buffer.getArrayOfReadPointers();
+    const float gain = 1.0f / (float) (numChannels * decimation);
+    int numWritten = 0;
+
+    for (int i = 0; i < numSamples; ++i) {
+        for (int channel = 0; channel < numChannels; ++channel)
+            sum += channels[channel][i];
+
+        if (++numSummed < decimation)
+            continue;
+
+        // Anything past the free space is dropped rather than waited for.
+        if (numWritten < size1)
+            samples[(size_t) (start1 + numWritten)] = sum * gain;
+        else if (numWritten < size1 + size2)
+            samples[(size_t) (start2 + numWritten - size1)] = sum * gain;
+
+        ++numWritten;
+        numSummed = 0;
+        sum = 0.0f;
+    }
+
+    fifo.finishedWrite(juce::jmin(numWritten, size1 + size2));
+}
+
+int ScopeFeed::pull(float* destination, int maxSamples) noexcept {
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(maxSamples, start1, size1, start2, size2);
+
+    std::copy_n(samples.begin() + start1, size1, destination);
+    std::copy_n(samples.begin() + start2, size2, destination + size1);
+
+    fifo.finishedRead(size1 + size2);
+    return size1 + size2;
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+/*
+  ==============================================================================
+
+    ScopeFeed.h
+    Hands a decimated mono copy of the output from the audio thread to the
+    editor's scope and spectrum through a wait-free FIFO.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+/**
+ * ScopeFeed carries the plugin's output to the editor's displays. The audio thread mixes each
+ * block down to mono, averages it down to roughly targetRate and writes it into a fixed FIFO;
+ * the message thread reads it out at its own pace. Neither side ever waits: when the reader falls
+ * behind, the samples that do not fit are dropped.
+ *
+ * The feed is off until a display enables it and off again once the display is gone, so with the
+ * editor closed the audio thread pays a single relaxed load per block.
+ */
+class ScopeFeed {
+
+public:
+    /** The number of samples the FIFO holds, well over half a second at the decimated rate. */
+    static constexpr int capacity = 1 << 14;
+
+    /** The rate the output is averaged down to, before rounding the factor down to a whole number. */
+    static constexpr double targetRate = 20000.0;
+
+    /**
+     * Chooses the decimation for a sample rate. Must not be called while the audio thread is pushing.
+     * @param sampleRate The audio sample rate.
+     */
+    void prepare(double sampleRate) noexcept;
+
+    /**
+     * Turns the feed on or off. Message thread only.
+     * Turning it on first drops whatever was left from the last time it was on.
+     * @param shouldBeEnabled True while a display is reading.
+     */
+    void setEnabled(bool shouldBeEnabled) noexcept;
+
+    /** Returns the rate of the samples the feed delivers, in Hz. */
+    double getSampleRate() const noexcept { return outputRate.load(std::memory_order_relaxed); }
+
+    /**
+     * Adds a block of output. Audio thread only; never blocks or allocates.
+     * @param buffer The output, whose channels are averaged into one.
+     * @param numSamples The number of samples of the buffer to add.
+     */
+    void push(const juce::AudioBuffer<float>& buffer, int numSamples) noexcept;
+
+    /**
+     * Takes samples out of the FIFO, oldest first. Message thread only.
+     * @param destination Receives the samples.
+     * @param maxSamples The most samples to take.
+     * @return The number of samples taken, 0 if none are waiting.
+     */
+    int pull(float* destination, int maxSamples) noexcept;
+
+private:
+    juce::AbstractFifo fifo{ capacity };
+    std::array<float, capacity> samples{};
+
+    std::atomic<bool> enabled{ false };
+    std::atomic<double> outputRate{ 44100.0 };
+
+    int decimation{ 1 };   ///< Input samples averaged into each output sample.
+    int numSummed{ 0 };    ///< Input samples in sum so far; carried across blocks.
+    float sum{ 0.0f };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ScopeFeed)
+};
\ No newline at end of file
@@ -0,0 +1,745 @@
+/*
+  ==============================================================================
+
+    SynthEngine.cpp
+    Implements the voice pool bookkeeping and the constant-time voice
+    allocation and stealing used by the synthesiser.
+
+  ==============================================================================
+*/
+
+#include "SynthEngine.h"
+#include "SynthVoice.h"
+
+static_assert(VoiceBank::maxLanes >= SynthEngine::maxPolyphony, "The voice bank needs a lane for every pool slot");
+
+//==============================================================================
+template <typename Function>
+void SynthEngine::forEachActiveVoice(int midiChannel, Function&& function) {
+    for (const auto list : { heldList, releasingList })
+        for (int slot = lists[list].head; slot >= 0; slot = nextSlot[(size_t) slot])
+            if (midiChannel <= 0 || pool[(size_t) slot]->isPlayingChannel(midiChannel))
+                function(*pool[(size_t) slot]);
+}
+
+// Free voices are skipped; their version falls behind and updateVoiceSettings() catches them up.
+template <typename Function>
+void SynthEngine::changeSettings(Function&& apply) {
+    const auto previous = settingsVersion++;
+
+    for (const auto list : { heldList, releasingList }) {
+        for (int slot = lists[list].head; slot >= 0; slot = nextSlot[(size_t) slot]) {
+            apply(*pool[(size_t) slot]);
+
+            if (voiceSettingsVersion[(size_t) slot] == previous)
+                voiceSettingsVersion[(size_t) slot] = settingsVersion;
+        }
+    }
+}
+
+//==============================================================================
+SynthEngine::SynthEngine() {
+    prevSlot.fill(-1);
+    nextSlot.fill(-1);
+    slotList.fill(freeList);
+    keySlot.fill(-1);
+    slotKey.fill(-1);
+}
+
+// Creates every voice in the pool up front so that note-ons never allocate.
+void SynthEngine::allocateVoices() {
+    const juce::ScopedLock sl(lock);
+
+    while (numAllocated < maxPolyphony) {
+        const int slot = numAllocated++;
+
+        auto* voice = new SynthVoice();
+        voice->attachToEngine(*this, slot);
+        addVoice(voice);
+
+        pool[(size_t) slot] = voice;
+        append(slot, freeList);
+        applyPan(slot);
+        voice->setMaxOversamplingLevel(maxOversamplingLevel);
+    }
+}
+
+// Prepares every voice in the pool with the current playback configuration.
+void SynthEngine::prepareToPlay(double sampleRate, int samplesPerBlock, int outputChannels) {
+    setCurrentPlaybackSampleRate(sampleRate);
+    voiceBank.prepare(sampleRate, samplesPerBlock);
+
+    for (int slot = 0; slot < numAllocated; ++slot)
+        pool[(size_t) slot]->prepareToPlay(sampleRate, samplesPerBlock, outputChannels);
+
+    // All scratch memory comes from one arena, with one slice per channel of every chunk, long
+    // enough for a chunk of voices at the highest oversampling level.
+    // Voices render straight into their destination and need none of their own.
+    const int numChannels = juce::jmax(1, outputChannels);
+    const int chunkLength = samplesPerBlock << OversampledMix::maxLevel;
+    scratchArena.allocate(maxChunks * numChannels, chunkLength);
+
+    for (int chunk = 0; chunk < maxChunks; ++chunk) {
+        juce::HeapBlock<float*> channels(numChannels);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            channels[channel] = scratchArena.getSlice(chunk * numChannels + channel);
+
+        chunkBuffers[(size_t) chunk].setDataToReferTo(channels.get(), numChannels, chunkLength);
+    }
+
+    oversampledMix.prepare(numChannels, samplesPerBlock);
+
+    // Threads for parallel rendering are created here, never on the audio thread.
+    preparedBlockSize = samplesPerBlock;
+    renderPool.start(juce::jlimit(0, maxWorkerThreads, juce::SystemStats::getNumCpus() - 1), sampleRate, samplesPerBlock);
+}
+
+//==============================================================================
+// Each sub-block first applies its coalesced controllers, then its exact-sample events in turn.
+// Rendering lags behind until an event needs it, so sub-blocks without events render as one.
+void SynthEngine::renderBlock(juce::AudioBuffer<float>& outputAudio, const juce::MidiBuffer& midiData, int startSample, int numSamples) {
+    const juce::ScopedLock sl(lock);
+
+    auto midiIterator = midiData.findNextSamplePosition(startSample);
+    const auto midiEnd = midiData.cend();
+    const int endSample = startSample + numSamples;
+    int position = startSample;
+
+    std::array<juce::MidiMessageMetadata, maxCoalescedEvents> coalesced;
+    std::array<int, maxCoalescedEvents> coalescedKeys;
+
+    const auto renderUpTo = [&](int sample) {
+        if (sample > position) {
+            renderVoices(outputAudio, position, sample - position);
+            position = sample;
+        }
+    };
+
+    for (int subBlockStart = startSample; subBlockStart < endSample; subBlockStart += subBlockSize) {
+        const int subBlockEnd = juce::jmin(endSample, subBlockStart + subBlockSize);
+        int numCoalesced = 0;
+
+        // A later value of a controller replaces the earlier one, keeping its place in the order.
+        for (auto it = midiIterator; it != midiEnd && (*it).samplePosition < subBlockEnd; ++it) {
+            const auto metadata = *it;
+            const int key = getCoalescingKey(metadata);
+
+            if (key < 0)
+                continue;
+
+            int index = 0;
+
+            while (index < numCoalesced && coalescedKeys[(size_t) index] != key)
+                ++index;
+
+            if (index == numCoalesced) {
+                // With the table full, the event is applied at the start of the sub-block as it is.
+                if (numCoalesced == maxCoalescedEvents) {
+                    renderUpTo(subBlockStart);
+                    handleMidiEvent(metadata.getMessage());
+                    continue;
+                }
+
+                coalescedKeys[(size_t) numCoalesced++] = key;
+            }
+
+            coalesced[(size_t) index] = metadata;
+        }
+
+        if (numCoalesced > 0)
+            renderUpTo(subBlockStart);
+
+        for (int i = 0; i < numCoalesced; ++i)
+            handleMidiEvent(coalesced[(size_t) i].getMessage());
+
+        // Values gliding towards a controller's position take one step per sub-block.
+        if (controllerListener != nullptr && controllerListener->isGliding()) {
+            renderUpTo(subBlockStart);
+            controllerListener->advanceGlides(subBlockEnd - subBlockStart);
+        }
+
+        // The global LFO also steps once per sub-block. While a route reads it, the voices render
+        // sub-block by sub-block, so that each one sees the LFO move.
+        if (modMatrix.usesSource(ModMatrix::globalLfo))
+            renderUpTo(subBlockStart);
+
+        advanceGlobalLfo(subBlockEnd - subBlockStart);
+
+        for (; midiIterator != midiEnd && (*midiIterator).samplePosition < subBlockEnd; ++midiIterator) {
+            const auto metadata = *midiIterator;
+
+            if (getCoalescingKey(metadata) < 0) {
+                renderUpTo(metadata.samplePosition);
+                handleMidiEvent(metadata.getMessage());
+            }
+        }
+    }
+
+    renderUpTo(endSample);
+
+    // Like juce::Synthesiser, events past the end of the block are applied once it is rendered.
+    for (; midiIterator != midiEnd; ++midiIterator)
+        handleMidiEvent((*midiIterator).getMessage());
+}
+
+void SynthEngine::advanceGlobalLfo(int numSamples) {
+    globalLfoValue = ModMatrix::getLfoValue(modMatrix.getLfoShape(1), globalLfoPhase);
+
+    if (getSampleRate() > 0.0)
+        globalLfoPhase = DspMath::wrapPhase(globalLfoPhase + (float) (modMatrix.getLfoRate(1) * numSamples / getSampleRate()));
+}
+
+int SynthEngine::getCoalescingKey(const juce::MidiMessageMetadata& metadata) noexcept {
+    if (metadata.numBytes < 2)
+        return -1;
+
+    const int status = metadata.data[0];
+    const int data1 = metadata.data[1];
+
+    switch (status & 0xf0) {
+        case 0xb0:
+            // Bank selects, data entry, pedals, parameter numbers and channel mode messages all
+            // depend on their order, so they are never coalesced.
+            if (data1 == 0x00 || data1 == 0x06 || data1 == 0x20 || data1 == 0x26
+                || (data1 >= 0x40 && data1 <= 0x45) || (data1 >= 0x60 && data1 <= 0x65) || data1 >= 0x78)
+                return -1;
+
+            return status << 8 | data1;
+
+        case 0xa0:
+            return status << 8 | data1;
+
+        case 0xd0:
+        case 0xe0:
+            return status << 8;
+
+        default:
+            return -1;
+    }
+}
+
+void SynthEngine::setPolyphony(int numVoices) {
+    polyphony = juce::jlimit(minPolyphony, maxPolyphony, numVoices);
+}
+
+void SynthEngine::setOversamplingEnabled(bool shouldOversample) {
+    maxOversamplingLevel = shouldOversample ? OversampledMix::maxLevel : 0;
+    oversampledMix.setLatencyCompensated(shouldOversample);
+
+    for (int slot = 0; slot < numAllocated; ++slot)
+        pool[(size_t) slot]->setMaxOversamplingLevel(maxOversamplingLevel);
+}
+
+// Each renderer keeps the state it had when it last rendered a note, so the one taking over
+// continues from the other's envelope and phases. The bank runs at the base rate, voices at their note's rate.
+void SynthEngine::setVoiceBankEnabled(bool shouldUseVoiceBank) {
+    if (shouldUseVoiceBank == voiceBankEnabled)
+        return;
+
+    for (const auto list : { heldList, releasingList }) {
+        for (int slot = lists[list].head; slot >= 0; slot = nextSlot[(size_t) slot]) {
+            auto& voice = *pool[(size_t) slot];
+            auto& osc = voice.getOscillator();
+            const double rateRatio = (double) (1 << voice.getOversamplingLevel());
+
+            if (shouldUseVoiceBank) {
+                voiceBank.setNoteState(slot, voice.getEnvelope().getPosition().resampled(1.0 / rateRatio),
+                                       osc.getPhase(), osc.getFmPhase());
+            }
+            else {
+                AdsrData::Position position;
+                float phase = 0.0f, fmPhase = 0.0f;
+
+                if (voiceBank.getNoteState(slot, position, phase, fmPhase)) {
+                    voice.getEnvelope().setPosition(position.resampled(rateRatio));
+                    osc.setPhases(phase, fmPhase);
+                }
+                else {
+                    voice.finishNote();
+                }
+            }
+        }
+    }
+
+    voiceBankEnabled = shouldUseVoiceBank;
+}
+
+void SynthEngine::setStereoSpread(float spread) {
+    stereoSpread = juce::jlimit(0.0f, 1.0f, spread);
+
+    for (int slot = 0; slot < numAllocated; ++slot)
+        applyPan(slot);
+}
+
+void SynthEngine::setWaveType(int choice) {
+    settings.waveType = choice;
+    voiceBank.setWaveType(choice);
+    changeSettings([choice](SynthVoice& voice) { voice.getOscillator().setWaveType(choice); });
+}
+
+void SynthEngine::setFmParams(float depth, float frequency) {
+    settings.fmDepth = depth;
+    settings.fmFrequency = frequency;
+    voiceBank.setFmParams(depth, frequency);
+    changeSettings([depth, frequency](SynthVoice& voice) { voice.getOscillator().setFmParams(depth, frequency); });
+}
+
+void SynthEngine::setUnison(int unisonVoices, float detune, float spread) {
+    settings.unisonVoices = unisonVoices;
+    settings.unisonDetune = detune;
+    settings.unisonSpread = spread;
+    changeSettings([unisonVoices, detune, spread](SynthVoice& voice) { voice.getOscillator().setUnison(unisonVoices, detune, spread); });
+}
+
+void SynthEngine::setEnvelope(float attack, float decay, float sustain, float release, AdsrData::Curve curve) {
+    settings.attack = attack;
+    settings.decay = decay;
+    settings.sustain = sustain;
+    settings.release = release;
+    settings.curve = curve;
+
+    voiceBank.setEnvelopeCurve(curve);
+    voiceBank.setEnvelope(attack, decay, sustain, release);
+
+    changeSettings([=](SynthVoice& voice) {
+        voice.setEnvelopeCurve(curve);
+        voice.updateADSR(attack, decay, sustain, release);
+    });
+}
+
+void SynthEngine::setSilenceThreshold(float decibels) {
+    const float gain = juce::Decibels::decibelsToGain(decibels);
+
+    settings.silenceThreshold = gain;
+    voiceBank.setSilenceThreshold(gain);
+    changeSettings([gain](SynthVoice& voice) { voice.setSilenceThreshold(gain); });
+}
+
+void SynthEngine::applyPan(int slot) {
+    // Fractional multiples of the golden ratio fill [0, 1) evenly whatever the number of voices.
+    const float position = DspMath::wrapPhase((float) slot * 0.618034f) * 2.0f - 1.0f;
+
+    float left = 1.0f, right = 1.0f;
+    DspMath::panGains(position * stereoSpread, left, right);
+
+    pool[(size_t) slot]->setPanGains(left, right);
+    voiceBank.setPanGains(slot, left, right);
+}
+
+//==============================================================================
+// The voice bank mirrors every note, whichever renderer is active, so switching renderers never drops one.
+void SynthEngine::voiceStarted(SynthVoice& voice) {
+    moveToList(voice.getPoolSlot(), heldList);
+    voiceBank.noteOn(voice.getPoolSlot(), voice.getOscillator().getFrequency());
+}
+
+void SynthEngine::voiceReleased(SynthVoice& voice) {
+    moveToList(voice.getPoolSlot(), releasingList);
+    voiceBank.noteOff(voice.getPoolSlot());
+}
+
+void SynthEngine::voiceStopped(SynthVoice& voice) {
+    moveToList(voice.getPoolSlot(), freeList);
+    voiceBank.stop(voice.getPoolSlot());
+}
+
+void SynthEngine::voicePitchBent(SynthVoice& voice) {
+    voiceBank.setFrequency(voice.getPoolSlot(), voice.getOscillator().getFrequency());
+}
+
+// A free voice missed every settings change since it last played, so it catches up in one go.
+void SynthEngine::updateVoiceSettings(SynthVoice& voice) {
+    auto& version = voiceSettingsVersion[(size_t) voice.getPoolSlot()];
+
+    if (version == settingsVersion)
+        return;
+
+    auto& osc = voice.getOscillator();
+    osc.setWaveType(settings.waveType);
+    osc.setFmParams(settings.fmDepth, settings.fmFrequency);
+    osc.setUnison(settings.unisonVoices, settings.unisonDetune, settings.unisonSpread);
+    voice.setEnvelopeCurve(settings.curve);
+    voice.updateADSR(settings.attack, settings.decay, settings.sustain, settings.release);
+    voice.setSilenceThreshold(settings.silenceThreshold);
+
+    version = settingsVersion;
+}
+
+//==============================================================================
+// Keys a microtuning leaves unmapped are silent, so they never take a voice.
+void SynthEngine::noteOn(int midiChannel, int midiNoteNumber, float velocity) {
+    if (tuning != nullptr && !tuning->isMapped(midiNoteNumber))
+        return;
+
+    const juce::ScopedLock sl(lock);
+    const int key = getKey(midiChannel, midiNoteNumber);
+
+    // A key that is still ringing, held by its key or by a pedal, is released before it plays again.
+    if (keySlot[(size_t) key] >= 0)
+        stopVoice(pool[(size_t) keySlot[(size_t) key]], 1.0f, true);
+
+    for (auto* sound : sounds) {
+        if (!sound->appliesToNote(midiNoteNumber) || !sound->appliesToChannel(midiChannel))
+            continue;
+
+        auto* voice = static_cast<SynthVoice*>(findFreeVoice(sound, midiChannel, midiNoteNumber, isNoteStealingEnabled()));
+
+        if (voice == nullptr)
+            continue;
+
+        startVoice(voice, sound, midiChannel, midiNoteNumber, velocity);
+
+        // juce::Synthesiser's own pedal state is never set, since the pedals are handled here.
+        // The voice only hears the mod wheel while it plays, so it starts from the channel's position.
+        voice->setSustainPedalDown(sustainPedalDown[(size_t) juce::jlimit(0, numMidiChannels, midiChannel)]);
+        voice->setModWheel(modWheel[(size_t) juce::jlimit(0, numMidiChannels, midiChannel)]);
+
+        const int slot = voice->getPoolSlot();
+        keySlot[(size_t) key] = slot;
+        slotKey[(size_t) slot] = key;
+    }
+}
+
+void SynthEngine::noteOff(int midiChannel, int midiNoteNumber, float velocity, bool allowTailOff) {
+    const juce::ScopedLock sl(lock);
+    const int slot = keySlot[(size_t) getKey(midiChannel, midiNoteNumber)];
+
+    if (slot < 0)
+        return;
+
+    auto* voice = pool[(size_t) slot];
+    voice->setKeyDown(false);
+
+    if (!(voice->isSustainPedalDown() || voice->isSostenutoPedalDown()))
+        stopVoice(voice, velocity, allowTailOff);
+}
+
+void SynthEngine::allNotesOff(int midiChannel, bool allowTailOff) {
+    const juce::ScopedLock sl(lock);
+
+    // Stopping a voice moves it to another list, so the next slot is read first.
+    for (const auto list : { heldList, releasingList }) {
+        if (list == releasingList && allowTailOff)
+            break;
+
+        for (int slot = lists[list].head; slot >= 0;) {
+            const int next = nextSlot[(size_t) slot];
+            auto* voice = pool[(size_t) slot];
+
+            if (midiChannel <= 0 || voice->isPlayingChannel(midiChannel))
+                voice->stopNote(1.0f, allowTailOff);
+
+            slot = next;
+        }
+    }
+
+    if (midiChannel <= 0)
+        sustainPedalDown.fill(false);
+    else if (midiChannel <= numMidiChannels)
+        sustainPedalDown[(size_t) midiChannel] = false;
+}
+
+void SynthEngine::handlePitchWheel(int midiChannel, int wheelValue) {
+    const juce::ScopedLock sl(lock);
+    forEachActiveVoice(midiChannel, [wheelValue](SynthVoice& voice) { voice.pitchWheelMoved(wheelValue); });
+}
+
+void SynthEngine::handleController(int midiChannel, int controllerNumber, int controllerValue) {
+    if (controllerListener != nullptr && controllerListener->controllerMoved(midiChannel, controllerNumber, controllerValue))
+        return;
+
+    switch (controllerNumber) {
+        case 0x01: modWheel[(size_t) juce::jlimit(0, numMidiChannels, midiChannel)] = (float) controllerValue / 127.0f; break;
+        case 0x40: handleSustainPedal(midiChannel, controllerValue >= 64); break;
+        case 0x42: handleSostenutoPedal(midiChannel, controllerValue >= 64); break;
+        case 0x43: handleSoftPedal(midiChannel, controllerValue >= 64); break;
+        default: break;
+    }
+
+    const juce::ScopedLock sl(lock);
+    forEachActiveVoice(juce::jmax(1, midiChannel), [controllerNumber, controllerValue](SynthVoice& voice) {
+        voice.controllerMoved(controllerNumber, controllerValue);
+    });
+}
+
+void SynthEngine::handleAftertouch(int midiChannel, int midiNoteNumber, int aftertouchValue) {
+    const juce::ScopedLock sl(lock);
+
+    if (midiChannel > 0) {
+        const int slot = keySlot[(size_t) getKey(midiChannel, midiNoteNumber)];
+
+        if (slot >= 0)
+            pool[(size_t) slot]->aftertouchChanged(aftertouchValue);
+
+        return;
+    }
+
+    forEachActiveVoice(0, [midiNoteNumber, aftertouchValue](SynthVoice& voice) {
+        if (voice.getCurrentlyPlayingNote() == midiNoteNumber)
+            voice.aftertouchChanged(aftertouchValue);
+    });
+}
+
+void SynthEngine::handleChannelPressure(int midiChannel, int channelPressureValue) {
+    const juce::ScopedLock sl(lock);
+    forEachActiveVoice(midiChannel, [channelPressureValue](SynthVoice& voice) { voice.channelPressureChanged(channelPressureValue); });
+}
+
+// Only held voices can be kept by a pedal; releasing voices are past it.
+void SynthEngine::handleSustainPedal(int midiChannel, bool isDown) {
+    jassert(midiChannel > 0 && midiChannel <= numMidiChannels);
+
+    const juce::ScopedLock sl(lock);
+    sustainPedalDown[(size_t) juce::jlimit(0, numMidiChannels, midiChannel)] = isDown;
+
+    for (int slot = lists[heldList].head; slot >= 0;) {
+        const int next = nextSlot[(size_t) slot];
+        auto* voice = pool[(size_t) slot];
+
+        if (voice->isPlayingChannel(midiChannel)) {
+            if (isDown) {
+                if (voice->isKeyDown())
+                    voice->setSustainPedalDown(true);
+            }
+            else {
+                voice->setSustainPedalDown(false);
+
+                if (!(voice->isKeyDown() || voice->isSostenutoPedalDown()))
+                    stopVoice(voice, 1.0f, true);
+            }
+        }
+
+        slot = next;
+    }
+}
+
+void SynthEngine::handleSostenutoPedal(int midiChannel, bool isDown) {
+    jassert(midiChannel > 0 && midiChannel <= numMidiChannels);
+
+    const juce::ScopedLock sl(lock);
+
+    for (int slot = lists[heldList].head; slot >= 0;) {
+        const int next = nextSlot[(size_t) slot];
+        auto* voice = pool[(size_t) slot];
+
+        if (voice->isPlayingChannel(midiChannel)) {
+            if (isDown) {
+                if (voice->isKeyDown())
+                    voice->setSostenutoPedalDown(true);
+            }
+            else if (voice->isSostenutoPedalDown()) {
+                voice->setSostenutoPedalDown(false);
+
+                if (!(voice->isKeyDown() || voice->isSustainPedalDown()))
+                    stopVoice(voice, 1.0f, true);
+            }
+        }
+
+        slot = next;
+    }
+}
+
+//==============================================================================
+// Hands out the oldest free voice while we are under the polyphony limit, otherwise steals one.
+juce::SynthesiserVoice* SynthEngine::findFreeVoice(juce::SynthesiserSound* soundToPlay, int midiChannel,
+                                                   int midiNoteNumber, bool stealIfNoneAvailable) const {
+    if (getNumActiveVoices() < polyphony && lists[freeList].head >= 0)
+        return pool[(size_t) lists[freeList].head];
+
+    if (stealIfNoneAvailable)
+        return findVoiceToSteal(soundToPlay, midiChannel, midiNoteNumber);
+
+    return nullptr;
+}
+
+// Picks a voice to steal by looking only at the heads of the held and releasing lists.
+juce::SynthesiserVoice* SynthEngine::findVoiceToSteal(juce::SynthesiserSound*, int, int) const {
+    const int held = lists[heldList].head;
+    const int releasing = lists[releasingList].head;
+
+    if (held < 0 && releasing < 0)
+        return lists[freeList].head >= 0 ? pool[(size_t) lists[freeList].head] : nullptr;
+
+    if (held < 0)
+        return pool[(size_t) releasing];
+
+    if (releasing < 0)
+        return pool[(size_t) held];
+
+    if (stealMode == StealMode::releasingFirst)
+        return pool[(size_t) releasing];
+
+    // The releasing list is ordered by release time, so its head is not necessarily the oldest
+    // note, but comparing the two heads keeps the choice constant-time.
+    return pool[(size_t) releasing]->wasStartedBefore(*pool[(size_t) held]) ? pool[(size_t) releasing]
+                                                                             : pool[(size_t) held];
+}
+
+//==============================================================================
+void SynthEngine::renderVoices(juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples) {
+    // The oversampled buses hold one prepared block, so a longer block from the host is split.
+    if (numSamples > preparedBlockSize && preparedBlockSize > 0) {
+        for (int done = 0; done < numSamples; done += preparedBlockSize)
+            renderVoices(outputAudio, startSample + done, juce::jmin(preparedBlockSize, numSamples - done));
+
+        return;
+    }
+
+    const int numVoices = getNumActiveVoices();
+    const juce::int64 voicesStart = perfMonitor != nullptr ? PerfMonitor::now() : 0;
+
+    if (voiceBankEnabled) {
+        voiceBank.render(outputAudio, startSample, numSamples);
+
+        // Voices whose lane finished its release are done, even though they never rendered themselves.
+        for (const auto list : { heldList, releasingList })
+            for (int slot = lists[list].head; slot >= 0; slot = nextSlot[(size_t) slot])
+                if (!voiceBank.isSounding(slot))
+                    pool[(size_t) slot]->finishNote();
+    }
+    else if (multiThreaded && numVoices >= minVoicesForThreads && renderPool.getNumWorkers() > 0) {
+        renderVoicesInParallel(outputAudio, startSample, numSamples);
+    }
+    else {
+        renderVoicesSerially(outputAudio, startSample, numSamples);
+    }
+
+    const juce::int64 mixStart = perfMonitor != nullptr ? PerfMonitor::now() : 0;
+
+    // Decimates the oversampled voices into the output, aligned with the rest.
+    oversampledMix.addTo(outputAudio, startSample, numSamples);
+
+    if (perfMonitor != nullptr) {
+        perfMonitor->record(PerfMonitor::voiceStage, voicesStart, mixStart, numVoices, numSamples);
+        perfMonitor->record(PerfMonitor::mixStage, mixStart, PerfMonitor::now(), numVoices, numSamples);
+    }
+
+    // Voices only leave the held and releasing lists here, after every thread has finished with them.
+    reclaimFinishedVoices();
+}
+
+void SynthEngine::renderVoicesSerially(juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples) {
+    for (const auto list : { heldList, releasingList })
+        for (int slot = lists[list].head; slot >= 0; slot = nextSlot[(size_t) slot])
+            renderVoice(*pool[(size_t) slot], outputAudio, startSample, numSamples);
+}
+
+void SynthEngine::renderVoice(SynthVoice& voice, juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples) {
+    const int level = voice.getOversamplingLevel();
+
+    if (level == 0)
+        voice.renderNextBlock(outputAudio, startSample, numSamples);
+    else
+        voice.renderNextBlock(oversampledMix.getBus(level, numSamples), 0, numSamples << level);
+}
+
+void SynthEngine::renderVoicesInParallel(juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples) {
+    numRenderSlots = 0;
+    numRenderChunks = 0;
+
+    // Group the voices by level, so that each chunk renders at a single rate.
+    for (int level = 0; level <= OversampledMix::maxLevel; ++level) {
+        const int begin = numRenderSlots;
+
+        for (const auto list : { heldList, releasingList })
+            for (int slot = lists[list].head; slot >= 0; slot = nextSlot[(size_t) slot])
+                if (pool[(size_t) slot]->getOversamplingLevel() == level)
+                    renderSlots[(size_t) numRenderSlots++] = slot;
+
+        for (int first = begin; first < numRenderSlots; first += voicesPerChunk)
+            renderChunks[(size_t) numRenderChunks++] = { level, first, juce::jmin(numRenderSlots, first + voicesPerChunk) };
+    }
+
+    chunkNumSamples = numSamples;
+    renderPool.run(*this, numRenderChunks);
+
+    // Summing in chunk order keeps the result identical whichever thread rendered each chunk.
+    for (int chunk = 0; chunk < numRenderChunks; ++chunk) {
+        const int level = renderChunks[(size_t) chunk].level;
+        const auto& buffer = chunkBuffers[(size_t) chunk];
+        auto& destination = level == 0 ? outputAudio : oversampledMix.getBus(level, numSamples);
+        const int destinationStart = level == 0 ? startSample : 0;
+        const int numChannels = juce::jmin(destination.getNumChannels(), buffer.getNumChannels());
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            destination.addFrom(channel, destinationStart, buffer, channel, 0, numSamples << level);
+    }
+}
+
+void SynthEngine::runChunk(int chunk) noexcept {
+    const auto& renderChunk = renderChunks[(size_t) chunk];
+    const int length = chunkNumSamples << renderChunk.level;
+
+    auto& buffer = chunkBuffers[(size_t) chunk];
+    buffer.clear(0, length);
+
+    for (int i = renderChunk.begin; i < renderChunk.end; ++i)
+        pool[(size_t) renderSlots[(size_t) i]]->renderNextBlock(buffer, 0, length);
+}
+
+void SynthEngine::reclaimFinishedVoices() {
+    for (const auto list : { heldList, releasingList }) {
+        for (int slot = lists[list].head; slot >= 0;) {
+            const int next = nextSlot[(size_t) slot];
+
+            if (!pool[(size_t) slot]->isVoiceActive()) {
+                moveToList(slot, freeList);
+                voiceBank.stop(slot);
+            }
+
+            slot = next;
+        }
+    }
+}
+
+// A voice that is no longer held stops playing its key, so the key is taken out of the index.
+void SynthEngine::moveToList(int slot, ListId list) {
+    const auto s = (size_t) slot;
+
+    if (list != heldList && slotKey[s] >= 0) {
+        if (keySlot[(size_t) slotKey[s]] == slot)
+            keySlot[(size_t) slotKey[s]] = -1;
+
+        slotKey[s] = -1;
+    }
+
+    unlink(slot);
+    append(slot, list);
+}
+
+void SynthEngine::unlink(int slot) {
+    const auto s = (size_t) slot;
+    auto& from = lists[slotList[s]];
+
+    if (prevSlot[s] >= 0)
+        nextSlot[(size_t) prevSlot[s]] = nextSlot[s];
+    else
+        from.head = nextSlot[s];
+
+    if (nextSlot[s] >= 0)
+        prevSlot[(size_t) nextSlot[s]] = prevSlot[s];
+    else
+        from.tail = prevSlot[s];
+
+    prevSlot[s] = -1;
+    nextSlot[s] = -1;
+    --from.size;
+}
+
+void SynthEngine::append(int slot, ListId list) {
+    const auto s = (size_t) slot;
+    auto& to = lists[list];
+
+    prevSlot[s] = to.tail;
+    nextSlot[s] = -1;
+
+    if (to.tail >= 0)
+        nextSlot[(size_t) to.tail] = slot;
+    else
+        to.head = slot;
+
+    to.tail = slot;
+    ++to.size;
+    slotList[s] = list;
+}
\ No newline at end of file
@@ -0,0 +1,489 @@
+/*
+  ==============================================================================
+
+    SynthEngine.h
+    Extends juce::Synthesiser with a preallocated voice pool, a polyphony limit
+    and a constant-time voice stealing policy.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include "Data/VoiceBank.h"
+#include "Data/ScratchArena.h"
+#include "Data/OversampledMix.h"
+#include "Data/TuningTable.h"
+#include "Data/ModMatrix.h"
+#include "VoiceRenderPool.h"
+#include "PerfMonitor.h"
+
+class SynthVoice;
+
+/**
+ * SynthEngine owns a fixed pool of SynthVoice objects that is allocated once, outside the
+ * audio thread. Voices are kept in three intrusive lists (free, held and releasing), ordered
+ * by the time they entered the list, so finding a free voice or a voice to steal is O(1)
+ * instead of juce::Synthesiser's scan over every voice.
+ *
+ * The voices can either render themselves one at a time, or hand their notes to a VoiceBank
+ * that renders all of them together with SIMD instructions. The voices keep doing the note
+ * bookkeeping in both cases, so allocation and stealing behave the same either way.
+ *
+ * When voices render themselves, a large number of them can be spread over a pool of worker
+ * threads. The active voices are split into fixed chunks that each render into their own
+ * scratch buffer, and the chunks are summed in order, so the output does not depend on which
+ * thread rendered which chunk.
+ *
+ * With oversampling on, each note that needs it renders at 2x, 4x or 8x the sample rate into a
+ * bus of the OversampledMix, which decimates the buses into the output once per block. Every
+ * other voice, and the voice bank, renders straight into the output as before.
+ *
+ * MIDI is handled without juce::Synthesiser's scans over every voice. An index from each
+ * channel and key to the held voice playing it makes note-offs, retriggers and aftertouch
+ * O(1), and pedals, pitch bend and controllers only visit the held and releasing voices.
+ * Oscillator and envelope settings are pushed to the sounding voices only; the others are
+ * brought up to date when they start their next note.
+ *
+ * The engine owns the modulation matrix, which the voices read at their control points, and
+ * runs its global LFO once per sub-block.
+ */
+class SynthEngine : public juce::Synthesiser, private VoiceRenderPool::Job {
+
+public:
+    /** The number of voices allocated up front; the polyphony parameter can never exceed this. */
+    static constexpr int maxPolyphony = 128;
+
+    /** The smallest polyphony the polyphony parameter allows. */
+    static constexpr int minPolyphony = 8;
+
+    /** Number of voices rendered together by one thread when rendering on several threads. */
+    static constexpr int voicesPerChunk = 4;
+
+    /** Below this many active voices, rendering on several threads costs more than it saves. */
+    static constexpr int minVoicesForThreads = 16;
+
+    /** The largest number of worker threads started in addition to the audio thread. */
+    static constexpr int maxWorkerThreads = 7;
+
+    /** Length of the control-rate sub-blocks that renderBlock() renders in. */
+    static constexpr int subBlockSize = 32;
+
+    /** The largest number of distinct continuous controllers coalesced in one sub-block. */
+    static constexpr int maxCoalescedEvents = 64;
+
+    /** Selects which voice is taken when a note arrives and the polyphony limit has been reached. */
+    enum class StealMode {
+        releasingFirst = 0, ///< The voice that has been releasing longest, otherwise the oldest held voice.
+        oldest              ///< The voice that was started earliest, whether it is held or releasing.
+    };
+
+    /**
+     * Receives the controller changes of renderBlock() before the voices do, and moves any value
+     * that glides towards a controller's position once per sub-block.
+     */
+    class ControllerListener {
+    public:
+        virtual ~ControllerListener() = default;
+
+        /**
+         * Called for every controller change, when renderBlock() applies it.
+         * @return True if the change was used, in which case the voices never see it.
+         */
+        virtual bool controllerMoved(int midiChannel, int controllerNumber, int controllerValue) = 0;
+
+        /** Returns true while values are gliding, so that advanceGlides() is called for the next sub-block. */
+        virtual bool isGliding() = 0;
+
+        /**
+         * Called at the start of a sub-block while isGliding() returns true.
+         * @param numSamples The length of the sub-block.
+         */
+        virtual void advanceGlides(int numSamples) = 0;
+    };
+
+    SynthEngine();
+
+    /**
+     * Allocates the full voice pool. Does nothing if the voices already exist, so it is safe
+     * to call from every prepareToPlay. Must not be called from the audio thread.
+     */
+    void allocateVoices();
+
+    /**
+     * Prepares every voice in the pool for playback, and lays out the scratch arena that the
+     * render chunks use, so nothing allocates while rendering.
+     * @param sampleRate The audio sample rate.
+     * @param samplesPerBlock The maximum number of samples per block.
+     * @param outputChannels The number of output audio channels.
+     */
+    void prepareToPlay(double sampleRate, int samplesPerBlock, int outputChannels);
+
+    /**
+     * Renders a block in fixed sub-blocks of subBlockSize samples, instead of splitting it at
+     * every MIDI event as juce::Synthesiser::renderNextBlock() does.
+     *
+     * Continuous controllers (controller changes other than pedals, bank selects, parameter
+     * numbers and channel modes, as well as pitch wheel and pressure) are coalesced: only the
+     * last value of each in a sub-block is applied, at the start of the sub-block. Notes, pedals
+     * and every other event are still applied at their exact sample, in order.
+     *
+     * @param outputAudio The buffer the voices are added to.
+     * @param midiData The MIDI events of the block.
+     * @param startSample The first sample of the block to render.
+     * @param numSamples The number of samples to render.
+     */
+    void renderBlock(juce::AudioBuffer<float>& outputAudio, const juce::MidiBuffer& midiData, int startSample, int numSamples);
+
+    /**
+     * Sets the object that gets the first look at controller changes, or nullptr for none.
+     * @param listener The listener, which must outlive the engine or be removed first.
+     */
+    void setControllerListener(ControllerListener* listener) { controllerListener = listener; }
+
+    /**
+     * Sets the monitor that times every run of the voices and of the mix, or nullptr for none.
+     * @param monitor The monitor, which must outlive the engine or be removed first.
+     */
+    void setPerfMonitor(PerfMonitor* monitor) { perfMonitor = monitor; }
+
+    /**
+     * Sets how many voices may sound at once. Reducing it never cuts voices off; the next
+     * note-ons steal until the number of sounding voices is back under the limit.
+     * @param numVoices The polyphony, clamped to [minPolyphony, maxPolyphony].
+     */
+    void setPolyphony(int numVoices);
+
+    /**
+     * Sets the voice stealing policy.
+     * @param mode The policy used once the polyphony limit is reached.
+     */
+    void setStealMode(StealMode mode) { stealMode = mode; }
+
+    /**
+     * Returns the typed voice in a given pool slot.
+     * @param slot The pool slot, in [0, getNumVoices()).
+     */
+    SynthVoice* getSynthVoice(int slot) const { return pool[(size_t) slot]; }
+
+    /**
+     * Switches between rendering each voice on its own and rendering all of them in the
+     * voice bank. Notes that are sounding when the renderer changes carry on in the new one:
+     * their envelope position and oscillator phases are handed over, so they neither re-attack nor jump.
+     * @param shouldUseVoiceBank True to render through the voice bank.
+     */
+    void setVoiceBankEnabled(bool shouldUseVoiceBank);
+
+    /**
+     * Spreads the voices across the stereo field. Each pool slot gets a fixed position, spaced
+     * by the golden ratio so that consecutive voices land far apart, scaled by the spread.
+     * @param spread 0 for every voice in the centre, 1 for the full width.
+     */
+    void setStereoSpread(float spread);
+
+    /**
+     * Allows voices to be rendered on the worker threads when enough of them are active.
+     * Only applies while the voices render themselves; the voice bank always runs on the audio thread.
+     * @param shouldUseThreads True to spread large voice counts over the worker threads.
+     */
+    void setMultiThreaded(bool shouldUseThreads) { multiThreaded = shouldUseThreads; }
+
+    /**
+     * Lets notes started from now on render oversampled when their FM needs it, and delays the
+     * output by OversampledMix::getLatency() samples so that every voice lines up. Notes that are
+     * already sounding keep their rate. The voice bank always renders at the base rate.
+     * @param shouldOversample True to oversample the notes that need it.
+     */
+    void setOversamplingEnabled(bool shouldOversample);
+
+    /**
+     * Selects the tuning that notes started from now on are pitched with. Notes the tuning leaves
+     * unmapped are ignored. Sounding notes keep their pitch.
+     * @param table The tuning, which must stay alive until another one is set.
+     */
+    void setTuning(const TuningTable& table) { tuning = &table; }
+
+    /** Returns the tuning set with setTuning(). */
+    const TuningTable& getTuning() const noexcept { return *tuning; }
+
+    /**
+     * Selects the waveform of every voice and of the voice bank.
+     * @param choice An integer representing the waveform type (0 for sine, 1 for saw, 2 for square).
+     */
+    void setWaveType(int choice);
+
+    /**
+     * Sets the frequency modulation of every voice and of the voice bank.
+     * @param depth The depth of the frequency modulation in Hz.
+     * @param frequency The frequency of the modulation oscillator in Hz.
+     */
+    void setFmParams(float depth, float frequency);
+
+    /**
+     * Sets the unison stack of every voice. The voice bank has no unison.
+     * @param unisonVoices The number of detuned copies per voice.
+     * @param detune The detune of the outermost copies in cents.
+     * @param spread The stereo width of the stack, from 0 to 1.
+     */
+    void setUnison(int unisonVoices, float detune, float spread);
+
+    /**
+     * Sets the envelope of every voice and of the voice bank.
+     * @param attack The attack time in seconds.
+     * @param decay The decay time in seconds.
+     * @param sustain The sustain level.
+     * @param release The release time in seconds.
+     * @param curve The shape of the segments.
+     */
+    void setEnvelope(float attack, float decay, float sustain, float release, AdsrData::Curve curve);
+
+    /**
+     * Sets the envelope level below which a released note is treated as silent and its voice
+     * freed, in the voices and in the voice bank.
+     * @param decibels The level in dBFS; -100 or lower plays every release to its end.
+     */
+    void setSilenceThreshold(float decibels);
+
+    /**
+     * Sets one slot of the modulation matrix. Routes apply to the sounding voices from their next
+     * control point. The voice bank does not modulate, so it should be turned off while any slot routes something.
+     * @param slot The slot, from 0 to ModMatrix::numSlots - 1.
+     * @param source One of the ModMatrix::Source values.
+     * @param target One of the ModMatrix::Target values.
+     * @param amount The depth of the route, from -1 to 1.
+     */
+    void setModulation(int slot, int source, int target, float amount) { modMatrix.setSlot(slot, source, target, amount); }
+
+    /**
+     * Sets the waveform and rate of the voice LFO or the global LFO.
+     * @param lfo 0 for the voice LFO, 1 for the global LFO.
+     * @param shape One of the ModMatrix::LfoShape values.
+     * @param rate The rate in Hz.
+     */
+    void setLfo(int lfo, int shape, float rate) { modMatrix.setLfo(lfo, shape, rate); }
+
+    /** Returns the modulation matrix. */
+    const ModMatrix& getModMatrix() const noexcept { return modMatrix; }
+
+    /** Returns the value of the global LFO for the current sub-block, from -1 to 1. */
+    float getGlobalLfoValue() const noexcept { return globalLfoValue; }
+
+    /**
+     * Returns true when no voice is sounding and nothing is left in the oversampling buses or
+     * the output delay, so a block without MIDI would render only silence.
+     */
+    bool isSilent() const noexcept { return getNumActiveVoices() == 0 && oversampledMix.isSilent(); }
+
+    /** Returns the voice bank. */
+    VoiceBank& getVoiceBank() { return voiceBank; }
+
+    /** Returns the number of voices that are currently held or releasing. */
+    int getNumActiveVoices() const { return lists[heldList].size + lists[releasingList].size; }
+
+    //==============================================================================
+    // Notifications from SynthVoice. These are always called with the synthesiser lock held.
+
+    /** Called when a voice starts a note. */
+    void voiceStarted(SynthVoice& voice);
+
+    /** Called when a voice enters its release stage. */
+    void voiceReleased(SynthVoice& voice);
+
+    /** Called when a voice is stopped immediately, without a release tail. */
+    void voiceStopped(SynthVoice& voice);
+
+    /** Called when the pitch wheel bends a voice's note. */
+    void voicePitchBent(SynthVoice& voice);
+
+    /** Called before a voice starts a note, to apply any settings it missed while it was free. */
+    void updateVoiceSettings(SynthVoice& voice);
+
+    //==============================================================================
+    // MIDI handling, replacing juce::Synthesiser's scans over every voice.
+
+    /**
+     * Starts a note unless the current tuning leaves it unmapped. A key that is still held, or
+     * kept by a pedal, is released first.
+     */
+    void noteOn(int midiChannel, int midiNoteNumber, float velocity) override;
+
+    /** Releases the voice holding the key, unless a pedal keeps it. */
+    void noteOff(int midiChannel, int midiNoteNumber, float velocity, bool allowTailOff) override;
+
+    /** Releases every held voice on the channel, and cuts the releasing ones too if there is no tail-off. */
+    void allNotesOff(int midiChannel, bool allowTailOff) override;
+
+    /** Passes the wheel to the sounding voices on the channel. */
+    void handlePitchWheel(int midiChannel, int wheelValue) override;
+
+    /**
+     * Offers the controller to the controller listener, then handles the pedals and passes the
+     * controller to the sounding voices on the channel.
+     */
+    void handleController(int midiChannel, int controllerNumber, int controllerValue) override;
+
+    /** Passes the pressure to the voice holding the key. */
+    void handleAftertouch(int midiChannel, int midiNoteNumber, int aftertouchValue) override;
+
+    /** Passes the pressure to the sounding voices on the channel. */
+    void handleChannelPressure(int midiChannel, int channelPressureValue) override;
+
+    /** Keeps the held voices on the channel sounding after their keys are released, or lets them go. */
+    void handleSustainPedal(int midiChannel, bool isDown) override;
+
+    /** Keeps the voices whose keys are down when the pedal is pressed, or lets them go. */
+    void handleSostenutoPedal(int midiChannel, bool isDown) override;
+
+protected:
+    juce::SynthesiserVoice* findFreeVoice(juce::SynthesiserSound* soundToPlay, int midiChannel,
+                                          int midiNoteNumber, bool stealIfNoneAvailable) const override;
+
+    juce::SynthesiserVoice* findVoiceToSteal(juce::SynthesiserSound* soundToPlay, int midiChannel,
+                                             int midiNoteNumber) const override;
+
+    using juce::Synthesiser::renderVoices;
+
+    /**
+     * Renders only the held and releasing voices, either one by one or through the voice bank,
+     * then returns any voice whose envelope finished during the block to the free list.
+     */
+    void renderVoices(juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples) override;
+
+private:
+    enum ListId { freeList = 0, heldList, releasingList, numLists };
+
+    struct VoiceList {
+        int head{ -1 };
+        int tail{ -1 };
+        int size{ 0 };
+    };
+
+    /**
+     * Returns the key continuous controllers are coalesced by, unique per controller and channel,
+     * or -1 for an event that must be applied at its exact sample.
+     */
+    static int getCoalescingKey(const juce::MidiMessageMetadata& metadata) noexcept;
+
+    /** Unlinks a slot from whichever list it is in and appends it to the end of another. */
+    void moveToList(int slot, ListId list);
+
+    /** Removes a slot from the list it is currently linked into. */
+    void unlink(int slot);
+
+    /** Links a currently unlinked slot onto the tail of a list. */
+    void append(int slot, ListId list);
+
+    /** Returns the index of a channel and key in keySlot. */
+    static int getKey(int midiChannel, int midiNoteNumber) noexcept {
+        return (juce::jlimit(1, numMidiChannels, midiChannel) - 1) * numMidiNotes + midiNoteNumber;
+    }
+
+    /** Calls a function for every held and releasing voice on a channel, or on every channel if it is 0. */
+    template <typename Function>
+    void forEachActiveVoice(int midiChannel, Function&& function);
+
+    /**
+     * Applies a settings change to every held and releasing voice and starts a new settings
+     * version. Voices that were up to date stay so; the rest catch up in updateVoiceSettings().
+     */
+    template <typename Function>
+    void changeSettings(Function&& apply);
+
+    /**
+     * Takes the value of the global LFO for the sub-block that starts now, then moves it on.
+     * @param numSamples The length of the sub-block.
+     */
+    void advanceGlobalLfo(int numSamples);
+
+    /** Pushes the pan gains for the current stereo spread to one slot's voice and voice bank lane. */
+    void applyPan(int slot);
+
+    /** Renders the held and releasing voices one after another on the audio thread. */
+    void renderVoicesSerially(juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples);
+
+    /** Renders the held and releasing voices in chunks across the worker threads and sums the chunks in order. */
+    void renderVoicesInParallel(juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples);
+
+    /** Renders one voice into the output, or into the oversampled bus of its level. */
+    void renderVoice(SynthVoice& voice, juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples);
+
+    /** Renders one chunk of voices into its scratch buffer. Called from the audio thread or a worker. */
+    void runChunk(int chunk) noexcept override;
+
+    /** Moves voices that have cleared their note during rendering back to the free list. */
+    void reclaimFinishedVoices();
+
+    std::array<SynthVoice*, maxPolyphony> pool{};   ///< Typed view of the voices owned by juce::Synthesiser.
+    std::array<int, maxPolyphony> prevSlot{};       ///< Previous slot in the same list, or -1.
+    std::array<int, maxPolyphony> nextSlot{};       ///< Next slot in the same list, or -1.
+    std::array<ListId, maxPolyphony> slotList{};    ///< The list each slot currently belongs to.
+    std::array<VoiceList, numLists> lists{};        ///< Free, held and releasing lists, oldest first.
+    int numAllocated{ 0 };                          ///< Number of voices in the pool.
+    int polyphony{ 16 };                            ///< Maximum number of voices sounding at once.
+    StealMode stealMode{ StealMode::releasingFirst };
+    VoiceBank voiceBank;                            ///< Vectorised renderer, with one lane per pool slot.
+    bool voiceBankEnabled{ false };                 ///< Whether voices render through the voice bank.
+    float stereoSpread{ 0.0f };                     ///< Width of the voice positions, from 0 to 1.
+
+    // Every chunk holds voices of one oversampling level, so each level can leave one chunk part full.
+    static constexpr int maxChunks = maxPolyphony / voicesPerChunk + OversampledMix::maxLevel;
+
+    /** A run of renderSlots that one thread renders into one chunk buffer. */
+    struct RenderChunk {
+        int level;   ///< The oversampling level of every voice in the chunk.
+        int begin;   ///< The first entry of renderSlots.
+        int end;     ///< One past the last entry.
+    };
+
+    ScratchArena scratchArena;                                      ///< Every chunk's scratch memory, sized in prepareToPlay.
+    VoiceRenderPool renderPool;                                     ///< Worker threads, started in prepareToPlay.
+    std::array<juce::AudioBuffer<float>, maxChunks> chunkBuffers;   ///< One mix per chunk of voices, referring to the arena.
+    std::array<int, maxPolyphony> renderSlots{};                    ///< Slots being rendered this block, grouped by level in list order.
+    int numRenderSlots{ 0 };                                        ///< Number of entries in renderSlots.
+    std::array<RenderChunk, maxChunks> renderChunks{};              ///< The chunks of the current parallel render.
+    int numRenderChunks{ 0 };                                       ///< Number of entries in renderChunks.
+    int chunkNumSamples{ 0 };                                       ///< Block length of the current parallel render.
+    int preparedBlockSize{ 0 };                                     ///< Length of the chunk buffers.
+    bool multiThreaded{ false };                                    ///< Whether the worker threads may be used.
+    OversampledMix oversampledMix;                                  ///< Buses for the voices that render oversampled.
+    int maxOversamplingLevel{ 0 };                                  ///< Highest level new notes may render at.
+    const TuningTable* tuning{ nullptr };                           ///< Note frequencies, owned by the processor's TuningLoader.
+    ControllerListener* controllerListener{ nullptr };              ///< Sees controller changes before the voices.
+    PerfMonitor* perfMonitor{ nullptr };                            ///< Times the voices and the mix, if set.
+
+    static constexpr int numMidiChannels = 16;
+    static constexpr int numMidiNotes = 128;
+
+    std::array<int, numMidiChannels * numMidiNotes> keySlot{};      ///< The held slot playing each channel and key, or -1.
+    std::array<int, maxPolyphony> slotKey{};                        ///< The key each held slot is playing, or -1.
+    std::array<bool, numMidiChannels + 1> sustainPedalDown{};       ///< Per MIDI channel, from 1.
+    std::array<float, numMidiChannels + 1> modWheel{};              ///< Mod wheel position per MIDI channel, from 1, for new notes.
+
+    ModMatrix modMatrix;                                            ///< Routes, and the settings of both LFOs.
+    float globalLfoPhase{ 0.0f };                                   ///< Phase of the global LFO, in [0, 1).
+    float globalLfoValue{ 0.0f };                                   ///< The global LFO's value for the current sub-block.
+
+    /** The oscillator and envelope settings every voice shares. */
+    struct VoiceSettings {
+        int waveType{ 0 };
+        float fmDepth{ 0.0f };
+        float fmFrequency{ 0.0f };
+        int unisonVoices{ 1 };
+        float unisonDetune{ 0.0f };
+        float unisonSpread{ 0.0f };
+        float attack{ 0.1f };
+        float decay{ 0.1f };
+        float sustain{ 1.0f };
+        float release{ 0.4f };
+        AdsrData::Curve curve{ AdsrData::Curve::linear };
+        float silenceThreshold{ 0.0f };
+    };
+
+    VoiceSettings settings;                                         ///< The latest settings.
+    juce::uint32 settingsVersion{ 1 };                              ///< Bumped by every change to settings.
+    std::array<juce::uint32, maxPolyphony> voiceSettingsVersion{};  ///< The version each voice last applied; 0 for never.
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SynthEngine)
+};
\ No newline at end of file
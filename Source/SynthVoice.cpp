@@ -9,6 +9,7 @@
 */
 
 #include "SynthVoice.h"
+#include "SynthEngine.h"
 
 // Checks if this voice can play a given sound.
 bool SynthVoice::canPlaySound(juce::SynthesiserSound* sound) {
@@ -19,10 +20,38 @@ bool SynthVoice::canPlaySound(juce::SynthesiserSound* sound) {
 
 // Called when a MIDI note-on event is received.
 void SynthVoice::startNote(int midiNoteNumber, float velocity, juce::SynthesiserSound* sound, int currentPitchWheelPosition) {
-    // Sets the oscillator frequency based on the MIDI note number.
-    osc.setWaveFrequency(midiNoteNumber);
+    // Applies any oscillator and envelope changes made while this voice was free.
+    if (engine != nullptr)
+        engine->updateVoiceSettings(*this);
+
+    // Looks the pitch up in the engine's tuning table, and bends it by the wheel's current position.
+    const float frequency = engine != nullptr ? engine->getTuning().getFrequency(midiNoteNumber)
+                                              : (float) juce::MidiMessage::getMidiNoteInHertz(midiNoteNumber);
+    const float bend = getPitchBendRatio(currentPitchWheelPosition);
+
+    // Picks the render rate for this note before its frequency and envelope are set up, since both depend on it.
+    const int level = osc.chooseOversamplingLevel(frequency * bend, maxOversamplingLevel);
+
+    if (level != osc.getOversamplingLevel())
+        setOversamplingLevel(level);
+
+    // Sets the oscillator frequency for the note.
+    osc.setPitchBend(bend);
+    osc.setWaveFrequency(frequency);
+
+    // Starts the modulation afresh: the voice LFO from the top of its cycle, and the matrix evaluated on the first sample.
+    noteVelocity = velocity;
+    pitchWheel = (float) (currentPitchWheelPosition - 8192) / 8192.0f;
+    lfoPhase = 0.0f;
+    controlCountdown = 0;
+    osc.resetModulation();
+
     // Triggers the ADSR envelope's note-on event.
     adsr.noteOn();
+
+    // Lets the engine move this voice onto its held list.
+    if (engine != nullptr)
+        engine->voiceStarted(*this);
 }
 
 // Called when a MIDI note-off event is received.
@@ -32,47 +61,98 @@ void SynthVoice::stopNote(float velocity, bool allowTailOff) {
     // If tail-off is not allowed or the envelope has finished its release stage, clear the current note.
     if (!allowTailOff || !adsr.isActive()) {
         clearCurrentNote();
+
+        if (engine != nullptr)
+            engine->voiceStopped(*this);
+    }
+    else if (engine != nullptr) {
+        engine->voiceReleased(*this);
     }
 }
 
 // Called when a MIDI controller event is received.
 void SynthVoice::controllerMoved(int controllerNumber, int newControllerValue) {
-    // Here you would handle MIDI controller changes (e.g., mod wheel).
+    // The mod wheel only feeds the modulation matrix, which reads it at the next control point.
+    if (controllerNumber == 1)
+        modWheel = (float) newControllerValue / 127.0f;
 }
 
 // Called when the MIDI pitch wheel is moved.
 void SynthVoice::pitchWheelMoved(int newPitchWheelValue) {
-    // Here you would handle pitch wheel movements.
+    // The bend is a ratio of the tuned frequency, so microtunings bend the same way as equal temperament.
+    osc.setPitchBend(getPitchBendRatio(newPitchWheelValue));
+    pitchWheel = (float) (newPitchWheelValue - 8192) / 8192.0f;
+
+    if (engine != nullptr && isVoiceActive())
+        engine->voicePitchBent(*this);
+}
+
+// Maps the wheel onto +/- pitchBendRange semitones.
+float SynthVoice::getPitchBendRatio(int pitchWheelValue) {
+    return std::exp2((float) (pitchWheelValue - 8192) / 8192.0f * pitchBendRange / 12.0f);
+}
+
+// Clears the note without a release tail once the voice bank has finished rendering it.
+void SynthVoice::finishNote() {
+    adsr.reset();
+    clearCurrentNote();
+}
+
+// Stores the stereo position applied when the voice is mixed into the output.
+void SynthVoice::setPanGains(float left, float right) {
+    panLeft = left;
+    panRight = right;
+}
+
+// Records which engine and pool slot this voice belongs to.
+void SynthVoice::attachToEngine(SynthEngine& owner, int slot) {
+    engine = &owner;
+    poolSlot = slot;
 }
 
 // Prepares the voice for playback.
-void SynthVoice::prepareToPlay(double sampleRate, int samplesPerBlock, int outputChannels) {
-    // Sets the ADSR sample rate, which is essential for the envelope timing.
-    adsr.setSampleRate(sampleRate);
+void SynthVoice::prepareToPlay(double newSampleRate, int samplesPerBlock, int outputChannels) {
+    sampleRate = newSampleRate;
+
+    // Sets the ADSR sample rate, which is essential for the envelope timing. The envelope runs at the note's rate.
+    adsr.setSampleRate(sampleRate * (1 << osc.getOversamplingLevel()));
 
     // Initializes the DSP processing spec with the current playback context.
+    // The signal is the same on every channel, so the voice renders a single mono channel.
     juce::dsp::ProcessSpec spec;
     spec.maximumBlockSize = samplesPerBlock;
     spec.sampleRate = sampleRate;
-    spec.numChannels = outputChannels;
+    spec.numChannels = 1;
 
-    // Prepares the oscillator and gain DSP objects with the spec.
+    // Prepares the oscillator with the spec.
     osc.prepareToPlay(spec);
-    gain.prepare(spec);
-
-    // Sets an initial gain value.
-    gain.setGainLinear(0.3f);
 
     // Ensures that the voice is ready to process audio.
     isPrepared = true;
 }
 
+// Runs the oscillator and the envelope at a multiple of the sample rate, so segment lengths stay the same in seconds.
+void SynthVoice::setOversamplingLevel(int level) {
+    osc.setOversamplingLevel(level);
+    adsr.setSampleRate(sampleRate * (1 << level));
+}
+
 // Updates the parameters of the ADSR envelope.
 void SynthVoice::updateADSR(const float attack, const float decay, const float sustain, const float release) {
     // Passes the updated envelope parameters to the ADSR.
     adsr.updateADSR(attack, decay, sustain, release);
 }
 
+// Selects linear or exponential envelope segments.
+void SynthVoice::setEnvelopeCurve(AdsrData::Curve curve) {
+    adsr.setCurve(curve);
+}
+
+// Sets the level at which the release is treated as silent.
+void SynthVoice::setSilenceThreshold(float level) {
+    adsr.setSilenceThreshold(level);
+}
+
 // Renders the next block of audio samples.
 void SynthVoice::renderNextBlock(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples) {
     // Ensures the voice is prepared before generating audio.
@@ -82,29 +162,81 @@ void SynthVoice::renderNextBlock(juce::AudioBuffer<float>& outputBuffer, int sta
     if (!isVoiceActive())
         return;
 
-    // Resizes the temporary buffer and clears any previous content.
-    synthBuffer.setSize(outputBuffer.getNumChannels(), numSamples, false, false, true);
-    synthBuffer.clear();
+    // A mono output takes the voice unpanned; a stereo output takes it panned across both channels.
+    const bool stereo = outputBuffer.getNumChannels() > 1;
+    float* left = outputBuffer.getWritePointer(0, startSample);
+    float* right = stereo ? outputBuffer.getWritePointer(1, startSample) : nullptr;
+    const float leftGain = stereo ? gain * panLeft : gain;
+    const float rightGain = gain * panRight;
+
+    // Generates, applies the envelope and accumulates in one loop per envelope segment,
+    // so the voice never writes an intermediate buffer.
+    const auto render = [&](int offset, int length) {
+        adsr.processSegments(length, [&](AdsrData::Segment& segment, int start, int count) {
+            osc.renderAdding(left + offset + start, stereo ? right + offset + start : nullptr, leftGain, rightGain, segment, count);
+        });
+    };
+
+    // Without routes, and once the last modulation has ramped out, the block renders in one go.
+    // Otherwise it is cut at every control point, which keeps its place across blocks.
+    if ((engine == nullptr || !engine->getModMatrix().isActive()) && !osc.isModulated()) {
+        render(0, numSamples);
+    }
+    else {
+        const int interval = ModMatrix::controlInterval << osc.getOversamplingLevel();
+
+        for (int done = 0; done < numSamples && adsr.isActive();) {
+            if (controlCountdown == 0) {
+                updateModulation(interval, stereo);
+                controlCountdown = interval;
+            }
+
+            const int count = juce::jmin(numSamples - done, controlCountdown);
+            render(done, count);
+
+            controlCountdown -= count;
+            done += count;
+        }
+    }
 
-    // Wraps the buffer in an AudioBlock for processing by the DSP objects.
-    juce::dsp::AudioBlock<float> audioBlock{ synthBuffer };
+    // If the ADSR envelope has finished its release stage, or faded below the silence threshold, clear the current note.
+    // The engine returns the voice to its free list once the block has been rendered.
+    if (!adsr.isActive())
+        clearCurrentNote();
+}
 
-    // Generates the oscillator output for the current block.
-    osc.getNextAudioBlock(audioBlock);
+// Samples every source, sums the routes and turns the sums into the oscillator's ratios and levels.
+void SynthVoice::updateModulation(int rampSamples, bool stereo) {
+    const auto& matrix = engine->getModMatrix();
 
-    // Processes the generated audio through the gain stage.
-    gain.process(juce::dsp::ProcessContextReplacing<float>(audioBlock));
+    ModMatrix::SourceValues sources{};
+    sources[ModMatrix::voiceLfo] = ModMatrix::getLfoValue(matrix.getLfoShape(0), lfoPhase);
+    sources[ModMatrix::globalLfo] = engine->getGlobalLfoValue();
+    sources[ModMatrix::envelope] = adsr.getLevel();
+    sources[ModMatrix::velocity] = noteVelocity;
+    sources[ModMatrix::pitchWheel] = pitchWheel;
+    sources[ModMatrix::modWheel] = modWheel;
 
-    // Applies the ADSR envelope to the generated audio.
-    adsr.applyEnvelopeToBuffer(synthBuffer, 0, synthBuffer.getNumSamples());
+    // The LFO rate is in Hz, so it advances by the control period at the base rate whatever the note's rate.
+    lfoPhase = DspMath::wrapPhase(lfoPhase + (float) (matrix.getLfoRate(0) * ModMatrix::controlInterval / sampleRate));
 
-    // Adds the processed audio from the temporary buffer to the output buffer.
-    for (int channel = 0; channel < outputBuffer.getNumChannels(); ++channel) {
-        outputBuffer.addFrom(channel, startSample, synthBuffer, channel, 0, numSamples);
+    ModMatrix::TargetValues targets{};
+    matrix.evaluate(sources, targets);
 
-        // If the ADSR envelope has finished its release stage, clear the current note.
-        if (!adsr.isActive()) {
-            clearCurrentNote();
-        }
-    }
+    OscData::Modulation modulation;
+    modulation.pitchRatio = targets[ModMatrix::pitch] != 0.0f ? std::exp2(targets[ModMatrix::pitch] / 12.0f) : 1.0f;
+    modulation.fmDepth = targets[ModMatrix::fmDepth];
+    modulation.fmFrequencyRatio = targets[ModMatrix::fmFrequency] != 0.0f ? std::exp2(targets[ModMatrix::fmFrequency]) : 1.0f;
+
+    // The pan target is a balance on top of the voice's own position, and centred leaves it alone.
+    const float level = juce::jlimit(0.0f, 2.0f, 1.0f + targets[ModMatrix::amplitude]);
+    float balanceLeft = 1.0f, balanceRight = 1.0f;
+
+    if (stereo && targets[ModMatrix::pan] != 0.0f)
+        DspMath::panGains(targets[ModMatrix::pan], balanceLeft, balanceRight);
+
+    modulation.leftLevel = level * balanceLeft;
+    modulation.rightLevel = level * balanceRight;
+
+    osc.rampModulation(modulation, rampSamples);
 }
\ No newline at end of file
@@ -14,14 +14,23 @@
 #include "SynthSound.h"
 #include "Data/AdsrData.h"
 #include "Data/OscData.h"
+#include "Data/ModMatrix.h"
+
+class SynthEngine;
 
 /**
  * SynthVoice class extends juce::SynthesiserVoice, providing a concrete implementation of a voice
  * that can play a sound within a synthesiser. It manages note playing, ADSR envelope, and oscillator data.
+ *
+ * While the engine's modulation matrix has routes, the voice evaluates them once every
+ * ModMatrix::controlInterval samples and has the oscillator ramp to the result.
  */
 class SynthVoice : public juce::SynthesiserVoice {
 
 public:
+    /** How far the pitch wheel bends a note either way, in semitones. */
+    static constexpr float pitchBendRange = 2.0f;
+
     /**
      * Determines if this voice can play the given sound object.
      * @param sound Pointer to a juce::SynthesiserSound object.
@@ -46,15 +55,15 @@ public:
     void stopNote(float velocity, bool allowTailOff) override;
 
     /**
-     * Responds to MIDI controller movements.
+     * Responds to MIDI controller movements. The mod wheel is kept as a modulation source.
      * @param controllerNumber The number of the MIDI controller.
      * @param newControllerValue The new value for the MIDI controller.
      */
     void controllerMoved(int controllerNumber, int newControllerValue) override;
 
     /**
-     * Responds to pitch wheel movements.
-     * @param newPitchWheelValue The new position of the pitch wheel.
+     * Bends the note by up to pitchBendRange semitones either way, and keeps the wheel as a modulation source.
+     * @param newPitchWheelValue The new position of the pitch wheel, from 0 to 16383 with 8192 in the centre.
      */
     void pitchWheelMoved(int newPitchWheelValue) override;
 
@@ -62,7 +71,8 @@ public:
      * Prepares the voice for playback by initializing processing specifications.
      * @param sampleRate The audio sample rate.
      * @param samplesPerBlock The number of samples per block to be processed.
-     * @param outputChannels The number of output audio channels.
+     * @param outputChannels The number of output audio channels. The voice always renders in mono
+     *                       and pans the result across these when it is mixed into the output.
      */
     void prepareToPlay(double sampleRate, int samplesPerBlock, int outputChannels);
 
@@ -83,17 +93,103 @@ public:
      */
     void updateADSR(const float attack, const float decay, const float sustain, const float release);
 
+    /**
+     * Selects the shape of the envelope segments started from now on.
+     * @param curve Linear or exponential segments.
+     */
+    void setEnvelopeCurve(AdsrData::Curve curve);
+
+    /**
+     * Sets the envelope level below which a released note is cut off as silent.
+     * @param level The linear level, or 0 to always play the release to its end.
+     */
+    void setSilenceThreshold(float level);
+
+    /**
+     * Sets the highest oversampling level that notes started from now on may render at. Each
+     * note picks the lowest level its pitch and FM settings need, up to this limit.
+     * @param level The highest level, where level k renders at 2^k times the sample rate; 0 turns oversampling off.
+     */
+    void setMaxOversamplingLevel(int level) { maxOversamplingLevel = level; }
+
+    /**
+     * Returns the oversampling level of the current note. renderNextBlock() then expects a buffer
+     * at that rate and numSamples << level samples, from OversampledMix::getBus().
+     */
+    int getOversamplingLevel() const { return osc.getOversamplingLevel(); }
+
+    /**
+     * Sets the gains used to mix this voice's mono signal into the left and right channels.
+     * @param left The gain applied to the left channel.
+     * @param right The gain applied to the right channel.
+     */
+    void setPanGains(float left, float right);
+
+    /**
+     * Sets the mod wheel position a new note starts with, since the voice only sees the wheel move while it plays.
+     * @param position The position of controller 1 on the note's channel, from 0 to 1.
+     */
+    void setModWheel(float position) { modWheel = position; }
+
+    /**
+     * Ends the note immediately and resets the envelope. Used by the engine when the note
+     * was rendered by the voice bank and its release has finished there.
+     */
+    void finishNote();
+
+    /**
+     * Registers this voice with the engine that owns it, so the engine can track its state.
+     * @param owner The engine whose voice pool this voice belongs to.
+     * @param slot The index of this voice in the engine's pool.
+     */
+    void attachToEngine(SynthEngine& owner, int slot);
+
+    /**
+     * Returns the index of this voice in the engine's pool, or -1 if it has not been attached.
+     */
+    int getPoolSlot() const { return poolSlot; }
+
     /**
      * Provides access to this voice's oscillator data.
      * @return Reference to the OscData object representing the oscillator.
      */
     OscData& getOscillator() { return osc; }
 
+    /**
+     * Provides access to this voice's envelope, which runs at the note's oversampled rate.
+     * @return Reference to the AdsrData object shaping the note.
+     */
+    AdsrData& getEnvelope() { return adsr; }
+
 private:
+    /** Converts a pitch wheel position into a frequency ratio. */
+    static float getPitchBendRatio(int pitchWheelValue);
+
+    /** Moves the oscillator and the envelope to 2^level times the sample rate. */
+    void setOversamplingLevel(int level);
+
+    /**
+     * Reads the modulation sources, advances the voice LFO by one control period and starts the
+     * oscillator's ramp to the new targets.
+     * @param rampSamples The length of the control period at the note's rate.
+     * @param stereo Whether the output has two channels; a mono output ignores the pan target.
+     */
+    void updateModulation(int rampSamples, bool stereo);
+
     AdsrData adsr;                           ///< Manages ADSR envelope for this voice.
-    juce::AudioBuffer<float> synthBuffer;    ///< Buffer used for synthesising audio within this voice.
     OscData osc;                             ///< Oscillator data handling waveforms and pitch modulation.
-    juce::dsp::Gain<float> gain;             ///< Gain processor for adjusting output levels.
+    float gain{ 0.3f };                      ///< Output level of the voice, folded into the pan gains when rendering.
     bool isPrepared{ false };                ///< Flag to check if the voice has been prepared before playing.
+    SynthEngine* engine{ nullptr };          ///< The engine that owns this voice, notified of note starts and stops.
+    int poolSlot{ -1 };                      ///< Index of this voice in the engine's pool.
+    float panLeft{ 1.0f };                   ///< Gain of the left channel when mixing into the output.
+    float panRight{ 1.0f };                  ///< Gain of the right channel when mixing into the output.
+    double sampleRate{ 44100.0 };            ///< The prepared sample rate, before oversampling.
+    int maxOversamplingLevel{ 0 };           ///< Highest oversampling level a new note may choose.
+    float noteVelocity{ 0.0f };              ///< Velocity of the current note, as a modulation source.
+    float pitchWheel{ 0.0f };                ///< Pitch wheel position from -1 to 1, as a modulation source.
+    float modWheel{ 0.0f };                  ///< Mod wheel position from 0 to 1, as a modulation source.
+    float lfoPhase{ 0.0f };                  ///< Phase of the voice LFO, in [0, 1).
+    int controlCountdown{ 0 };               ///< Samples left until the modulation is evaluated again.
 
 };
\ No newline at end of file
@@ -0,0 +1,117 @@
+/*
+  ==============================================================================
+
+    TuningLoader.cpp
+    Reads Scala tunings away from the audio thread and hands the finished
+    tables to it through an atomic pointer.
+
+  ==============================================================================
+*/
+
+#include "TuningLoader.h"
+
+TuningLoader::TuningLoader() : juce::Thread("Tuning Loader"), equalTemperament(TuningTable::createEqualTemperament()) {
+    startThread(juce::Thread::Priority::background);
+}
+
+TuningLoader::~TuningLoader() {
+    stopThread(1000);
+
+    // Audio has stopped by now, so every table can be freed here.
+    delete pending.exchange(nullptr);
+
+    for (auto& slot : retired)
+        delete slot.exchange(nullptr);
+}
+
+bool TuningLoader::loadNow(const juce::File& scaleFile, const juce::File& keyboardMappingFile, juce::String& error) {
+    auto table = TuningTable::fromFiles(scaleFile, keyboardMappingFile, error);
+
+    if (table == nullptr)
+        return false;
+
+    publish(std::move(table));
+    return true;
+}
+
+void TuningLoader::loadAsync(const juce::File& scaleFile, const juce::File& keyboardMappingFile) {
+    {
+        const juce::ScopedLock sl(requestLock);
+        requestedScale = scaleFile;
+        requestedKeyboardMapping = keyboardMappingFile;
+        hasRequest = true;
+    }
+
+    notify();
+}
+
+void TuningLoader::reset() {
+    publish(TuningTable::createEqualTemperament());
+}
+
+juce::String TuningLoader::getLastError() const {
+    const juce::ScopedLock sl(requestLock);
+    return lastError;
+}
+
+//==============================================================================
+const TuningTable* TuningLoader::poll() noexcept {
+    return pending.exchange(nullptr, std::memory_order_acq_rel);
+}
+
+void TuningLoader::retire(const TuningTable* table) noexcept {
+    if (table == equalTemperament.get())
+        return;
+
+    for (auto& slot : retired) {
+        const TuningTable* expected = nullptr;
+
+        if (slot.compare_exchange_strong(expected, table, std::memory_order_release))
+            return;
+    }
+
+    // Every table the audio thread takes comes from a publish(), which empties the slots first,
+    // so they can only fill up if it retires tables it never took.
+    jassertfalse;
+}
+
+//==============================================================================
+void TuningLoader::run() {
+    while (!threadShouldExit()) {
+        juce::File scaleFile, keyboardMappingFile;
+        bool hasFiles = false;
+
+        {
+            const juce::ScopedLock sl(requestLock);
+            std::swap(hasFiles, hasRequest);
+            scaleFile = requestedScale;
+            keyboardMappingFile = requestedKeyboardMapping;
+        }
+
+        if (hasFiles) {
+            juce::String error;
+            auto table = TuningTable::fromFiles(scaleFile, keyboardMappingFile, error);
+
+            {
+                const juce::ScopedLock sl(requestLock);
+                lastError = error;
+            }
+
+            if (table != nullptr)
+                publish(std::move(table));
+        }
+
+        // Loads are rare, so sleep until the next one is requested.
+        wait(-1);
+    }
+}
+
+void TuningLoader::publish(std::unique_ptr<TuningTable> table) {
+    const juce::ScopedLock sl(publishLock);
+
+    for (auto& slot : retired)
+        delete slot.exchange(nullptr, std::memory_order_acquire);
+
+    // A table the audio thread never took is freed here.
+    delete pending.exchange(table.release(), std::memory_order_acq_rel);
+}
\ No newline at end of file
@@ -0,0 +1,101 @@
+/*
+  ==============================================================================
+
+    TuningLoader.h
+    Reads Scala tunings away from the audio thread and hands the finished
+    tables to it through an atomic pointer.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include "Data/TuningTable.h"
+
+/**
+ * TuningLoader builds TuningTables from Scala files and moves them to the audio thread without
+ * the audio thread ever locking, allocating or freeing, in the same way PatchLoader moves patches:
+ *
+ * 1. The files are read and the table is built, either on the calling thread (loadNow) or on
+ *    the loader's background thread (loadAsync).
+ * 2. The table is published by swapping it into an atomic pointer. A table that the audio
+ *    thread has not picked up yet is simply replaced and freed.
+ * 3. The audio thread takes the pointer in poll() and hands back the table it replaces with
+ *    retire(). Retired tables are freed by the next load, or when the loader is destroyed.
+ *
+ * The equal-tempered table is owned by the loader and used until the first tuning arrives.
+ * The owner retires the table it is using before the loader is destroyed, so that it is freed too.
+ */
+class TuningLoader : private juce::Thread {
+
+public:
+    /** Builds the equal-tempered table and starts the background thread. */
+    TuningLoader();
+
+    /** Stops the background thread and frees every table still held. */
+    ~TuningLoader() override;
+
+    /** Returns the table of twelve-tone equal temperament, which lives as long as the loader. */
+    const TuningTable& getEqualTemperament() const noexcept { return *equalTemperament; }
+
+    /**
+     * Reads a tuning on the calling thread and publishes it. Must not be called from the audio thread.
+     * @param scaleFile The .scl file.
+     * @param keyboardMappingFile The .kbm file, or a default File for the default mapping.
+     * @param error Receives a description of the problem on failure.
+     * @return False if a file cannot be read or is not valid.
+     */
+    bool loadNow(const juce::File& scaleFile, const juce::File& keyboardMappingFile, juce::String& error);
+
+    /**
+     * Lets the background thread read a tuning and publish it. Must not be called from the audio
+     * thread. A request that has not been read yet is replaced; failures are reported by getLastError().
+     * @param scaleFile The .scl file.
+     * @param keyboardMappingFile The .kbm file, or a default File for the default mapping.
+     */
+    void loadAsync(const juce::File& scaleFile, const juce::File& keyboardMappingFile);
+
+    /** Publishes a fresh equal-tempered table. Must not be called from the audio thread. */
+    void reset();
+
+    /** Returns the error of the last load that failed on the background thread, or an empty string. */
+    juce::String getLastError() const;
+
+    /**
+     * Called by the audio thread at the start of every block.
+     * @return A newly published table that the audio thread now owns until it passes it to
+     *         retire(), or nullptr.
+     */
+    const TuningTable* poll() noexcept;
+
+    /**
+     * Hands back a table that the audio thread no longer uses. Audio thread only. The
+     * equal-tempered table may be passed too; it is never freed.
+     * @param table The table, which the caller must not use afterwards.
+     */
+    void retire(const TuningTable* table) noexcept;
+
+private:
+    void run() override;
+
+    /** Frees the retired tables, then publishes a new one. */
+    void publish(std::unique_ptr<TuningTable> table);
+
+    static constexpr int maxRetired = 4;             ///< Tables the audio thread can hand back between loads.
+
+    std::unique_ptr<TuningTable> equalTemperament;   ///< The default tuning, never published or freed.
+
+    juce::CriticalSection requestLock;               ///< Guards the request and the error; never taken by the audio thread.
+    juce::File requestedScale;                       ///< The files waiting for the background thread.
+    juce::File requestedKeyboardMapping;
+    bool hasRequest{ false };
+    juce::String lastError;
+    juce::CriticalSection publishLock;               ///< Serialises publish() between callers; never taken by the audio thread.
+
+    std::atomic<TuningTable*> pending{ nullptr };    ///< Built table not yet taken by the audio thread.
+    std::array<std::atomic<const TuningTable*>, maxRetired> retired{}; ///< Tables handed back by the audio thread.
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TuningLoader)
+};
\ No newline at end of file
@@ -21,18 +21,25 @@
 AdsrComponent::AdsrComponent(juce::AudioProcessorValueTreeState& apvts)
 {
     // Each slider is attached to a corresponding parameter in the audio processor value tree state.
-    using SliderAttachment = juce::AudioProcessorValueTreeState::SliderAttachment;
-
     attackAttachment = std::make_unique<SliderAttachment>(apvts, "ATTACK", attackSlider);
     decayAttachment = std::make_unique<SliderAttachment>(apvts, "DECAY", decaySlider);
     sustainAttachment = std::make_unique<SliderAttachment>(apvts, "SUSTAIN", sustainSlider);
     releaseAttachment = std::make_unique<SliderAttachment>(apvts, "RELEASE", releaseSlider);
 
+    // Name each slider after its parameter, so the editor can offer MIDI learn for it.
+    attackSlider.setComponentID("ATTACK");
+    decaySlider.setComponentID("DECAY");
+    sustainSlider.setComponentID("SUSTAIN");
+    releaseSlider.setComponentID("RELEASE");
+
     // Initialize slider parameters for each ADSR component.
     setSliderParams(attackSlider);
     setSliderParams(decaySlider);
     setSliderParams(sustainSlider);
     setSliderParams(releaseSlider);
+
+    // The background covers every pixel, so nothing behind the component needs painting.
+    setOpaque(true);
 }
 
 AdsrComponent::~AdsrComponent()
@@ -43,28 +50,31 @@ AdsrComponent::~AdsrComponent()
 /**
  * Paints the component.
  *
- * @param g Graphics context used to draw the component. In this case, the background is filled black.
+ * @param g Graphics context used to draw the component. The background and the slider titles come
+ *          from the layer cache, so a slider repaint only copies the pixels behind the slider.
  */
 void AdsrComponent::paint(juce::Graphics& g)
 {
-    g.fillAll(juce::Colours::black);  // Sets the background color of the ADSR component to black.
-
-    ////////////////////////////////////////////////
-    // Set the colour and font for the text.
-    g.setColour(juce::Colours::white);
-    g.setFont(15.0f);
-
-    // Calculate the width of the area where the sliders are located.
-    int slidersAreaWidth = getWidth();
-    int textPositionY = 5; // Decrease this value to move the text up
-    int textHeight = 20;   // The height for the text area
-
-    // Create a rectangle that spans the width of the sliders area and is positioned at the top.
-    juce::Rectangle<int> textArea(0, textPositionY, slidersAreaWidth, textHeight);
-
-    // Draw the text within the rectangle, centered horizontally and vertically.
-    g.drawFittedText("Attack         Decay         Sustain         Release", textArea, juce::Justification::centred, 1);
-
+    backgroundLayer.draw(g, getLocalBounds(), [this](juce::Graphics& layer)
+    {
+        layer.fillAll(juce::Colours::black);  // Sets the background color of the ADSR component to black.
+
+        ////////////////////////////////////////////////
+        // Set the colour and font for the text.
+        layer.setColour(juce::Colours::white);
+        layer.setFont(15.0f);
+
+        // Calculate the width of the area where the sliders are located.
+        int slidersAreaWidth = getWidth();
+        int textPositionY = 5; // Decrease this value to move the text up
+        int textHeight = 20;   // The height for the text area
+
+        // Create a rectangle that spans the width of the sliders area and is positioned at the top.
+        juce::Rectangle<int> textArea(0, textPositionY, slidersAreaWidth, textHeight);
+
+        // Draw the text within the rectangle, centered horizontally and vertically.
+        layer.drawFittedText("Attack         Decay         Sustain         Release", textArea, juce::Justification::centred, 1);
+    });
 }
 
 /**
@@ -72,6 +82,9 @@ void AdsrComponent::paint(juce::Graphics& g)
  */
 void AdsrComponent::resized()
 {
+    // The titles are laid out across the whole width, so they are drawn again at the new size.
+    backgroundLayer.invalidate();
+
     // Defines the local bounds and padding for layout calculation.
     const auto bounds = getLocalBounds().reduced(10);
     const auto padding = 10;
@@ -87,6 +100,17 @@ void AdsrComponent::resized()
     releaseSlider.setBounds(sustainSlider.getRight() + padding, sliderStartY, sliderWidth, sliderHeight);
 }
 
+/**
+ * Moves each slider to its parameter if the host changed it since the last frame.
+ */
+void AdsrComponent::refresh()
+{
+    attackAttachment->refresh();
+    decayAttachment->refresh();
+    sustainAttachment->refresh();
+    releaseAttachment->refresh();
+}
+
 /**
  * Configures the properties of a slider.
  *
@@ -11,6 +11,8 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "FrameSliderAttachment.h"
+#include "LayerCache.h"
 
 //==============================================================================
 /**
@@ -48,6 +50,12 @@ public:
      */
     void resized() override;
 
+    /**
+     * Moves the sliders to changes of the host-visible parameters since the last frame. Learned MIDI
+     * controllers do not set those, so they are not shown. Called by the editor's frame timer.
+     */
+    void refresh();
+
 private:
     /**
      * Helper method to set parameters for a slider.
@@ -64,12 +72,15 @@ private:
     juce::Slider releaseSlider;
 
     // Attachments that link the sliders to the audio parameters in the value tree state.
-    using SliderAttachment = juce::AudioProcessorValueTreeState::SliderAttachment;
+    using SliderAttachment = FrameSliderAttachment;
     std::unique_ptr<SliderAttachment> attackAttachment;
     std::unique_ptr<SliderAttachment> decayAttachment;
     std::unique_ptr<SliderAttachment> sustainAttachment;
     std::unique_ptr<SliderAttachment> releaseAttachment;
 
+    // The background and the slider titles, drawn once per size and scale.
+    LayerCache backgroundLayer;
+
     // Macro for helping identify memory leaks during debugging.
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AdsrComponent)
 };
@@ -0,0 +1,81 @@
+/*
+  ==============================================================================
+
+    FrameSliderAttachment.cpp
+    Connects a slider to a parameter, following the parameter once per
+    editor frame instead of on every change.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "FrameSliderAttachment.h"
+
+//==============================================================================
+/**
+ * Constructs the attachment. The parameter must exist in the state.
+ *
+ * @param apvts The state that holds the parameter.
+ * @param parameterID The ID of the parameter.
+ * @param attachedSlider The slider, which must outlive the attachment.
+ */
+FrameSliderAttachment::FrameSliderAttachment(juce::AudioProcessorValueTreeState& apvts, const juce::String& parameterID, juce::Slider& attachedSlider)
+    : parameter(*apvts.getParameter(parameterID)), slider(attachedSlider)
+{
+    const auto& range = parameter.getNormalisableRange();
+
+    slider.setNormalisableRange({ (double) range.start, (double) range.end, (double) range.interval, (double) range.skew, range.symmetricSkew });
+    slider.textFromValueFunction = [this](double value) { return parameter.getText(parameter.convertTo0to1((float) value), 0); };
+    slider.valueFromTextFunction = [this](const juce::String& text) { return (double) parameter.convertFrom0to1(parameter.getValueForText(text)); };
+    slider.setDoubleClickReturnValue(true, (double) parameter.convertFrom0to1(parameter.getDefaultValue()));
+
+    shownValue = parameter.getValue();
+    slider.setValue((double) parameter.convertFrom0to1(shownValue), juce::dontSendNotification);
+    slider.addListener(this);
+}
+
+FrameSliderAttachment::~FrameSliderAttachment()
+{
+    slider.removeListener(this);
+}
+
+void FrameSliderAttachment::refresh()
+{
+    const float value = parameter.getValue();
+
+    if (value == shownValue)
+        return;
+
+    shownValue = value;
+    slider.setValue((double) parameter.convertFrom0to1(value), juce::dontSendNotification);
+}
+
+/**
+ * Sets the parameter from the slider. A change that is not part of a drag, such as typing a
+ * value or a double-click, is sent to the host as a gesture of its own.
+ */
+void FrameSliderAttachment::sliderValueChanged(juce::Slider*)
+{
+    const float value = parameter.convertTo0to1((float) slider.getValue());
+
+    if (slider.isMouseButtonDown()) {
+        parameter.setValueNotifyingHost(value);
+    }
+    else {
+        parameter.beginChangeGesture();
+        parameter.setValueNotifyingHost(value);
+        parameter.endChangeGesture();
+    }
+
+    shownValue = parameter.getValue();
+}
+
+void FrameSliderAttachment::sliderDragStarted(juce::Slider*)
+{
+    parameter.beginChangeGesture();
+}
+
+void FrameSliderAttachment::sliderDragEnded(juce::Slider*)
+{
+    parameter.endChangeGesture();
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+/*
+  ==============================================================================
+
+    FrameSliderAttachment.h
+    Connects a slider to a parameter, following the parameter once per
+    editor frame instead of on every change.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+ * FrameSliderAttachment does the job of AudioProcessorValueTreeState::SliderAttachment, except that
+ * it never listens to the parameter. Moving the slider sets the parameter straight away, but
+ * changes from the host, such as automation or a new patch, only reach the slider when the editor
+ * calls refresh() on its frame timer. However fast the parameter moves, its slider then repaints
+ * at most once per frame, and not at all while the parameter stands still.
+ *
+ * The slider shows the host-visible parameter. Learned MIDI controllers move the sound on the
+ * audio thread without setting the parameter, so the slider does not follow them.
+ */
+class FrameSliderAttachment : private juce::Slider::Listener
+{
+public:
+    /**
+     * Sets the slider's range, text conversion and default from the parameter and shows its value.
+     *
+     * @param apvts The state that holds the parameter.
+     * @param parameterID The ID of the parameter.
+     * @param slider The slider, which must outlive the attachment.
+     */
+    FrameSliderAttachment(juce::AudioProcessorValueTreeState& apvts, const juce::String& parameterID, juce::Slider& slider);
+
+    /**
+     * Stops listening to the slider.
+     */
+    ~FrameSliderAttachment() override;
+
+    /**
+     * Moves the slider to the parameter's value if it changed since the last frame. Message thread only.
+     */
+    void refresh();
+
+private:
+    void sliderValueChanged(juce::Slider*) override;
+    void sliderDragStarted(juce::Slider*) override;
+    void sliderDragEnded(juce::Slider*) override;
+
+    juce::RangedAudioParameter& parameter;
+    juce::Slider& slider;
+    float shownValue{ 0.0f };  // The normalised value the slider shows.
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FrameSliderAttachment)
+};
\ No newline at end of file
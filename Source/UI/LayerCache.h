@@ -0,0 +1,57 @@
+/*
+  ==============================================================================
+
+    LayerCache.h
+    Keeps a component's static artwork in an image, so repaints blit it
+    instead of drawing it again.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+ * LayerCache holds one opaque layer of a component, such as its background, frame and labels,
+ * rendered at the display's physical resolution. The first paint after invalidate(), or after the
+ * window moves to a display with a different scale, draws the layer into the image; every other
+ * paint only copies the part of the image inside the clip region, so repainting a slider costs a
+ * blit of the slider's bounds.
+ */
+class LayerCache
+{
+public:
+    /** Drops the image, so the next paint draws the layer again. Call it whenever the artwork changes, such as on resize. */
+    void invalidate() { image = juce::Image(); }
+
+    /**
+     * Draws the layer from the image, first rendering it if it is missing or was made for another scale.
+     *
+     * @param g The graphics context of the component's paint().
+     * @param area Where the layer goes, in the component's coordinates.
+     * @param paintLayer Draws the layer at the origin, filling every pixel of the area's size.
+     */
+    template <typename PaintFunction>
+    void draw(juce::Graphics& g, juce::Rectangle<int> area, PaintFunction&& paintLayer)
+    {
+        const float scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+
+        if (!image.isValid() || scale != imageScale) {
+            image = juce::Image(juce::Image::RGB, juce::jmax(1, juce::roundToInt((float) area.getWidth() * scale)),
+                                juce::jmax(1, juce::roundToInt((float) area.getHeight() * scale)), true);
+            imageScale = scale;
+
+            juce::Graphics layer(image);
+            layer.addTransform(juce::AffineTransform::scale(scale));
+            paintLayer(layer);
+        }
+
+        g.drawImageTransformed(image, juce::AffineTransform::scale(1.0f / imageScale).translated((float) area.getX(), (float) area.getY()));
+    }
+
+private:
+    juce::Image image;        // The rendered layer, or invalid until the next paint.
+    float imageScale{ 1.0f }; // Physical pixels per logical pixel that the image was rendered at.
+};
\ No newline at end of file
@@ -29,10 +29,13 @@ OscComponent::OscComponent(juce::AudioProcessorValueTreeState& apvts, juce::Stri
 
     // Attach the combo box to its corresponding parameter in the value tree.
     oscWaveSelectorAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(apvts, waveSelectorId, oscWaveSelector);
+    oscWaveSelector.setComponentID(waveSelectorId);  // Name the selector after its parameter, for MIDI learn.
 
     // Initialize sliders and labels for frequency modulation settings.
     setSliderWithLabel(fmFreqSlider, fmFreqLabel, apvts, fmFreqId, fmFreqAttachment);
     setSliderWithLabel(fmDepthSlider, fmDepthLabel, apvts, fmDepthId, fmDepthAttachment);
+
+    setOpaque(true);  // The background covers every pixel, so nothing behind the component needs painting.
 }
 
 OscComponent::~OscComponent()
@@ -42,14 +45,19 @@ OscComponent::~OscComponent()
 
 void OscComponent::paint(juce::Graphics& g)
 {
-    // Paints the background and draws a rectangle around the component.
-    g.fillAll(juce::Colours::black); // Fill background with black.
-    g.setColour(juce::Colours::white); // Set drawing color to white.
-    g.drawRect(getLocalBounds(), 1); // Draw a white border around the component.
+    // Paints the background and draws a rectangle around the component, from the layer cache.
+    backgroundLayer.draw(g, getLocalBounds(), [this](juce::Graphics& layer)
+    {
+        layer.fillAll(juce::Colours::black); // Fill background with black.
+        layer.setColour(juce::Colours::white); // Set drawing color to white.
+        layer.drawRect(getLocalBounds(), 1); // Draw a white border around the component.
+    });
 }
 
 void OscComponent::resized()
 {
+    backgroundLayer.invalidate();  // The border follows the size, so it is drawn again.
+
     // Layout child components based on the current size of this component.
     const int sliderPosY = 80;
     const int sliderWidth = 100;
@@ -65,6 +73,13 @@ void OscComponent::resized()
     fmDepthLabel.setBounds(fmDepthSlider.getX(), fmDepthSlider.getY() - labelYOffset, fmDepthSlider.getWidth(), labelHeight);  // Position the label above the slider.
 }
 
+void OscComponent::refresh()
+{
+    // Follows changes from the host, at most once per frame.
+    fmFreqAttachment->refresh();
+    fmDepthAttachment->refresh();
+}
+
 /**
  * Initializes a slider and its accompanying label, attaching it to a parameter in the value tree.
  *
@@ -82,7 +97,8 @@ void OscComponent::setSliderWithLabel(juce::Slider& slider, juce::Label& label,
     addAndMakeVisible(slider);  // Make the slider visible and interactable.
 
     // Create a new attachment for the slider, linking it to the specified parameter.
-    attachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(apvts, paramId, slider);
+    attachment = std::make_unique<Attachment>(apvts, paramId, slider);
+    slider.setComponentID(paramId);  // Name the slider after its parameter, for MIDI learn.
 
     label.setColour(juce::Label::ColourIds::textColourId, juce::Colours::white);  // Set label text color to white.
     label.setFont(15.0f);  // Set font size for the label.
@@ -11,6 +11,8 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "FrameSliderAttachment.h"
+#include "LayerCache.h"
 
 //==============================================================================
 /**
@@ -49,6 +51,12 @@ public:
      */
     void resized() override;
 
+    /**
+     * Moves the sliders to changes of the host-visible parameters since the last frame. Learned MIDI
+     * controllers do not set those, so they are not shown. Called by the editor's frame timer.
+     */
+    void refresh();
+
 private:
     /**
      * Helper method to configure a slider and its associated label for the UI.
@@ -68,7 +76,7 @@ private:
     juce::Slider fmFreqSlider; // Label for the FM frequency slider.
     juce::Slider fmDepthSlider; // Label for the FM depth slider.
 
-    using Attachment = juce::AudioProcessorValueTreeState::SliderAttachment;
+    using Attachment = FrameSliderAttachment;
 
     std::unique_ptr<Attachment> fmFreqAttachment;
     std::unique_ptr<Attachment> fmDepthAttachment;
@@ -77,6 +85,9 @@ private:
     juce::Label fmFreqLabel{"FM Frequency", "FM Frequency"};
     juce::Label fmDepthLabel{"FM Depth", "FM Depth"};
 
+    // The background and border, drawn once per size and scale.
+    LayerCache backgroundLayer;
+
     void setSliderWithLabel(juce::Slider& slider, juce::Label& label, juce::AudioProcessorValueTreeState& apvts,
         juce::String paramId, std::unique_ptr<Attachment>& attachment);
 
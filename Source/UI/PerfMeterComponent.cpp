@@ -0,0 +1,98 @@
+/*
+  ==============================================================================
+
+    PerfMeterComponent.cpp
+    Shows the DSP load, the overruns and the voice count of the audio thread,
+    and saves its recent timings as a trace.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "PerfMeterComponent.h"
+
+//==============================================================================
+/**
+ * Constructs the meter. It is opaque, so the editor never paints behind it.
+ *
+ * @param monitor The monitor to show, which must outlive the meter.
+ */
+PerfMeterComponent::PerfMeterComponent(const PerfMonitor& monitor)
+    : perfMonitor(monitor)
+{
+    setOpaque(true);
+}
+
+PerfMeterComponent::~PerfMeterComponent()
+{
+}
+
+void PerfMeterComponent::paint(juce::Graphics& g)
+{
+    g.fillAll(juce::Colours::black);
+
+    // The bar fills the left third, turning red once the peak gets close to the deadline.
+    auto bounds = getLocalBounds().reduced(2);
+    auto bar = bounds.removeFromLeft(bounds.getWidth() / 3).toFloat();
+    const float width = bar.getWidth();
+
+    g.setColour(juce::Colours::darkgrey);
+    g.fillRect(bar);
+    g.setColour(peakPercent >= 90 ? juce::Colours::red : juce::Colours::limegreen);
+    g.fillRect(bar.withWidth(width * juce::jmin(1.0f, loadPercent / 100.0f)));
+    g.setColour(juce::Colours::white);
+    g.fillRect(bar.getX() + width * juce::jmin(1.0f, peakPercent / 100.0f) - 1.0f, bar.getY(), 2.0f, bar.getHeight());
+
+    g.drawText("DSP " + juce::String(loadPercent) + "%  peak " + juce::String(peakPercent) + "%  xruns "
+                   + juce::String(numOverruns) + "  voices " + juce::String(numVoices),
+               bounds.withTrimmedLeft(6), juce::Justification::centredLeft, true);
+}
+
+void PerfMeterComponent::mouseDown(const juce::MouseEvent& event)
+{
+    if (!event.mods.isPopupMenu())
+        return;
+
+    juce::PopupMenu menu;
+    menu.addItem("Save Performance Trace...", [this] { saveTrace(); });
+    menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(this));
+}
+
+/**
+ * Reads the monitor. Most frames change nothing the meter shows, so they cost no repaint.
+ */
+void PerfMeterComponent::refresh()
+{
+    const int newLoad = juce::roundToInt(perfMonitor.getLoad() * 100.0f);
+    const int newPeak = juce::roundToInt(perfMonitor.getPeakLoad() * 100.0f);
+    const int newOverruns = perfMonitor.getNumOverruns();
+    const int newVoices = perfMonitor.getNumVoices();
+
+    if (newLoad == loadPercent && newPeak == peakPercent && newOverruns == numOverruns && newVoices == numVoices)
+        return;
+
+    loadPercent = newLoad;
+    peakPercent = newPeak;
+    numOverruns = newOverruns;
+    numVoices = newVoices;
+    repaint();
+}
+
+/**
+ * Asks where to save the trace, then writes the events the monitor holds at that moment.
+ */
+void PerfMeterComponent::saveTrace()
+{
+    traceChooser = std::make_unique<juce::FileChooser>("Save Performance Trace",
+        juce::File::getSpecialLocation(juce::File::userDocumentsDirectory).getChildFile("SynthTrace.json"), "*.json");
+
+    traceChooser->launchAsync(juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::warnAboutOverwriting,
+        [this](const juce::FileChooser& chooser)
+        {
+            const auto file = chooser.getResult();
+
+            if (file != juce::File() && !perfMonitor.writeChromeTrace(file))
+                juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::WarningIcon, "Save Performance Trace",
+                                                       "Could not write " + file.getFullPathName());
+        });
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+/*
+  ==============================================================================
+
+    PerfMeterComponent.h
+    Shows the DSP load, the overruns and the voice count of the audio thread,
+    and saves its recent timings as a trace.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../PerfMonitor.h"
+
+//==============================================================================
+/**
+ * PerfMeterComponent is a one-line meter of the processor's PerfMonitor: a bar for the smoothed
+ * DSP load with a mark at the recent peak, then the load, the peak, the overruns and the voices
+ * as text. It reads the monitor's atomics once per editor frame and only repaints when what it shows changes.
+ *
+ * Right-clicking it offers to save the monitor's recent events as a Chrome trace, which shows
+ * every block and its stages on a timeline in chrome://tracing or Perfetto.
+ */
+class PerfMeterComponent : public juce::Component
+{
+public:
+    /**
+     * Constructs the meter.
+     *
+     * @param monitor The monitor to show, which must outlive the meter.
+     */
+    explicit PerfMeterComponent(const PerfMonitor& monitor);
+
+    /**
+     * Destructor for PerfMeterComponent.
+     */
+    ~PerfMeterComponent() override;
+
+    /**
+     * Paints the load bar and the figures.
+     *
+     * @param g Graphics context used to draw the meter.
+     */
+    void paint(juce::Graphics& g) override;
+
+    /**
+     * Opens the menu that saves a trace when the meter is right-clicked.
+     *
+     * @param event The mouse event.
+     */
+    void mouseDown(const juce::MouseEvent& event) override;
+
+    /**
+     * Reads the monitor and repaints if any of the figures changed. Called by the editor's frame timer.
+     */
+    void refresh();
+
+private:
+    /** Asks for a file and writes the trace to it. */
+    void saveTrace();
+
+    const PerfMonitor& perfMonitor;
+
+    // The figures as last painted, in whole percent for the loads.
+    int loadPercent{ 0 };
+    int peakPercent{ 0 };
+    int numOverruns{ 0 };
+    int numVoices{ 0 };
+
+    std::unique_ptr<juce::FileChooser> traceChooser;  // Kept alive while the save dialog is open.
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PerfMeterComponent)
+};
\ No newline at end of file
@@ -0,0 +1,202 @@
+/*
+  ==============================================================================
+
+    ScopeComponent.cpp
+    An oscilloscope and a spectrum of the plugin's output, read from the
+    processor's ScopeFeed.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "ScopeComponent.h"
+
+//==============================================================================
+/**
+ * Constructs the display and turns the feed on.
+ *
+ * @param feed The processor's feed, which must outlive the display.
+ */
+ScopeComponent::ScopeComponent(ScopeFeed& feed)
+    : scopeFeed(feed)
+{
+    setOpaque(true);
+    scopeFeed.setEnabled(true);
+}
+
+ScopeComponent::~ScopeComponent()
+{
+    scopeFeed.setEnabled(false);
+}
+
+void ScopeComponent::paint(juce::Graphics& g)
+{
+    backgroundLayer.draw(g, getLocalBounds(), [this](juce::Graphics& layer) { drawBackground(layer); });
+
+    g.setColour(juce::Colours::limegreen);
+    g.strokePath(scopePath, juce::PathStrokeType(1.5f));
+
+    g.setColour(juce::Colours::orange);
+    g.strokePath(spectrumPath, juce::PathStrokeType(1.5f));
+}
+
+void ScopeComponent::resized()
+{
+    auto bounds = getLocalBounds();
+    scopeArea = bounds.removeFromLeft(bounds.getWidth() / 2).reduced(4);
+    spectrumArea = bounds.reduced(4);
+
+    spectrumLevels.assign((size_t) juce::jmax(0, spectrumArea.getWidth()), minDecibels);
+
+    backgroundLayer.invalidate();
+    updatePaths();
+}
+
+/**
+ * Reads everything the audio thread has written since the last frame. Once the history is
+ * nothing but silence and the spectrum has fallen to the floor, frames stop costing a repaint.
+ */
+void ScopeComponent::refresh()
+{
+    // The frequency grid depends on the rate, which changes if the host prepares the plugin again.
+    if (scopeFeed.getSampleRate() != gridSampleRate) {
+        gridSampleRate = scopeFeed.getSampleRate();
+        backgroundLayer.invalidate();
+        repaint();
+    }
+
+    int numNewSamples = 0;
+    float peak = 0.0f;
+
+    for (;;) {
+        const int numPulled = scopeFeed.pull(history.data() + historyPosition, fftSize - historyPosition);
+
+        if (numPulled == 0)
+            break;
+
+        for (int i = historyPosition; i < historyPosition + numPulled; ++i)
+            peak = juce::jmax(peak, std::abs(history[(size_t) i]));
+
+        historyPosition = (historyPosition + numPulled) & (fftSize - 1);
+        numNewSamples += numPulled;
+    }
+
+    const bool wasSilent = numSilentSamples >= fftSize;
+
+    if (numNewSamples > 0)
+        numSilentSamples = peak > 0.0f ? 0 : juce::jmin(numSilentSamples + numNewSamples, fftSize);
+
+    // Once the whole history is silent the waveform stops changing, but the spectrum keeps
+    // falling until every column has reached the floor.
+    const bool isSilent = numSilentSamples >= fftSize;
+    const bool unchanged = numNewSamples == 0 || (wasSilent && isSilent);
+
+    if (unchanged && !(isSilent && spectrumFalling))
+        return;
+
+    updatePaths();
+    repaint();
+}
+
+/**
+ * The waveform starts at the latest rising zero crossing that still leaves scopeLength samples
+ * after it. The spectrum's columns are spaced logarithmically and read the nearest bins
+ * interpolated, so the path has one point per column whatever the FFT size.
+ */
+void ScopeComponent::updatePaths()
+{
+    // Puts the history in order, oldest first.
+    std::copy(history.begin() + historyPosition, history.end(), fftData.begin());
+    std::copy(history.begin(), history.begin() + historyPosition, fftData.begin() + (fftSize - historyPosition));
+
+    int start = fftSize - scopeLength;
+
+    for (int i = start; i > 0; --i) {
+        if (fftData[(size_t) i - 1] < 0.0f && fftData[(size_t) i] >= 0.0f) {
+            start = i;
+            break;
+        }
+    }
+
+    const float scopeX = (float) scopeArea.getX();
+    const float scopeStep = (float) scopeArea.getWidth() / (float) (scopeLength - 1);
+    const float scopeCentre = (float) scopeArea.getCentreY();
+    const float scopeHeight = (float) scopeArea.getHeight() * 0.5f;
+
+    scopePath.clear();
+    scopePath.preallocateSpace(3 * scopeLength);
+
+    for (int i = 0; i < scopeLength; ++i) {
+        const float x = scopeX + (float) i * scopeStep;
+        const float y = scopeCentre - juce::jlimit(-1.0f, 1.0f, fftData[(size_t) (start + i)]) * scopeHeight;
+
+        if (i == 0)
+            scopePath.startNewSubPath(x, y);
+        else
+            scopePath.lineTo(x, y);
+    }
+
+    // A full-scale sine peaks at a quarter of the FFT size once the Hann window has halved it.
+    window.multiplyWithWindowingTable(fftData.data(), (size_t) fftSize);
+    fft.performFrequencyOnlyForwardTransform(fftData.data());
+
+    const int numColumns = (int) spectrumLevels.size();
+    const float binsPerHz = (float) fftSize / (float) scopeFeed.getSampleRate();
+    const float maxFrequency = (float) scopeFeed.getSampleRate() * 0.5f;
+    const float spectrumX = (float) spectrumArea.getX();
+    const float spectrumBottom = (float) spectrumArea.getBottom();
+    const float spectrumHeight = (float) spectrumArea.getHeight();
+
+    spectrumPath.clear();
+    spectrumPath.preallocateSpace(3 * numColumns);
+    spectrumFalling = false;
+
+    for (int column = 0; column < numColumns; ++column) {
+        const float proportion = numColumns > 1 ? (float) column / (float) (numColumns - 1) : 0.0f;
+        const float bin = juce::jmin(minFrequency * std::pow(maxFrequency / minFrequency, proportion) * binsPerHz, (float) (fftSize / 2 - 1));
+        const int lower = (int) bin;
+        const float magnitude = juce::jmap(bin - (float) lower, fftData[(size_t) lower], fftData[(size_t) lower + 1]);
+
+        auto& level = spectrumLevels[(size_t) column];
+        level = juce::jmax(juce::Decibels::gainToDecibels(magnitude * 4.0f / (float) fftSize, minDecibels), level - fallDecibels);
+        spectrumFalling = spectrumFalling || level > minDecibels;
+
+        const float x = spectrumX + (float) column;
+        const float y = spectrumBottom - juce::jmap(level, minDecibels, 0.0f, 0.0f, spectrumHeight);
+
+        if (column == 0)
+            spectrumPath.startNewSubPath(x, y);
+        else
+            spectrumPath.lineTo(x, y);
+    }
+}
+
+/**
+ * Draws the frames, the scope's zero line and the spectrum's decade and 24 dB grid lines.
+ */
+void ScopeComponent::drawBackground(juce::Graphics& g)
+{
+    g.fillAll(juce::Colours::black);
+    g.setColour(juce::Colours::white);
+    g.drawRect(getLocalBounds(), 1);
+
+    g.setColour(juce::Colours::darkgrey);
+    g.drawHorizontalLine(scopeArea.getCentreY(), (float) scopeArea.getX(), (float) scopeArea.getRight());
+
+    const float maxFrequency = (float) scopeFeed.getSampleRate() * 0.5f;
+
+    for (float frequency = 100.0f; frequency < maxFrequency; frequency *= 10.0f) {
+        const float proportion = std::log(frequency / minFrequency) / std::log(maxFrequency / minFrequency);
+        g.drawVerticalLine(spectrumArea.getX() + juce::roundToInt(proportion * (float) (spectrumArea.getWidth() - 1)),
+                           (float) spectrumArea.getY(), (float) spectrumArea.getBottom());
+    }
+
+    for (float decibels = -24.0f; decibels > minDecibels; decibels -= 24.0f)
+        g.drawHorizontalLine(spectrumArea.getBottom() - juce::roundToInt(juce::jmap(decibels, minDecibels, 0.0f, 0.0f, (float) spectrumArea.getHeight())),
+                             (float) spectrumArea.getX(), (float) spectrumArea.getRight());
+
+    g.setColour(juce::Colours::grey);
+    g.setFont(12.0f);
+    g.drawText("Scope", scopeArea.reduced(2), juce::Justification::topLeft, false);
+    g.drawText("Spectrum", spectrumArea.reduced(2), juce::Justification::topLeft, false);
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+/*
+  ==============================================================================
+
+    ScopeComponent.h
+    An oscilloscope and a spectrum of the plugin's output, read from the
+    processor's ScopeFeed.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <vector>
+#include "../ScopeFeed.h"
+#include "LayerCache.h"
+
+//==============================================================================
+/**
+ * ScopeComponent shows the output as a waveform on the left, triggered on a rising zero crossing
+ * so that a steady note stands still, and as a spectrum on a logarithmic frequency axis on the right.
+ *
+ * All of the work happens on the message thread, once per frame of the editor: refresh() drains
+ * the feed, and only if new sound arrived does it run the FFT, rebuild the two paths and repaint.
+ * The grid and labels are drawn once per size into a cached layer, so a repaint is that layer
+ * plus two strokes. The feed is enabled for as long as the component exists.
+ */
+class ScopeComponent : public juce::Component
+{
+public:
+    /**
+     * Constructs the display and turns the feed on.
+     *
+     * @param feed The processor's feed, which must outlive the display.
+     */
+    explicit ScopeComponent(ScopeFeed& feed);
+
+    /**
+     * Turns the feed off, so the audio thread stops copying its output.
+     */
+    ~ScopeComponent() override;
+
+    /**
+     * Draws the cached background and the waveform and spectrum paths.
+     *
+     * @param g Graphics context used to draw the display.
+     */
+    void paint(juce::Graphics& g) override;
+
+    /**
+     * Splits the display into its two panels and redraws the cached background for the new size.
+     */
+    void resized() override;
+
+    /**
+     * Drains the feed and, if there was anything new to show or the spectrum is still falling,
+     * rebuilds the paths and repaints. Called by the editor's frame timer.
+     */
+    void refresh();
+
+private:
+    /** Builds the waveform and spectrum paths from the history. */
+    void updatePaths();
+
+    /**
+     * Draws the panels' frames, grid lines and labels.
+     * @param g The graphics context of the background layer.
+     */
+    void drawBackground(juce::Graphics& g);
+
+    static constexpr int fftOrder = 11;
+    static constexpr int fftSize = 1 << fftOrder;   // Samples of history, all of which the spectrum analyses.
+    static constexpr int scopeLength = 512;         // Samples the waveform shows.
+    static constexpr float minFrequency = 20.0f;    // Left edge of the spectrum, in Hz.
+    static constexpr float minDecibels = -96.0f;    // Bottom of the spectrum.
+    static constexpr float fallDecibels = 3.0f;     // How far a spectrum column may drop per frame.
+
+    ScopeFeed& scopeFeed;
+
+    juce::dsp::FFT fft{ fftOrder };
+    juce::dsp::WindowingFunction<float> window{ (size_t) fftSize, juce::dsp::WindowingFunction<float>::hann };
+
+    std::array<float, fftSize> history{};           // The latest samples, as a ring.
+    int historyPosition{ 0 };                       // Where the next sample goes, and so the oldest one.
+    int numSilentSamples{ 0 };                      // How many of the latest samples were exactly zero.
+    std::array<float, 2 * fftSize> fftData{};       // The history in order, then the FFT's working space.
+    std::vector<float> spectrumLevels;              // The level shown in each column of the spectrum, in dB.
+    bool spectrumFalling{ false };                  // Whether any column is still above minDecibels.
+
+    juce::Rectangle<int> scopeArea;
+    juce::Rectangle<int> spectrumArea;
+    double gridSampleRate{ 0.0 };                   // The rate the frequency grid was drawn for.
+    LayerCache backgroundLayer;
+    juce::Path scopePath;
+    juce::Path spectrumPath;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ScopeComponent)
+};
\ No newline at end of file
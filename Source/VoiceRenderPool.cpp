@@ -0,0 +1,118 @@
+/*
+  ==============================================================================
+
+    VoiceRenderPool.cpp
+    Implements the chunk claiming and the spin-then-wait handoff between the
+    audio thread and the render workers.
+
+  ==============================================================================
+*/
+
+#include "VoiceRenderPool.h"
+
+VoiceRenderPool::~VoiceRenderPool() {
+    stop();
+}
+
+// The audio thread waits for chunks the workers have claimed, so a worker that an ordinary
+// thread could preempt would make the audio thread miss its deadline.
+void VoiceRenderPool::start(int numWorkers, double sampleRate, int blockSize) {
+    if (workers.size() > 0)
+        return;
+
+    const auto options = juce::Thread::RealtimeOptions{}.withApproximateAudioProcessingTime(juce::jmax(1, blockSize), sampleRate);
+
+    for (int i = 0; i < numWorkers; ++i) {
+        auto* worker = workers.add(new Worker(*this));
+
+        if (!worker->startRealtimeThread(options))
+            worker->startThread(juce::Thread::Priority::highest);
+    }
+}
+
+void VoiceRenderPool::stop() {
+    for (auto* worker : workers) {
+        worker->signalThreadShouldExit();
+        worker->wakeUp.post();
+    }
+
+    for (auto* worker : workers)
+        worker->stopThread(1000);
+
+    workers.clear();
+}
+
+// Publishes the job, helps with it, and waits for chunks still being rendered by workers.
+void VoiceRenderPool::run(Job& job, int numChunks) noexcept {
+    jassert(numChunks <= maxChunks);
+
+    if (numChunks <= 0)
+        return;
+
+    // No worker can claim anything until the new generation is stored, so these are safe to replace.
+    currentJob.store(&job, std::memory_order_relaxed);
+    chunksDone.store(0, std::memory_order_relaxed);
+
+    const juce::uint32 newGeneration = ++generation;
+    work.store(((juce::uint64) newGeneration << 32) | ((juce::uint64) numChunks << 16));
+
+    // Workers that are still spinning see the new generation by themselves.
+    for (auto* worker : workers)
+        if (worker->sleeping.load())
+            worker->wakeUp.post();
+
+    runChunks(newGeneration);
+
+    while (chunksDone.load(std::memory_order_acquire) < numChunks) {}
+}
+
+void VoiceRenderPool::runChunks(juce::uint32 jobGeneration) noexcept {
+    auto current = work.load(std::memory_order_acquire);
+
+    for (;;) {
+        const auto chunk = (int) (current & 0xffff);
+        const auto numChunks = (int) ((current >> 16) & 0xffff);
+
+        // Stop once the job is used up, or if a newer job has replaced the one we were asked to help with.
+        if ((juce::uint32) (current >> 32) != jobGeneration || chunk >= numChunks)
+            return;
+
+        if (work.compare_exchange_weak(current, current + 1, std::memory_order_acq_rel)) {
+            currentJob.load(std::memory_order_relaxed)->runChunk(chunk);
+            chunksDone.fetch_add(1, std::memory_order_release);
+            current = work.load(std::memory_order_acquire);
+        }
+    }
+}
+
+//==============================================================================
+VoiceRenderPool::Worker::Worker(VoiceRenderPool& owner)
+    : juce::Thread("Voice render worker"), pool(owner) {
+}
+
+void VoiceRenderPool::Worker::run() {
+    juce::uint32 seen = pool.getGeneration();
+
+    while (!threadShouldExit()) {
+        juce::uint32 latest = seen;
+
+        for (int i = 0; i < spinIterations && latest == seen; ++i)
+            latest = pool.getGeneration();
+
+        if (latest == seen) {
+            // Announce the sleep before checking once more, so a job published in between is never missed.
+            // A post that arrives after that check but before the wait leaves the count at one, so the
+            // wait returns at once; a post meant for a wait that was skipped only costs an extra loop.
+            sleeping.store(true);
+
+            if (pool.getGeneration() == seen && !threadShouldExit())
+                wakeUp.wait();
+
+            sleeping.store(false);
+            continue;
+        }
+
+        seen = latest;
+        pool.runChunks(latest);
+    }
+}
\ No newline at end of file
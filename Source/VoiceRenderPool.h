@@ -0,0 +1,101 @@
+/*
+  ==============================================================================
+
+    VoiceRenderPool.h
+    A small pool of pre-spawned worker threads that help the audio thread
+    render voices, without locks or allocation on the audio path.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "RealtimeSemaphore.h"
+
+/**
+ * VoiceRenderPool splits a block's work into numbered chunks and lets the audio thread and a
+ * fixed set of worker threads claim them. Chunks are claimed with a compare-and-swap on one
+ * atomic that holds the job generation, the number of chunks and the next chunk index, so a
+ * worker that is late can never take a chunk from a newer job or run past the end of one.
+ *
+ * Workers run at real-time priority and spin for a short while after each job, so back-to-back
+ * blocks are picked up without a wake-up, and then sleep on a semaphore. The audio thread only
+ * posts to workers that are actually asleep, works through chunks itself, and never waits for a
+ * worker to start; it only waits for chunks that a worker has already claimed to finish.
+ */
+class VoiceRenderPool {
+
+public:
+    /** The work done for one block. runChunk() is called once for every chunk index. */
+    struct Job {
+        virtual ~Job() = default;
+
+        /**
+         * Does the work of one chunk. Called from the audio thread or from a worker thread.
+         * @param chunk The chunk index, in [0, numChunks).
+         */
+        virtual void runChunk(int chunk) noexcept = 0;
+    };
+
+    /** The largest number of chunks a job can be split into. */
+    static constexpr int maxChunks = 0xffff;
+
+    VoiceRenderPool() = default;
+
+    /** Stops the worker threads. */
+    ~VoiceRenderPool();
+
+    /**
+     * Spawns the worker threads as real-time threads. Does nothing if they are already running.
+     * Must not be called from the audio thread.
+     * @param numWorkers The number of threads to start in addition to the audio thread.
+     * @param sampleRate The audio sample rate, which with the block size tells the system how
+     *                   often the workers have to run.
+     * @param blockSize The largest block the audio thread renders.
+     */
+    void start(int numWorkers, double sampleRate, int blockSize);
+
+    /** Stops and deletes the worker threads. Must not be called from the audio thread. */
+    void stop();
+
+    /** Returns the number of worker threads running. */
+    int getNumWorkers() const { return workers.size(); }
+
+    /**
+     * Runs every chunk of a job across the audio thread and the workers, and returns once all
+     * of them have finished. Only one job may run at a time.
+     * @param job The work to do.
+     * @param numChunks The number of chunks the work is split into, at most maxChunks.
+     */
+    void run(Job& job, int numChunks) noexcept;
+
+private:
+    class Worker : public juce::Thread {
+    public:
+        explicit Worker(VoiceRenderPool& owner);
+        void run() override;
+
+        std::atomic<bool> sleeping{ false };   ///< Set while the worker waits on wakeUp.
+        RealtimeSemaphore wakeUp;              ///< Posted when a job is published.
+
+    private:
+        VoiceRenderPool& pool;
+    };
+
+    /** Claims and runs chunks of the given generation until there are none left. */
+    void runChunks(juce::uint32 generation) noexcept;
+
+    /** Returns the generation of the most recently published job. */
+    juce::uint32 getGeneration() const noexcept { return (juce::uint32) (work.load() >> 32); }
+
+    static constexpr int spinIterations = 2000;   ///< Polls of the generation before a worker sleeps.
+
+    std::atomic<juce::uint64> work{ 0 };          ///< Generation in bits 32-63, chunk count in bits 16-31, next chunk in bits 0-15.
+    std::atomic<int> chunksDone{ 0 };             ///< Chunks of the current job that have finished.
+    std::atomic<Job*> currentJob{ nullptr };      ///< Written before the generation is published.
+    juce::uint32 generation{ 0 };                 ///< Generation counter, only touched by the audio thread.
+    juce::OwnedArray<Worker> workers;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(VoiceRenderPool)
+};
\ No newline at end of file
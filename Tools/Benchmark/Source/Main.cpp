@@ -0,0 +1,274 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Headless benchmark that drives SynthAudioProcessor with scripted MIDI
+    workloads and reports how long the engine takes to render them.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+#include "../../../Source/PluginProcessor.h"
+
+namespace {
+
+/** The kinds of MIDI and automation the benchmark can play. */
+enum class Workload {
+    chord,      ///< One sustained chord held for the whole run.
+    arpeggio,   ///< Short notes started at a fast, steady rate.
+    fmSweep,    ///< A sustained chord while the FM depth and frequency move every block.
+    waveSwitch, ///< A sustained chord while the waveform changes every block.
+    supersaw    ///< A sustained chord of saws with seven detuned unison voices each.
+};
+
+struct Scenario {
+    const char* name;
+    Workload workload;
+    int polyphony;
+};
+
+/** A combination of the renderer parameters to measure each scenario with. */
+struct Renderer {
+    const char* name;
+    bool voiceBank;
+    bool multiCore;
+};
+
+struct Result {
+    double nsPerSample{ 0.0 };       ///< Wall time per sample frame.
+    double nsPerVoiceSample{ 0.0 };  ///< Wall time per sample frame and per active voice.
+    double realTimeFactor{ 0.0 };    ///< Audio duration rendered divided by wall time.
+    double worstBlockMicros{ 0.0 };  ///< Slowest single processBlock call.
+    double worstBlockLoad{ 0.0 };    ///< Slowest block as a fraction of its own duration.
+    double averageVoices{ 0.0 };     ///< Mean number of active voices at the end of each block.
+};
+
+const Scenario scenarios[] = {
+    { "chord-8", Workload::chord, 8 },
+    { "chord-32", Workload::chord, 32 },
+    { "chord-128", Workload::chord, 128 },
+    { "arpeggio", Workload::arpeggio, 16 },
+    { "fm-sweep", Workload::fmSweep, 8 },
+    { "wave-switch", Workload::waveSwitch, 8 },
+    { "supersaw", Workload::supersaw, 8 },
+};
+
+const Renderer renderers[] = {
+    { "voices", false, false },
+    { "voice-bank", true, false },
+    { "multi-core", false, true },
+};
+
+/** Sets a parameter from its plain value, the way host automation would. */
+void setParameter(SynthAudioProcessor& processor, const juce::String& parameterId, float value) {
+    auto* parameter = processor.apvts.getParameter(parameterId);
+    jassert(parameter != nullptr);
+    parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+}
+
+/** Returns the i-th note of a chord. Stepping by five semitones modulo 128 never repeats a note. */
+int chordNote(int index) {
+    return (24 + index * 5) % 128;
+}
+
+/** Adds the MIDI events and automation of one block of a scenario. */
+void prepareBlock(SynthAudioProcessor& processor, const Scenario& scenario, juce::MidiBuffer& midi,
+                  juce::int64 blockStart, int blockSize, int blockIndex, double sampleRate) {
+    switch (scenario.workload) {
+    case Workload::chord:
+    case Workload::fmSweep:
+    case Workload::waveSwitch:
+    case Workload::supersaw:
+        if (blockIndex == 0)
+            for (int i = 0; i < scenario.polyphony; ++i)
+                midi.addEvent(juce::MidiMessage::noteOn(1, chordNote(i), 0.8f), 0);
+        break;
+
+    case Workload::arpeggio: {
+        // A new note every 30 ms, each held for 60 ms, cycling through four octaves of a minor chord.
+        const auto step = (juce::int64) (sampleRate * 0.03);
+        const auto length = (juce::int64) (sampleRate * 0.06);
+        static constexpr int pattern[] = { 0, 3, 7, 12 };
+
+        for (juce::int64 time = blockStart; time < blockStart + blockSize; ++time) {
+            if (time % step == 0) {
+                const auto index = (int) (time / step);
+                const int note = 48 + pattern[index % 4] + 12 * ((index / 4) % 4);
+                midi.addEvent(juce::MidiMessage::noteOn(1, note, 0.8f), (int) (time - blockStart));
+            }
+
+            if (time >= length && (time - length) % step == 0) {
+                const auto index = (int) ((time - length) / step);
+                const int note = 48 + pattern[index % 4] + 12 * ((index / 4) % 4);
+                midi.addEvent(juce::MidiMessage::noteOff(1, note), (int) (time - blockStart));
+            }
+        }
+        break;
+    }
+    }
+
+    if (scenario.workload == Workload::fmSweep) {
+        // Sweep both FM controls over a two second cycle.
+        const double position = std::sin(juce::MathConstants<double>::twoPi * (double) blockStart / (sampleRate * 2.0));
+        setParameter(processor, "OSC1FMDEPTH", (float) (500.0 + 500.0 * position));
+        setParameter(processor, "OSC1FMFREQ", (float) (250.0 + 250.0 * position));
+    }
+
+    if (scenario.workload == Workload::waveSwitch)
+        setParameter(processor, "OSC1WAVETYPE", (float) (blockIndex % 3));
+}
+
+/** Renders one scenario with one renderer and block size, timing every processBlock call. */
+Result runScenario(const Scenario& scenario, const Renderer& renderer, int blockSize, double sampleRate, double seconds) {
+    SynthAudioProcessor processor;
+    processor.setPlayConfigDetails(0, 2, sampleRate, blockSize);
+
+    setParameter(processor, "POLYPHONY", (float) scenario.polyphony);
+    setParameter(processor, "VOICEBANK", renderer.voiceBank ? 1.0f : 0.0f);
+    setParameter(processor, "MULTICORE", renderer.multiCore ? 1.0f : 0.0f);
+
+    // Unison always renders per voice, so the voice bank renderer measures the same path here.
+    if (scenario.workload == Workload::supersaw) {
+        setParameter(processor, "OSC1WAVETYPE", 1.0f);
+        setParameter(processor, "UNISON", 7.0f);
+    }
+
+    processor.prepareToPlay(sampleRate, blockSize);
+
+    juce::AudioBuffer<float> buffer(2, blockSize);
+    juce::MidiBuffer midi;
+    midi.ensureSize(4096);
+
+    const int numBlocks = juce::jmax(1, (int) std::ceil(seconds * sampleRate / blockSize));
+    const double blockSeconds = blockSize / sampleRate;
+
+    Result result;
+    double totalSeconds = 0.0;
+    double voiceBlocks = 0.0;
+
+    for (int block = 0; block < numBlocks; ++block) {
+        midi.clear();
+        prepareBlock(processor, scenario, midi, (juce::int64) block * blockSize, blockSize, block, sampleRate);
+        buffer.clear();
+
+        const auto start = juce::Time::getHighResolutionTicks();
+        processor.processBlock(buffer, midi);
+        const auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+        totalSeconds += elapsed;
+        result.worstBlockMicros = juce::jmax(result.worstBlockMicros, elapsed * 1.0e6);
+        voiceBlocks += processor.getNumActiveVoices();
+    }
+
+    const double numSamples = (double) numBlocks * blockSize;
+    result.averageVoices = voiceBlocks / numBlocks;
+    result.nsPerSample = totalSeconds * 1.0e9 / numSamples;
+    result.nsPerVoiceSample = result.averageVoices > 0.0 ? result.nsPerSample / result.averageVoices : 0.0;
+    result.realTimeFactor = totalSeconds > 0.0 ? numSamples / sampleRate / totalSeconds : 0.0;
+    result.worstBlockLoad = result.worstBlockMicros * 1.0e-6 / blockSeconds;
+
+    processor.releaseResources();
+    return result;
+}
+
+void printUsage() {
+    std::cout << "Usage: SynthBenchmark [options]\n"
+                 "  --format table|csv|json   Output format (default: table). json prints one object per line.\n"
+                 "  --seconds <s>             Audio rendered per run (default: 2).\n"
+                 "  --sample-rate <hz>        Sample rate (default: 48000).\n"
+                 "  --block-sizes <list>      Comma-separated block sizes (default: 16,32,64,128,256,512,1024,2048).\n"
+                 "  --filter <text>           Only run scenarios or renderers whose name contains the text.\n";
+}
+
+juce::String formatResult(const juce::String& format, const Scenario& scenario, const Renderer& renderer,
+                          int blockSize, const Result& r) {
+    if (format == "csv")
+        return juce::String::formatted("%s,%s,%d,%.3f,%.3f,%.3f,%.2f,%.4f,%.2f", scenario.name, renderer.name, blockSize,
+                                       r.nsPerSample, r.nsPerVoiceSample, r.realTimeFactor, r.worstBlockMicros,
+                                       r.worstBlockLoad, r.averageVoices);
+
+    if (format == "json")
+        return juce::String::formatted("{\"scenario\":\"%s\",\"renderer\":\"%s\",\"blockSize\":%d,\"nsPerSample\":%.3f,"
+                                       "\"nsPerVoiceSample\":%.3f,\"realTimeFactor\":%.3f,\"worstBlockMicros\":%.2f,"
+                                       "\"worstBlockLoad\":%.4f,\"averageVoices\":%.2f}",
+                                       scenario.name, renderer.name, blockSize, r.nsPerSample, r.nsPerVoiceSample,
+                                       r.realTimeFactor, r.worstBlockMicros, r.worstBlockLoad, r.averageVoices);
+
+    return juce::String::formatted("%-12s %-11s %6d %12.2f %14.3f %10.1f %12.1f %8.1f%% %7.1f", scenario.name, renderer.name,
+                                   blockSize, r.nsPerSample, r.nsPerVoiceSample, r.realTimeFactor, r.worstBlockMicros,
+                                   r.worstBlockLoad * 100.0, r.averageVoices);
+}
+
+}
+
+//==============================================================================
+int main(int argc, char* argv[]) {
+    juce::ScopedJuceInitialiser_GUI juceInitialiser; // The parameter tree expects a message manager to exist.
+
+    juce::String format = "table";
+    juce::String filter;
+    double seconds = 2.0;
+    double sampleRate = 48000.0;
+    juce::Array<int> blockSizes{ 16, 32, 64, 128, 256, 512, 1024, 2048 };
+
+    for (int i = 1; i < argc; ++i) {
+        const juce::String arg(argv[i]);
+        const juce::String value = i + 1 < argc ? juce::String(argv[i + 1]) : juce::String();
+
+        if (arg == "--format") {
+            format = value;
+            ++i;
+        }
+        else if (arg == "--seconds") {
+            seconds = value.getDoubleValue();
+            ++i;
+        }
+        else if (arg == "--sample-rate") {
+            sampleRate = value.getDoubleValue();
+            ++i;
+        }
+        else if (arg == "--block-sizes") {
+            blockSizes.clear();
+            for (const auto& size : juce::StringArray::fromTokens(value, ",", {}))
+                blockSizes.add(size.getIntValue());
+            ++i;
+        }
+        else if (arg == "--filter") {
+            filter = value;
+            ++i;
+        }
+        else {
+            printUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    if ((format != "table" && format != "csv" && format != "json") || seconds <= 0.0 || sampleRate <= 0.0) {
+        printUsage();
+        return 1;
+    }
+
+    if (format == "csv")
+        std::cout << "scenario,renderer,blockSize,nsPerSample,nsPerVoiceSample,realTimeFactor,worstBlockMicros,worstBlockLoad,averageVoices\n";
+    else if (format == "table")
+        std::cout << "scenario     renderer     block    ns/sample  ns/voice/sample   RT factor  worst block   worst %  voices\n";
+
+    for (const auto& scenario : scenarios) {
+        for (const auto& renderer : renderers) {
+            if (filter.isNotEmpty() && !juce::String(scenario.name).contains(filter) && !juce::String(renderer.name).contains(filter))
+                continue;
+
+            for (const int blockSize : blockSizes) {
+                if (blockSize <= 0)
+                    continue;
+
+                const auto result = runScenario(scenario, renderer, blockSize, sampleRate, seconds);
+                std::cout << formatResult(format, scenario, renderer, blockSize, result) << std::endl;
+            }
+        }
+    }
+
+    return 0;
+}
\ No newline at end of file
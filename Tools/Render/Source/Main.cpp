@@ -0,0 +1,360 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Offline renderer that plays Standard MIDI Files through SynthAudioProcessor
+    as fast as the CPU allows and writes the result to WAV or FLAC.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+#include "../../../Source/PluginProcessor.h"
+#include "../../../Source/Data/PresetBank.h"
+
+namespace {
+
+struct Options {
+    juce::File outputDirectory;            ///< Where files are written; empty to write next to each MIDI file.
+    juce::String format{ "wav" };          ///< "wav" or "flac".
+    juce::MemoryBlock preset;              ///< Patch data applied to every processor, or empty for the defaults.
+    juce::File scale;                      ///< Scala scale to tune with, or a default File for equal temperament.
+    juce::File keyboardMapping;            ///< Scala keyboard mapping, or a default File for the default mapping.
+    double sampleRate{ 48000.0 };
+    int blockSize{ 512 };
+    int bitDepth{ 24 };
+    double tailSeconds{ 5.0 };             ///< Longest time rendered after the last event while voices ring out.
+    bool stems{ false };                   ///< Render each track of a file on its own.
+    int numJobs{ juce::SystemStats::getNumCpus() };
+};
+
+/** One output file: a MIDI file, or one track of it. */
+struct RenderJob {
+    juce::File midiFile;
+    int track{ -1 };                       ///< The track to render, or -1 for every track together.
+    juce::File outputFile;
+};
+
+/** A note or controller event at a sample position. */
+struct TimedEvent {
+    juce::int64 sample;
+    juce::MidiMessage message;
+};
+
+void printUsage() {
+    std::cout << "Usage: SynthRender [options] <file.mid>...\n"
+                 "  --output-dir <dir>        Where to write the audio (default: next to each MIDI file).\n"
+                 "  --format wav|flac         Output format (default: wav).\n"
+                 "  --bit-depth 16|24|32      Sample format; 32 writes floating-point WAV (default: 24).\n"
+                 "  --preset <file>           Load a saved plugin state before rendering.\n"
+                 "  --program <number|name>   Load a program from the preset bank before rendering.\n"
+                 "  --scale <file.scl>        Tune with a Scala scale instead of equal temperament.\n"
+                 "  --mapping <file.kbm>      Map the scale onto the keys with a Scala keyboard mapping.\n"
+                 "  --sample-rate <hz>        Sample rate (default: 48000).\n"
+                 "  --block-size <n>          Samples per processBlock call (default: 512).\n"
+                 "  --tail <s>                Longest release tail after the last event (default: 5).\n"
+                 "  --stems                   Write one file per track instead of one per MIDI file.\n"
+                 "  --jobs <n>                Files rendered in parallel (default: number of CPUs).\n";
+}
+
+/** Reads the events of one track, or of all tracks merged, and converts their times to samples. */
+bool readEvents(const RenderJob& job, double sampleRate, std::vector<TimedEvent>& events) {
+    juce::FileInputStream input(job.midiFile);
+    juce::MidiFile midiFile;
+
+    if (!input.openedOk() || !midiFile.readFrom(input))
+        return false;
+
+    midiFile.convertTimestampTicksToSeconds();
+
+    for (int track = 0; track < midiFile.getNumTracks(); ++track) {
+        if (job.track >= 0 && track != job.track)
+            continue;
+
+        const auto* sequence = midiFile.getTrack(track);
+
+        for (int i = 0; i < sequence->getNumEvents(); ++i) {
+            const auto& message = sequence->getEventPointer(i)->message;
+
+            if (!message.isMetaEvent() && !message.isSysEx())
+                events.push_back({ (juce::int64) std::llround(message.getTimeStamp() * sampleRate), message });
+        }
+    }
+
+    // Merged tracks must be in time order; equal times keep their file order.
+    std::stable_sort(events.begin(), events.end(), [](const TimedEvent& a, const TimedEvent& b) { return a.sample < b.sample; });
+    return true;
+}
+
+/** Returns the indices of the tracks of a MIDI file that contain notes. */
+juce::Array<int> findNoteTracks(const juce::File& file) {
+    juce::Array<int> tracks;
+    juce::FileInputStream input(file);
+    juce::MidiFile midiFile;
+
+    if (!input.openedOk() || !midiFile.readFrom(input))
+        return tracks;
+
+    for (int track = 0; track < midiFile.getNumTracks(); ++track) {
+        const auto* sequence = midiFile.getTrack(track);
+
+        for (int i = 0; i < sequence->getNumEvents(); ++i) {
+            if (sequence->getEventPointer(i)->message.isNoteOn()) {
+                tracks.add(track);
+                break;
+            }
+        }
+    }
+
+    return tracks;
+}
+
+std::unique_ptr<juce::AudioFormatWriter> createWriter(const juce::File& file, const Options& options) {
+    std::unique_ptr<juce::AudioFormat> format;
+
+    if (options.format == "flac")
+        format = std::make_unique<juce::FlacAudioFormat>();
+    else
+        format = std::make_unique<juce::WavAudioFormat>();
+
+    file.deleteFile();
+    std::unique_ptr<juce::FileOutputStream> stream(file.createOutputStream());
+
+    if (stream == nullptr)
+        return nullptr;
+
+    // The writer takes ownership of the stream only if it was created.
+    std::unique_ptr<juce::AudioFormatWriter> writer(format->createWriterFor(stream.get(), options.sampleRate, 2,
+                                                                            options.bitDepth, {}, 0));
+    if (writer != nullptr)
+        stream.release();
+
+    return writer;
+}
+
+/**
+ * Renders one job in its own processor. Blocks are always blockSize long and events land on
+ * the same sample offsets a host would give them, so the audio matches real-time playback at
+ * the same block size sample for sample, apart from the plugin's reported latency, which is
+ * trimmed from the start of the file. The processor runs in non-realtime mode, so program
+ * changes are loaded in the block they arrive in rather than on the loader's thread, and every
+ * render of the same file is identical.
+ */
+bool render(const RenderJob& job, const Options& options, juce::String& error) {
+    std::vector<TimedEvent> events;
+
+    if (!readEvents(job, options.sampleRate, events)) {
+        error = "could not read " + job.midiFile.getFullPathName();
+        return false;
+    }
+
+    SynthAudioProcessor processor;
+    processor.setPlayConfigDetails(0, 2, options.sampleRate, options.blockSize);
+
+    // Set first, so the preset's parameters are applied on this thread; there is no message loop to do it.
+    processor.setNonRealtime(true);
+
+    if (options.preset.getSize() > 0)
+        processor.setStateInformation(options.preset.getData(), (int) options.preset.getSize());
+
+    // Loaded on this thread, so the first block already plays in the new tuning.
+    if (options.scale != juce::File() && !processor.loadTuningNow(options.scale, options.keyboardMapping, error))
+        return false;
+
+    processor.prepareToPlay(options.sampleRate, options.blockSize);
+
+    auto writer = createWriter(job.outputFile, options);
+
+    if (writer == nullptr) {
+        error = "could not write " + job.outputFile.getFullPathName();
+        return false;
+    }
+
+    juce::AudioBuffer<float> buffer(2, options.blockSize);
+    juce::MidiBuffer midi;
+    midi.ensureSize(4096);
+
+    // Oversampling delays the output, so drop its first samples and render that much further.
+    const int latency = processor.getLatencySamples();
+    const juce::int64 lastEvent = events.empty() ? 0 : events.back().sample;
+    juce::int64 end = lastEvent + (juce::int64) std::llround(options.tailSeconds * options.sampleRate) + latency;
+    size_t next = 0;
+
+    for (juce::int64 blockStart = 0; blockStart < end; blockStart += options.blockSize) {
+        midi.clear();
+
+        for (; next < events.size() && events[next].sample < blockStart + options.blockSize; ++next)
+            midi.addEvent(events[next].message, (int) (events[next].sample - blockStart));
+
+        buffer.clear();
+        processor.processBlock(buffer, midi);
+
+        const juce::int64 first = juce::jmax(blockStart, (juce::int64) latency);
+        const juce::int64 last = juce::jmin(blockStart + options.blockSize, end);
+
+        if (last > first)
+            writer->writeFromAudioSampleBuffer(buffer, (int) (first - blockStart), (int) (last - first));
+
+        // Stop once every event has played, the last voice has finished its release and the latency has played out.
+        if (next == events.size() && blockStart + options.blockSize > lastEvent && processor.getNumActiveVoices() == 0)
+            end = juce::jmin(end, blockStart + options.blockSize + latency);
+    }
+
+    processor.releaseResources();
+    return true;
+}
+
+/** Reads a preset from a state file, or from the preset bank by number or name. */
+bool loadPreset(const juce::String& source, bool fromBank, juce::MemoryBlock& preset) {
+    if (!fromBank)
+        return juce::File::getCurrentWorkingDirectory().getChildFile(source).loadFileAsData(preset) && preset.getSize() > 0;
+
+    juce::SharedResourcePointer<PresetBank> bank;
+    int program = bank->findProgram(source);
+
+    if (program < 0 && source.containsOnly("0123456789"))
+        program = source.getIntValue();
+
+    const void* data = nullptr;
+    size_t size = 0;
+
+    if (!bank->getPatchData(program, data, size))
+        return false;
+
+    preset.replaceAll(data, size);
+    return true;
+}
+
+}
+
+//==============================================================================
+int main(int argc, char* argv[]) {
+    juce::ScopedJuceInitialiser_GUI juceInitialiser; // The parameter tree expects a message manager to exist.
+
+    Options options;
+    juce::Array<juce::File> midiFiles;
+
+    for (int i = 1; i < argc; ++i) {
+        const juce::String arg(argv[i]);
+        const juce::String value = i + 1 < argc ? juce::String(argv[i + 1]) : juce::String();
+
+        if (arg == "--output-dir") {
+            options.outputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(value);
+            ++i;
+        }
+        else if (arg == "--format") {
+            options.format = value;
+            ++i;
+        }
+        else if (arg == "--bit-depth") {
+            options.bitDepth = value.getIntValue();
+            ++i;
+        }
+        else if (arg == "--preset" || arg == "--program") {
+            if (!loadPreset(value, arg == "--program", options.preset)) {
+                std::cerr << "Could not load preset " << value << "\n";
+                return 1;
+            }
+            ++i;
+        }
+        else if (arg == "--scale") {
+            options.scale = juce::File::getCurrentWorkingDirectory().getChildFile(value);
+            ++i;
+        }
+        else if (arg == "--mapping") {
+            options.keyboardMapping = juce::File::getCurrentWorkingDirectory().getChildFile(value);
+            ++i;
+        }
+        else if (arg == "--sample-rate") {
+            options.sampleRate = value.getDoubleValue();
+            ++i;
+        }
+        else if (arg == "--block-size") {
+            options.blockSize = value.getIntValue();
+            ++i;
+        }
+        else if (arg == "--tail") {
+            options.tailSeconds = value.getDoubleValue();
+            ++i;
+        }
+        else if (arg == "--stems") {
+            options.stems = true;
+        }
+        else if (arg == "--jobs") {
+            options.numJobs = value.getIntValue();
+            ++i;
+        }
+        else if (arg.startsWith("--")) {
+            printUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+        else {
+            midiFiles.add(juce::File::getCurrentWorkingDirectory().getChildFile(arg));
+        }
+    }
+
+    const bool validDepth = options.bitDepth == 16 || options.bitDepth == 24 || (options.bitDepth == 32 && options.format == "wav");
+
+    if (midiFiles.isEmpty() || (options.format != "wav" && options.format != "flac") || !validDepth
+        || options.sampleRate <= 0.0 || options.blockSize <= 0 || options.tailSeconds < 0.0 || options.numJobs <= 0) {
+        printUsage();
+        return 1;
+    }
+
+    // Check the tuning once here, rather than failing every job.
+    if (options.scale != juce::File() || options.keyboardMapping != juce::File()) {
+        juce::String error;
+
+        if (options.scale == juce::File() || TuningTable::fromFiles(options.scale, options.keyboardMapping, error) == nullptr) {
+            std::cerr << "Could not load tuning: " << (error.isNotEmpty() ? error : juce::String("--mapping needs --scale")) << "\n";
+            return 1;
+        }
+    }
+
+    // One job per output file: every note track of every file with --stems, otherwise every file.
+    std::vector<RenderJob> jobs;
+
+    for (const auto& midiFile : midiFiles) {
+        const auto directory = options.outputDirectory != juce::File() ? options.outputDirectory : midiFile.getParentDirectory();
+        directory.createDirectory();
+
+        if (options.stems) {
+            for (const int track : findNoteTracks(midiFile))
+                jobs.push_back({ midiFile, track, directory.getChildFile(midiFile.getFileNameWithoutExtension()
+                                                                         + "-track" + juce::String(track + 1) + "." + options.format) });
+        }
+        else {
+            jobs.push_back({ midiFile, -1, directory.getChildFile(midiFile.getFileNameWithoutExtension() + "." + options.format) });
+        }
+    }
+
+    // Every job has its own processor, so they share nothing but the read-only tables and preset bank.
+    juce::ThreadPool pool(juce::jmin(options.numJobs, juce::jmax(1, (int) jobs.size())));
+    juce::CriticalSection outputLock;
+    std::atomic<int> failures{ 0 };
+
+    for (const auto& job : jobs) {
+        pool.addJob([&job, &options, &outputLock, &failures] {
+            const auto start = juce::Time::getMillisecondCounterHiRes();
+            juce::String error;
+            const bool ok = render(job, options, error);
+            const auto seconds = (juce::Time::getMillisecondCounterHiRes() - start) / 1000.0;
+
+            const juce::ScopedLock sl(outputLock);
+
+            if (ok) {
+                std::cout << job.outputFile.getFullPathName() << " (" << juce::String(seconds, 2) << " s)" << std::endl;
+            }
+            else {
+                std::cerr << "Error: " << error << std::endl;
+                ++failures;
+            }
+        });
+    }
+
+    while (pool.getNumJobs() > 0)
+        juce::Thread::sleep(10);
+
+    return failures > 0 ? 1 : 0;
+}
\ No newline at end of file